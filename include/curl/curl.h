@@ -932,6 +932,14 @@ typedef enum {
    a client certificate for authentication. (Schannel) */
 #define CURLSSLOPT_AUTO_CLIENT_CERT (1<<5)
 
+/* - CURLSSLOPT_KTLS tells libcurl to let the kernel encrypt and decrypt TLS
+   records when it can. (OpenSSL 3 on Linux) */
+#define CURLSSLOPT_KTLS (1<<6)
+
+/* - CURLSSLOPT_EARLYDATA tells libcurl to send GET and HEAD requests as TLS
+   1.3 early data (0-RTT) on resumed sessions. (OpenSSL) */
+#define CURLSSLOPT_EARLYDATA (1<<7)
+
 /* The default connection attempt delay in milliseconds for happy eyeballs.
    CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS.3 and happy-eyeballs-timeout-ms.d document
    this value, keep them in sync. */
@@ -2203,6 +2211,15 @@ typedef enum {
   /* Can leak things, gonna exit() soon */
   CURLOPT(CURLOPT_QUICK_EXIT, CURLOPTTYPE_LONG, 322),
 
+  /* list of zstd dictionary files for content decoding */
+  CURLOPT(CURLOPT_ZSTD_DICTIONARIES, CURLOPTTYPE_SLISTPOINT, 323),
+
+  /* zstd dictionary for content decoding, in memory */
+  CURLOPT(CURLOPT_ZSTD_DICTIONARY_BLOB, CURLOPTTYPE_BLOB, 324),
+
+  /* Content-Encoding to compress the request body with */
+  CURLOPT(CURLOPT_UPLOAD_ENCODING, CURLOPTTYPE_STRINGPOINT, 325),
+
   CURLOPT_LASTENTRY /* the last unused */
 } CURLoption;
 
@@ -2909,7 +2926,16 @@ typedef enum {
   CURLINFO_REFERER          = CURLINFO_STRING + 60,
   CURLINFO_CAINFO           = CURLINFO_STRING + 61,
   CURLINFO_CAPATH           = CURLINFO_STRING + 62,
-  CURLINFO_LASTONE          = 62
+  CURLINFO_TLS_SESSION_RESUMED = CURLINFO_LONG + 63,
+  CURLINFO_TLS_EARLYDATA    = CURLINFO_LONG + 64,
+  CURLINFO_TLS_GROUP        = CURLINFO_STRING + 65,
+  CURLINFO_TLS_HANDSHAKE_TIME_T = CURLINFO_OFF_T + 66,
+  CURLINFO_TLS_VERIFY_TIME_T = CURLINFO_OFF_T + 67,
+  CURLINFO_TLS_RECORDS_IN_T = CURLINFO_OFF_T + 68,
+  CURLINFO_TLS_RECORDS_OUT_T = CURLINFO_OFF_T + 69,
+  CURLINFO_TLS_BYTES_IN_T   = CURLINFO_OFF_T + 70,
+  CURLINFO_TLS_BYTES_OUT_T  = CURLINFO_OFF_T + 71,
+  CURLINFO_LASTONE          = 71
 } CURLINFO;
 
 /* CURLINFO_RESPONSE_CODE is the new name for the option previously known as
@@ -2954,6 +2980,7 @@ typedef enum {
   CURL_LOCK_DATA_CONNECT,
   CURL_LOCK_DATA_PSL,
   CURL_LOCK_DATA_HSTS,
+  CURL_LOCK_DATA_CA_STORE,
   CURL_LOCK_DATA_LAST
 } curl_lock_data;
 
@@ -399,6 +399,12 @@ typedef enum {
   /* maximum number of concurrent streams to support on a connection */
   CURLOPT(CURLMOPT_MAX_CONCURRENT_STREAMS, CURLOPTTYPE_LONG, 16),
 
+  /* maximum total size of HTTP/2 receive windows for all connections */
+  CURLOPT(CURLMOPT_MAX_HTTP2_WINDOW, CURLOPTTYPE_LONG, 17),
+
+  /* number of threads to verify TLS server certificates in */
+  CURLOPT(CURLMOPT_SSL_VERIFY_THREADS, CURLOPTTYPE_LONG, 18),
+
   CURLMOPT_LASTENTRY /* the last unused */
 } CURLMoption;
 
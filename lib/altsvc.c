@@ -38,6 +38,7 @@
 #include "warnless.h"
 #include "fopen.h"
 #include "rename.h"
+#include "hash.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -54,6 +55,16 @@
 
 #define H3VERSION "h3"
 
+/* the origin index starts out small and grows by ALTSVC_GROWTH whenever the
+   average chain gets longer than ALTSVC_MAXCHAIN */
+#define ALTSVC_SLOTS 31
+#define ALTSVC_GROWTH 8
+#define ALTSVC_MAXCHAIN 2
+#define ALTSVC_HEAPSIZE 32
+
+/* "[alpnid]:[port]:" plus the host name and a zero terminator */
+#define ALTSVC_KEYLEN (MAX_ALTSVC_HOSTLEN + 16)
+
 static enum alpnid alpn2alpnid(char *name)
 {
   if(strcasecompare(name, "h1"))
@@ -137,6 +148,204 @@ static struct altsvc *altsvc_create(char *srchost,
                          srcport, dstport);
 }
 
+/*
+ * Build the origin index key for the given source. The host name is
+ * lowercased and a trailing dot is ignored. Returns the key length, or 0
+ * if the host name is too long to be indexed.
+ */
+static size_t origin_key(char *key, enum alpnid alpnid, const char *host,
+                         unsigned int port)
+{
+  size_t hlen = strlen(host);
+  size_t klen;
+  if(hlen && (host[hlen - 1] == '.'))
+    hlen--;
+  if(hlen > MAX_ALTSVC_HOSTLEN)
+    return 0;
+  klen = msnprintf(key, ALTSVC_KEYLEN, "%d:%u:", (int)alpnid, port);
+  Curl_strntolower(&key[klen], host, hlen);
+  klen += hlen;
+  key[klen] = 0;
+  return klen;
+}
+
+/* the origin lists are freed explicitly, see origin_drop() */
+static void origin_dtor(void *p)
+{
+  (void)p;
+}
+
+/*
+ * Return the list of entries for the given source origin. If 'create' is
+ * set, a missing list is added. Returns NULL if there is no list.
+ */
+static struct Curl_llist *origin_get(struct altsvcinfo *asi,
+                                     enum alpnid alpnid, const char *host,
+                                     unsigned int port, bool create)
+{
+  char key[ALTSVC_KEYLEN];
+  size_t klen = origin_key(key, alpnid, host, port);
+  struct Curl_llist *origin;
+  if(!klen)
+    return NULL;
+  origin = Curl_hash_pick(&asi->origins, key, klen);
+  if(!origin && create) {
+    origin = malloc(sizeof(*origin));
+    if(!origin)
+      return NULL;
+    Curl_llist_init(origin, NULL);
+    if(!Curl_hash_add(&asi->origins, key, klen, origin)) {
+      free(origin);
+      return NULL;
+    }
+  }
+  return origin;
+}
+
+/* remove the (empty) list of this entry's source origin */
+static void origin_drop(struct altsvcinfo *asi, struct altsvc *as)
+{
+  char key[ALTSVC_KEYLEN];
+  size_t klen = origin_key(key, as->src.alpnid, as->src.host, as->src.port);
+  struct Curl_llist *origin = Curl_hash_pick(&asi->origins, key, klen);
+  if(origin) {
+    DEBUGASSERT(!origin->size);
+    Curl_hash_delete(&asi->origins, key, klen);
+    free(origin);
+  }
+}
+
+/*
+ * Rebuild the origin index with more slots once the chains get long. The
+ * old index is kept intact until the new one is complete.
+ */
+static void origin_grow(struct altsvcinfo *asi)
+{
+  struct Curl_hash origins;
+  struct Curl_hash_iterator iter;
+  struct Curl_hash_element *he;
+
+  if(Curl_hash_count(&asi->origins) <=
+     (size_t)asi->origins.slots * ALTSVC_MAXCHAIN)
+    return;
+
+  Curl_hash_init(&origins, asi->origins.slots * ALTSVC_GROWTH + 1,
+                 Curl_hash_str, Curl_str_key_compare, origin_dtor);
+  Curl_hash_start_iterate(&asi->origins, &iter);
+  for(he = Curl_hash_next_element(&iter); he;
+      he = Curl_hash_next_element(&iter)) {
+    if(!Curl_hash_add(&origins, he->key, he->key_len, he->ptr)) {
+      Curl_hash_destroy(&origins);
+      return;
+    }
+  }
+  Curl_hash_destroy(&asi->origins);
+  asi->origins = origins;
+}
+
+static void heap_set(struct altsvcinfo *asi, size_t i, struct altsvc *as)
+{
+  asi->heap[i] = as;
+  as->heapidx = i;
+}
+
+/* restore the heap order for the entry at position 'i' */
+static void heap_fix(struct altsvcinfo *asi, size_t i)
+{
+  struct altsvc *as = asi->heap[i];
+
+  /* move up */
+  while(i) {
+    size_t parent = (i - 1) / 2;
+    if(asi->heap[parent]->expires <= as->expires)
+      break;
+    heap_set(asi, i, asi->heap[parent]);
+    i = parent;
+  }
+  /* move down */
+  for(;;) {
+    size_t child = i * 2 + 1;
+    if(child >= asi->heapsize)
+      break;
+    if((child + 1 < asi->heapsize) &&
+       (asi->heap[child + 1]->expires < asi->heap[child]->expires))
+      child++;
+    if(as->expires <= asi->heap[child]->expires)
+      break;
+    heap_set(asi, i, asi->heap[child]);
+    i = child;
+  }
+  heap_set(asi, i, as);
+}
+
+static CURLcode heap_push(struct altsvcinfo *asi, struct altsvc *as)
+{
+  if(asi->heapsize == asi->heapalloc) {
+    size_t newalloc = asi->heapalloc ? asi->heapalloc * 2 : ALTSVC_HEAPSIZE;
+    struct altsvc **heap = realloc(asi->heap, newalloc * sizeof(*heap));
+    if(!heap)
+      return CURLE_OUT_OF_MEMORY;
+    asi->heap = heap;
+    asi->heapalloc = newalloc;
+  }
+  heap_set(asi, asi->heapsize++, as);
+  heap_fix(asi, as->heapidx);
+  return CURLE_OK;
+}
+
+static void heap_remove(struct altsvcinfo *asi, struct altsvc *as)
+{
+  size_t i = as->heapidx;
+  DEBUGASSERT(asi->heap[i] == as);
+  if(i < --asi->heapsize) {
+    heap_set(asi, i, asi->heap[asi->heapsize]);
+    heap_fix(asi, i);
+  }
+}
+
+/*
+ * Add a newly created entry to the cache. The entry is freed on failure.
+ */
+static CURLcode altsvc_store(struct altsvcinfo *asi, struct altsvc *as)
+{
+  struct Curl_llist *origin = origin_get(asi, as->src.alpnid, as->src.host,
+                                         as->src.port, TRUE);
+  if(!origin || heap_push(asi, as)) {
+    if(origin && !origin->size)
+      origin_drop(asi, as);
+    altsvc_free(as);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  Curl_llist_insert_next(&asi->list, asi->list.tail, as, &as->node);
+  Curl_llist_insert_next(origin, origin->tail, as, &as->onode);
+  origin_grow(asi);
+  return CURLE_OK;
+}
+
+/*
+ * Remove an entry from the cache and free it.
+ */
+static void altsvc_remove(struct altsvcinfo *asi, struct altsvc *as)
+{
+  struct Curl_llist *origin = origin_get(asi, as->src.alpnid, as->src.host,
+                                         as->src.port, FALSE);
+  heap_remove(asi, as);
+  Curl_llist_remove(&asi->list, &as->node, NULL);
+  if(origin) {
+    Curl_llist_remove(origin, &as->onode, NULL);
+    if(!origin->size)
+      origin_drop(asi, as);
+  }
+  altsvc_free(as);
+}
+
+/* remove all entries that have expired by 'now' */
+static void altsvc_expire(struct altsvcinfo *asi, time_t now)
+{
+  while(asi->heapsize && (asi->heap[0]->expires < now))
+    altsvc_remove(asi, asi->heap[0]);
+}
+
 /* only returns SERIOUS errors */
 static CURLcode altsvc_add(struct altsvcinfo *asi, char *line)
 {
@@ -169,7 +378,7 @@ static CURLcode altsvc_add(struct altsvcinfo *asi, char *line)
       as->expires = expires;
       as->prio = prio;
       as->persist = persist ? 1 : 0;
-      Curl_llist_insert_next(&asi->list, asi->list.tail, as, &as->node);
+      (void)altsvc_store(asi, as);
     }
   }
 
@@ -261,6 +470,8 @@ struct altsvcinfo *Curl_altsvc_init(void)
   if(!asi)
     return NULL;
   Curl_llist_init(&asi->list, NULL);
+  Curl_hash_init(&asi->origins, ALTSVC_SLOTS, Curl_hash_str,
+                 Curl_str_key_compare, origin_dtor);
 
   /* set default behavior */
   asi->flags = CURLALTSVC_H1
@@ -308,11 +519,19 @@ void Curl_altsvc_cleanup(struct altsvcinfo **altsvcp)
   struct Curl_llist_element *n;
   if(*altsvcp) {
     struct altsvcinfo *altsvc = *altsvcp;
+    struct Curl_hash_iterator iter;
+    struct Curl_hash_element *he;
     for(e = altsvc->list.head; e; e = n) {
       struct altsvc *as = e->ptr;
       n = e->next;
       altsvc_free(as);
     }
+    Curl_hash_start_iterate(&altsvc->origins, &iter);
+    for(he = Curl_hash_next_element(&iter); he;
+        he = Curl_hash_next_element(&iter))
+      free(he->ptr);
+    Curl_hash_destroy(&altsvc->origins);
+    free(altsvc->heap);
     free(altsvc->filename);
     free(altsvc);
     *altsvcp = NULL; /* clear the pointer */
@@ -386,39 +605,78 @@ static CURLcode getalnum(const char **ptr, char *alpnbuf, size_t buflen)
   return CURLE_OK;
 }
 
-/* hostcompare() returns true if 'host' matches 'check'. The first host
- * argument may have a trailing dot present that will be ignored.
- */
-static bool hostcompare(const char *host, const char *check)
-{
-  size_t hlen = strlen(host);
-  size_t clen = strlen(check);
-
-  if(hlen && (host[hlen - 1] == '.'))
-    hlen--;
-  if(hlen != clen)
-    /* they can't match if they have different lengths */
-    return FALSE;
-  return strncasecompare(host, check, hlen);
-}
-
 /* altsvc_flush() removes all alternatives for this source origin from the
-   list */
+   cache. With 'stale' set, it only removes the ones marked as such. */
 static void altsvc_flush(struct altsvcinfo *asi, enum alpnid srcalpnid,
-                         const char *srchost, unsigned short srcport)
+                         const char *srchost, unsigned short srcport,
+                         bool stale)
 {
+  struct Curl_llist *origin = origin_get(asi, srcalpnid, srchost, srcport,
+                                         FALSE);
   struct Curl_llist_element *e;
   struct Curl_llist_element *n;
-  for(e = asi->list.head; e; e = n) {
+  if(!origin)
+    return;
+  for(e = origin->head; e; e = n) {
     struct altsvc *as = e->ptr;
     n = e->next;
-    if((srcalpnid == as->src.alpnid) &&
-       (srcport == as->src.port) &&
-       hostcompare(srchost, as->src.host)) {
-      Curl_llist_remove(&asi->list, e, NULL);
-      altsvc_free(as);
+    if(!stale || as->stale)
+      /* removing the last one also frees the origin list */
+      altsvc_remove(asi, as);
+  }
+}
+
+/* altsvc_mark() flags all alternatives for this source origin as stale */
+static void altsvc_mark(struct altsvcinfo *asi, enum alpnid srcalpnid,
+                        const char *srchost, unsigned short srcport)
+{
+  struct Curl_llist *origin = origin_get(asi, srcalpnid, srchost, srcport,
+                                         FALSE);
+  struct Curl_llist_element *e;
+  if(origin)
+    for(e = origin->head; e; e = e->next) {
+      struct altsvc *as = e->ptr;
+      as->stale = TRUE;
+    }
+}
+
+/*
+ * altsvc_update() finds a stale alternative for this source origin with the
+ * given destination, and makes it current again with the new values. It is
+ * moved last in the origin's list and in the cache, so that the order of the
+ * header is kept, also in the saved file. Returns the entry or NULL if there
+ * is none.
+ */
+static struct altsvc *altsvc_update(struct altsvcinfo *asi,
+                                    enum alpnid srcalpnid,
+                                    const char *srchost,
+                                    unsigned short srcport,
+                                    enum alpnid dstalpnid,
+                                    const char *dsthost,
+                                    unsigned short dstport,
+                                    time_t expires, bool persist)
+{
+  struct Curl_llist *origin = origin_get(asi, srcalpnid, srchost, srcport,
+                                         FALSE);
+  struct Curl_llist_element *e;
+  if(!origin)
+    return NULL;
+  for(e = origin->head; e; e = e->next) {
+    struct altsvc *as = e->ptr;
+    if(as->stale && (as->dst.alpnid == dstalpnid) &&
+       (as->dst.port == dstport) && strcasecompare(as->dst.host, dsthost)) {
+      as->stale = FALSE;
+      as->persist = persist;
+      as->expires = expires;
+      heap_fix(asi, as->heapidx);
+      Curl_llist_remove(origin, e, NULL);
+      Curl_llist_insert_next(origin, origin->tail, as, &as->onode);
+      Curl_llist_remove(&asi->list, &as->node, NULL);
+      Curl_llist_insert_next(&asi->list, asi->list.tail, as, &as->node);
+      return as;
     }
   }
+  return NULL;
 }
 
 #ifdef DEBUGBUILD
@@ -476,7 +734,7 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
   /* "clear" is a magic keyword */
   if(strcasecompare(alpnbuf, "clear")) {
     /* Flush cached alternatives for this source origin */
-    altsvc_flush(asi, srcalpnid, srchost, srcport);
+    altsvc_flush(asi, srcalpnid, srchost, srcport, FALSE);
     return CURLE_OK;
   }
 
@@ -553,12 +811,12 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
           while(*p && ISBLANK(*p))
             p++;
           if(*p != '=')
-            return CURLE_OK;
+            goto done;
           p++;
           while(*p && ISBLANK(*p))
             p++;
           if(!*p)
-            return CURLE_OK;
+            goto done;
           if(*p == '\"') {
             /* quoted value */
             p++;
@@ -569,7 +827,7 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
             while(*p && *p != '\"')
               p++;
             if(!*p++)
-              return CURLE_OK;
+              goto done;
           }
           else {
             while(*p && !ISBLANK(*p) && *p!= ';' && *p != ',')
@@ -584,22 +842,30 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
           }
         }
         if(dstalpnid && valid) {
+          /* The expires time also needs to take the Age: value (if any) into
+             account. [See RFC 7838 section 3.1] */
+          time_t expires = maxage + time(NULL);
           if(!entries++)
-            /* Flush cached alternatives for this source origin, if any - when
-               this is the first entry of the line. */
-            altsvc_flush(asi, srcalpnid, srchost, srcport);
-
-          as = altsvc_createid(srchost, dsthost,
-                               srcalpnid, dstalpnid,
-                               srcport, dstport);
-          if(as) {
-            /* The expires time also needs to take the Age: value (if any) into
-               account. [See RFC 7838 section 3.1] */
-            as->expires = maxage + time(NULL);
-            as->persist = persist;
-            Curl_llist_insert_next(&asi->list, asi->list.tail, as, &as->node);
-            infof(data, "Added alt-svc: %s:%d over %s", dsthost, dstport,
+            /* The cached alternatives for this source origin, if any, are
+               replaced by this line. Mark them and remove the ones that are
+               not repeated once the line is done. */
+            altsvc_mark(asi, srcalpnid, srchost, srcport);
+
+          if(altsvc_update(asi, srcalpnid, srchost, srcport,
+                           dstalpnid, dsthost, dstport, expires, persist))
+            infof(data, "Updated alt-svc: %s:%d over %s", dsthost, dstport,
                   Curl_alpnid2str(dstalpnid));
+          else {
+            as = altsvc_createid(srchost, dsthost,
+                                 srcalpnid, dstalpnid,
+                                 srcport, dstport);
+            if(as) {
+              as->expires = expires;
+              as->persist = persist;
+              if(!altsvc_store(asi, as))
+                infof(data, "Added alt-svc: %s:%d over %s", dsthost, dstport,
+                      Curl_alpnid2str(dstalpnid));
+            }
           }
         }
       }
@@ -619,6 +885,10 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
       break;
   } while(*p && (*p != ';') && (*p != '\n') && (*p != '\r'));
 
+  done:
+  if(entries)
+    /* remove the previous alternatives that were not repeated */
+    altsvc_flush(asi, srcalpnid, srchost, srcport, TRUE);
   return CURLE_OK;
 }
 
@@ -631,31 +901,25 @@ bool Curl_altsvc_lookup(struct altsvcinfo *asi,
                         struct altsvc **dstentry,
                         const int versions) /* one or more bits */
 {
+  struct Curl_llist *origin;
   struct Curl_llist_element *e;
-  struct Curl_llist_element *n;
-  time_t now = time(NULL);
   DEBUGASSERT(asi);
   DEBUGASSERT(srchost);
   DEBUGASSERT(dstentry);
 
-  for(e = asi->list.head; e; e = n) {
-    struct altsvc *as = e->ptr;
-    n = e->next;
-    if(as->expires < now) {
-      /* an expired entry, remove */
-      Curl_llist_remove(&asi->list, e, NULL);
-      altsvc_free(as);
-      continue;
-    }
-    if((as->src.alpnid == srcalpnid) &&
-       hostcompare(srchost, as->src.host) &&
-       (as->src.port == srcport) &&
-       (versions & as->dst.alpnid)) {
-      /* match */
-      *dstentry = as;
-      return TRUE;
+  /* remove expired entries */
+  altsvc_expire(asi, time(NULL));
+
+  origin = origin_get(asi, srcalpnid, srchost, (unsigned int)srcport, FALSE);
+  if(origin)
+    for(e = origin->head; e; e = e->next) {
+      struct altsvc *as = e->ptr;
+      if(versions & as->dst.alpnid) {
+        /* match */
+        *dstentry = as;
+        return TRUE;
+      }
     }
-  }
   return FALSE;
 }
 
@@ -28,6 +28,7 @@
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_ALTSVC)
 #include <curl/curl.h>
 #include "llist.h"
+#include "hash.h"
 
 enum alpnid {
   ALPN_none = 0,
@@ -47,13 +48,20 @@ struct altsvc {
   struct althost dst;
   time_t expires;
   bool persist;
+  bool stale; /* not repeated (yet) by the latest header for its origin */
   int prio;
+  size_t heapidx; /* position in the expiry heap */
   struct Curl_llist_element node;
+  struct Curl_llist_element onode; /* in the list of its source origin */
 };
 
 struct altsvcinfo {
   char *filename;
   struct Curl_llist list; /* list of entries */
+  struct Curl_hash origins; /* entry lists per source origin */
+  struct altsvc **heap; /* the entries as a min-heap on expiry time */
+  size_t heapsize; /* number of entries in the heap */
+  size_t heapalloc; /* number of allocated heap slots */
   long flags; /* the publicly set bitmask */
 };
 
@@ -0,0 +1,152 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+#include "arena.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+/* all allocations are aligned to this */
+union arena_align {
+  curl_off_t o;
+  double d;
+  void *p;
+};
+
+#define ARENA_ALIGN sizeof(union arena_align)
+#define ARENA_DEFAULT_CHUNK 4096
+
+struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size; /* size of 'mem' */
+  size_t used; /* number of bytes handed out from 'mem' */
+  union arena_align mem[1]; /* allocated memory following the struct */
+};
+
+void Curl_arena_init(struct Curl_arena *a, size_t chunksize)
+{
+  DEBUGASSERT(a);
+  a->head = NULL;
+  a->chunksize = chunksize;
+}
+
+static struct arena_chunk *chunk_new(size_t size)
+{
+  struct arena_chunk *c = malloc(sizeof(*c) + size);
+  if(c) {
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+  }
+  return c;
+}
+
+/*
+ * Return a pointer to 'size' bytes of uninitialized memory that stays valid
+ * until the arena is released. Returns NULL on OOM.
+ */
+void *Curl_arena_alloc(struct Curl_arena *a, size_t size)
+{
+  struct arena_chunk *c = a->head;
+  size_t chunksize = a->chunksize ? a->chunksize : ARENA_DEFAULT_CHUNK;
+  char *p;
+
+  DEBUGASSERT(size);
+#ifdef CURLDEBUG
+  /* let the memory limit of the torture tests fail this allocation */
+  if(curl_dbg_arena(size, __LINE__, __FILE__))
+    return NULL;
+#endif
+
+  /* round up to keep the next allocation aligned */
+  if(size > SIZE_T_MAX - ARENA_ALIGN)
+    return NULL;
+  size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+  if(!c || (c->size - c->used < size)) {
+    if(size > chunksize / 4) {
+      /* a big one gets a chunk of its own, which is put after the current
+         one so that the remaining space in that is not wasted */
+      struct arena_chunk *big = chunk_new(size);
+      if(!big)
+        return NULL;
+      big->used = size;
+      if(c) {
+        big->next = c->next;
+        c->next = big;
+      }
+      else
+        a->head = big;
+      return big->mem;
+    }
+    c = chunk_new(chunksize);
+    if(!c)
+      return NULL;
+    c->next = a->head;
+    a->head = c;
+  }
+
+  p = (char *)c->mem + c->used;
+  c->used += size;
+  return p;
+}
+
+void *Curl_arena_calloc(struct Curl_arena *a, size_t size)
+{
+  void *p = Curl_arena_alloc(a, size);
+  if(p)
+    memset(p, 0, size);
+  return p;
+}
+
+void *Curl_arena_memdup(struct Curl_arena *a, const void *src, size_t len)
+{
+  void *p = Curl_arena_alloc(a, len);
+  if(p)
+    memcpy(p, src, len);
+  return p;
+}
+
+char *Curl_arena_strdup(struct Curl_arena *a, const char *str)
+{
+  return Curl_arena_memdup(a, str, strlen(str) + 1);
+}
+
+/*
+ * Free all memory allocated from the arena. The arena can be used again
+ * afterwards.
+ */
+void Curl_arena_release(struct Curl_arena *a)
+{
+  struct arena_chunk *c = a->head;
+  while(c) {
+    struct arena_chunk *next = c->next;
+    free(c);
+    c = next;
+  }
+  a->head = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef HEADER_CURL_ARENA_H
+#define HEADER_CURL_ARENA_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+/*
+ * A bump allocator for short-lived objects that all go away at the same
+ * time. Allocations are carved out of larger chunks and are never freed one
+ * by one, all of them are released together by Curl_arena_release().
+ *
+ * A zeroed struct is an initialized arena using the default chunk size.
+ */
+struct arena_chunk;
+
+struct Curl_arena {
+  struct arena_chunk *head; /* the chunk allocations are made from */
+  size_t chunksize;         /* size of new chunks, 0 means default */
+};
+
+void Curl_arena_init(struct Curl_arena *a, size_t chunksize);
+void *Curl_arena_alloc(struct Curl_arena *a, size_t size);
+void *Curl_arena_calloc(struct Curl_arena *a, size_t size);
+void *Curl_arena_memdup(struct Curl_arena *a, const void *src, size_t len);
+char *Curl_arena_strdup(struct Curl_arena *a, const char *str);
+void Curl_arena_release(struct Curl_arena *a);
+
+#endif /* HEADER_CURL_ARENA_H */
@@ -31,12 +31,26 @@
   !defined(CURL_DISABLE_SMTP) || \
   !defined(CURL_DISABLE_POP3) || \
   !defined(CURL_DISABLE_IMAP) || \
-  !defined(CURL_DISABLE_DOH) || defined(USE_SSL)
+  !defined(CURL_DISABLE_DOH) || defined(USE_SSL) || \
+  !defined(CURL_DISABLE_MIME)
 
 #include "urldata.h" /* for the Curl_easy definition */
 #include "warnless.h"
 #include "curl_base64.h"
 
+/* Vectorized kernels. On x86 they are built with per-function target
+   attributes and picked at run-time, so no special compiler flags are
+   needed. NEON is always present on aarch64. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+  ((defined(__clang__) && (__clang_major__ >= 4)) || \
+   (!defined(__clang__) && (__GNUC__ >= 5)))
+#define USE_BASE64_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_BASE64_NEON
+#include <arm_neon.h>
+#endif
+
 /* The last 2 #include files should be in this order */
 #include "curl_memory.h"
 #include "memdebug.h"
@@ -57,6 +71,342 @@ static const unsigned char decodetable[] =
   17, 18, 19, 20, 21, 22, 23, 24, 25, 255, 255, 255, 255, 255, 255, 26, 27, 28,
   29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
   48, 49, 50, 51 };
+
+#ifdef DEBUGBUILD
+/* set by the unit tests to compare against the plain C code */
+bool Curl_base64_scalar;
+#endif
+
+#ifdef USE_BASE64_X86
+/*
+ * The x86 kernels follow the approach described by Wojciech Muła and
+ * Daniel Lemire: shuffle each 3-byte group into a 32-bit lane, split it
+ * into four 6-bit indexes with two multiplies and map the indexes to
+ * characters with a 16-entry offset table. Decoding validates each
+ * character by its nibbles and packs the values back with two
+ * multiply-adds.
+ */
+
+/* Encode 12 bytes into 16 characters per round. Each round loads 16 bytes
+   so 16 must remain. */
+__attribute__((target("ssse3")))
+static size_t encode_ssse3(const char *table64, const unsigned char *in,
+                           size_t insize, char *out)
+{
+  const __m128i shuf = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                     7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52,
+                                        (char)(table64[62] - 62),
+                                        (char)(table64[63] - 63),
+                                        'A', 0, 0);
+  size_t done = 0;
+
+  while(insize - done >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(in + done));
+    __m128i t0, t1, cls;
+
+    v = _mm_shuffle_epi8(v, shuf);
+    t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)),
+                         _mm_set1_epi32(0x04000040));
+    t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)),
+                         _mm_set1_epi32(0x01000010));
+    v = _mm_or_si128(t0, t1);
+
+    /* 0-25 map to class 13, 26-51 to 0, 52-61 to 1-10, 62 and 63 to 11
+       and 12 */
+    cls = _mm_subs_epu8(v, _mm_set1_epi8(51));
+    cls = _mm_or_si128(cls, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26),
+                                                         v),
+                                          _mm_set1_epi8(13)));
+    v = _mm_add_epi8(v, _mm_shuffle_epi8(offsets, cls));
+    _mm_storeu_si128((__m128i *)out, v);
+    out += 16;
+    done += 12;
+  }
+  return done;
+}
+
+/* Encode 24 bytes into 32 characters per round, 12 bytes per lane. The
+   upper lane loads 16 bytes from offset 12 so 28 must remain. */
+__attribute__((target("avx2")))
+static size_t encode_avx2(const char *table64, const unsigned char *in,
+                          size_t insize, char *out)
+{
+  const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                        7, 6, 8, 7, 10, 9, 11, 10,
+                                        1, 0, 2, 1, 4, 3, 5, 4,
+                                        7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets =
+    _mm256_broadcastsi128_si256(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52,
+                                              (char)(table64[62] - 62),
+                                              (char)(table64[63] - 63),
+                                              'A', 0, 0));
+  size_t done = 0;
+
+  while(insize - done >= 28) {
+    __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + done))),
+      _mm_loadu_si128((const __m128i *)(in + done + 12)), 1);
+    __m256i t0, t1, cls;
+
+    v = _mm256_shuffle_epi8(v, shuf);
+    t0 = _mm256_mulhi_epu16(_mm256_and_si256(v,
+                                             _mm256_set1_epi32(0x0fc0fc00)),
+                            _mm256_set1_epi32(0x04000040));
+    t1 = _mm256_mullo_epi16(_mm256_and_si256(v,
+                                             _mm256_set1_epi32(0x003f03f0)),
+                            _mm256_set1_epi32(0x01000010));
+    v = _mm256_or_si256(t0, t1);
+
+    cls = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+    cls = _mm256_or_si256(cls,
+                          _mm256_and_si256(
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v),
+                            _mm256_set1_epi8(13)));
+    v = _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, cls));
+    _mm256_storeu_si256((__m256i *)out, v);
+    out += 32;
+    done += 24;
+  }
+  return done;
+}
+
+/* Lookup tables for the decoders, indexed by the low and the high nibble
+   of a character. A character is valid when its two class bits have
+   nothing in common. 'roll' is the value to add to get the 6-bit value,
+   by high nibble, with '/' moved to slot 1. */
+#define B64_LUT_LO 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,      \
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+#define B64_LUT_HI 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,      \
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define B64_LUT_ROLL 0, 16, 19, 4, -65, -65, -71, -71,                  \
+    0, 0, 0, 0, 0, 0, 0, 0
+
+/* Decode 16 characters into 12 bytes per round. Each round stores 16 bytes
+   so the caller leaves room for that. Stops at the first round holding
+   anything but the 64 plain characters. */
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const char *src, size_t srclen,
+                           unsigned char *out)
+{
+  const __m128i lut_lo = _mm_setr_epi8(B64_LUT_LO);
+  const __m128i lut_hi = _mm_setr_epi8(B64_LUT_HI);
+  const __m128i lut_roll = _mm_setr_epi8(B64_LUT_ROLL);
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                     8, 14, 13, 12, -1, -1, -1, -1);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  size_t done = 0;
+
+  while(srclen - done >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + done));
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), nibble);
+    __m128i lo = _mm_and_si128(v, nibble);
+    __m128i bad = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo),
+                                _mm_shuffle_epi8(lut_hi, hi));
+    __m128i roll;
+
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff)
+      break;
+    roll = _mm_add_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), hi);
+    v = _mm_add_epi8(v, _mm_shuffle_epi8(lut_roll, roll));
+
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    v = _mm_shuffle_epi8(v, pack);
+    _mm_storeu_si128((__m128i *)out, v);
+    out += 12;
+    done += 16;
+  }
+  return done;
+}
+
+/* Decode 32 characters into 24 bytes per round, storing 32 bytes. */
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char *src, size_t srclen, unsigned char *out)
+{
+  const __m256i lut_lo = _mm256_setr_epi8(B64_LUT_LO, B64_LUT_LO);
+  const __m256i lut_hi = _mm256_setr_epi8(B64_LUT_HI, B64_LUT_HI);
+  const __m256i lut_roll = _mm256_setr_epi8(B64_LUT_ROLL, B64_LUT_ROLL);
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                        8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9,
+                                        8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  size_t done = 0;
+
+  while(srclen - done >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + done));
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+    __m256i lo = _mm256_and_si256(v, nibble);
+    __m256i roll;
+
+    if(!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo),
+                           _mm256_shuffle_epi8(lut_hi, hi)))
+      break;
+    roll = _mm256_add_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), hi);
+    v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut_roll, roll));
+
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, pack);
+    v = _mm256_permutevar8x32_epi32(v, lanes);
+    _mm256_storeu_si256((__m256i *)out, v);
+    out += 24;
+    done += 32;
+  }
+  return done;
+}
+#endif /* USE_BASE64_X86 */
+
+#ifdef USE_BASE64_NEON
+/* Encode 48 bytes into 64 characters per round. The de-interleaving loads
+   and stores do the shuffling and a 64-entry table lookup maps the
+   indexes, so this handles any alphabet. */
+static size_t encode_neon(const char *table64, const unsigned char *in,
+                          size_t insize, char *out)
+{
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  uint8x16x4_t table;
+  size_t done = 0;
+
+  table.val[0] = vld1q_u8((const uint8_t *)table64);
+  table.val[1] = vld1q_u8((const uint8_t *)table64 + 16);
+  table.val[2] = vld1q_u8((const uint8_t *)table64 + 32);
+  table.val[3] = vld1q_u8((const uint8_t *)table64 + 48);
+
+  while(insize - done >= 48) {
+    uint8x16x3_t v = vld3q_u8(in + done);
+    uint8x16x4_t c;
+
+    c.val[0] = vshrq_n_u8(v.val[0], 2);
+    c.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(v.val[1], 4),
+                                 vshlq_n_u8(v.val[0], 4)), mask);
+    c.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(v.val[2], 6),
+                                 vshlq_n_u8(v.val[1], 2)), mask);
+    c.val[3] = vandq_u8(v.val[2], mask);
+    c.val[0] = vqtbl4q_u8(table, c.val[0]);
+    c.val[1] = vqtbl4q_u8(table, c.val[1]);
+    c.val[2] = vqtbl4q_u8(table, c.val[2]);
+    c.val[3] = vqtbl4q_u8(table, c.val[3]);
+    vst4q_u8((uint8_t *)out, c);
+    out += 64;
+    done += 48;
+  }
+  return done;
+}
+
+/* Decode 64 characters into 48 bytes per round using the 128 first entries
+   of the scalar lookup table. Stops at the first round holding anything but
+   the 64 plain characters. */
+static size_t decode_neon(const char *src, size_t srclen, unsigned char *out,
+                          const unsigned char *lookup)
+{
+  const uint8x16_t upper = vdupq_n_u8(64);
+  const uint8x16_t ascii = vdupq_n_u8(0x7f);
+  uint8x16x4_t lut_lo;
+  uint8x16x4_t lut_hi;
+  size_t done = 0;
+  int i;
+
+  for(i = 0; i < 4; i++) {
+    lut_lo.val[i] = vld1q_u8(lookup + i * 16);
+    lut_hi.val[i] = vld1q_u8(lookup + 64 + i * 16);
+  }
+
+  while(srclen - done >= 64) {
+    uint8x16x4_t v = vld4q_u8((const uint8_t *)src + done);
+    uint8x16x3_t o;
+    uint8x16_t bad = vdupq_n_u8(0);
+
+    for(i = 0; i < 4; i++) {
+      /* the second lookup only hits for 64-127, the compare flags 128+ */
+      uint8x16_t c = vqtbl4q_u8(lut_lo, v.val[i]);
+      c = vqtbx4q_u8(c, lut_hi, vsubq_u8(v.val[i], upper));
+      bad = vorrq_u8(bad, vorrq_u8(c, vcgtq_u8(v.val[i], ascii)));
+      v.val[i] = c;
+    }
+    if(vmaxvq_u8(bad) > 63)
+      break;
+
+    o.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+    o.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+    o.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+    vst3q_u8(out, o);
+    out += 48;
+    done += 64;
+  }
+  return done;
+}
+#endif /* USE_BASE64_NEON */
+
+/*
+ * Encode as many complete 3-byte groups as the vector code handles and
+ * return the number of input bytes used. The rest is left to the caller.
+ */
+static size_t encode_accel(const char *table64, const unsigned char *in,
+                           size_t insize, char *out)
+{
+  size_t done = 0;
+#ifdef DEBUGBUILD
+  if(Curl_base64_scalar)
+    return 0;
+#endif
+#if defined(USE_BASE64_X86)
+  if(__builtin_cpu_supports("avx2"))
+    done = encode_avx2(table64, in, insize, out);
+  if(__builtin_cpu_supports("ssse3"))
+    done += encode_ssse3(table64, in + done, insize - done,
+                         out + done / 3 * 4);
+#elif defined(USE_BASE64_NEON)
+  done = encode_neon(table64, in, insize, out);
+#else
+  (void)table64;
+  (void)in;
+  (void)insize;
+  (void)out;
+#endif
+  return done;
+}
+
+/*
+ * Decode as many complete quantums of plain characters as the vector code
+ * handles and return the number of characters used. The x86 kernels store
+ * whole vectors, so the output buffer must have room for 8 bytes more than
+ * 'srclen' * 3 / 4. The rest, including any bad character, is left to the
+ * caller.
+ */
+static size_t decode_accel(const char *src, size_t srclen,
+                           unsigned char *out, const unsigned char *lookup)
+{
+  size_t done = 0;
+#ifdef DEBUGBUILD
+  if(Curl_base64_scalar)
+    return 0;
+#endif
+#if defined(USE_BASE64_X86)
+  (void)lookup;
+  if(__builtin_cpu_supports("avx2"))
+    done = decode_avx2(src, srclen, out);
+  if(__builtin_cpu_supports("ssse3"))
+    done += decode_ssse3(src + done, srclen - done, out + done / 4 * 3);
+#elif defined(USE_BASE64_NEON)
+  done = decode_neon(src, srclen, out, lookup);
+#else
+  (void)src;
+  (void)srclen;
+  (void)out;
+  (void)lookup;
+#endif
+  return done;
+}
+
 /*
  * Curl_base64_decode()
  *
@@ -126,8 +476,15 @@ CURLcode Curl_base64_decode(const char *src,
   }
   */
 
-  /* Decode the complete quantums first */
-  for(i = 0; i < fullQuantums; i++) {
+  /* Decode the complete quantums first, leaving the last three to the
+     loop to give the vector code its slack */
+  i = 0;
+  if(fullQuantums > 3) {
+    i = decode_accel(src, (fullQuantums - 3) * 4, pos, lookup) / 4;
+    src += i * 4;
+    pos += i * 3;
+  }
+  for(; i < fullQuantums; i++) {
     unsigned char val;
     unsigned int x = 0;
     int j;
@@ -183,6 +540,26 @@ CURLcode Curl_base64_decode(const char *src,
   return CURLE_BAD_CONTENT_ENCODING;
 }
 
+/* Encode all complete 3-byte groups, returns the number of characters */
+static size_t encode_groups(const char *table64, const unsigned char *in,
+                            size_t insize, char *out)
+{
+  size_t done = encode_accel(table64, in, insize, out);
+  char *output = out + done / 3 * 4;
+
+  in += done;
+  insize -= done;
+  while(insize >= 3) {
+    *output++ = table64[ in[0] >> 2 ];
+    *output++ = table64[ ((in[0] & 0x03) << 4) | (in[1] >> 4) ];
+    *output++ = table64[ ((in[1] & 0x0F) << 2) | ((in[2] & 0xC0) >> 6) ];
+    *output++ = table64[ in[2] & 0x3F ];
+    insize -= 3;
+    in += 3;
+  }
+  return (size_t)(output - out);
+}
+
 static CURLcode base64_encode(const char *table64,
                               const char *inputbuff, size_t insize,
                               char **outptr, size_t *outlen)
@@ -207,14 +584,9 @@ static CURLcode base64_encode(const char *table64,
   if(!output)
     return CURLE_OUT_OF_MEMORY;
 
-  while(insize >= 3) {
-    *output++ = table64[ in[0] >> 2 ];
-    *output++ = table64[ ((in[0] & 0x03) << 4) | (in[1] >> 4) ];
-    *output++ = table64[ ((in[1] & 0x0F) << 2) | ((in[2] & 0xC0) >> 6) ];
-    *output++ = table64[ in[2] & 0x3F ];
-    insize -= 3;
-    in += 3;
-  }
+  output += encode_groups(table64, in, insize, output);
+  in += insize / 3 * 3;
+  insize %= 3;
   if(insize) {
     /* this is only one or two bytes now */
     *output++ = table64[ in[0] >> 2 ];
@@ -288,4 +660,17 @@ CURLcode Curl_base64url_encode(const char *inputbuff, size_t insize,
   return base64_encode(base64url, inputbuff, insize, outptr, outlen);
 }
 
+/*
+ * Curl_base64_encode_block()
+ *
+ * Encode the complete 3-byte groups of the 'insize' bytes at 'in' into
+ * 'out', without padding or zero termination. 'out' must have room for
+ * 'insize' / 3 * 4 characters. Returns the number of characters stored.
+ */
+size_t Curl_base64_encode_block(const unsigned char *in, size_t insize,
+                                char *out)
+{
+  return encode_groups(base64, in, insize, out);
+}
+
 #endif /* no users so disabled */
@@ -45,6 +45,7 @@
 #include "content_encoding.h"
 #include "strdup.h"
 #include "strcase.h"
+#include "curl_sha256.h"
 #include "curl_memory.h"
 #include "memdebug.h"
 
@@ -52,7 +53,32 @@
 
 #ifndef CURL_DISABLE_HTTP
 
-#define DSIZ CURL_MAX_WRITE_SIZE /* buffer size for decompressed data */
+/* Buffer size for decompressed data. A bigger buffer than a single client
+   write means fewer trips through the decoder and writer stack per chunk of
+   compressed input. */
+#define DSIZ (4 * CURL_MAX_WRITE_SIZE)
+
+#if defined(HAVE_LIBZ) || defined(HAVE_BROTLI) || defined(HAVE_ZSTD)
+/* Get the writer its output buffer. It is kept for the life of the writer and
+   handed back to the easy handle on cleanup, so that a handle doing many
+   compressed transfers does not allocate one per response. */
+static CURLcode decomp_alloc(struct Curl_easy *data,
+                             struct contenc_writer *writer)
+{
+  if(!writer->decomp) {
+    if(data->state.decbuf) {
+      writer->decomp = data->state.decbuf;
+      data->state.decbuf = NULL;
+    }
+    else {
+      writer->decomp = malloc(DSIZ);
+      if(!writer->decomp)
+        return CURLE_OUT_OF_MEMORY;
+    }
+  }
+  return CURLE_OK;
+}
+#endif
 
 
 #ifdef HAVE_LIBZ
@@ -178,11 +204,10 @@ static CURLcode inflate_stream(struct Curl_easy *data,
      zp->zlib_init != ZLIB_GZIP_INFLATING)
     return exit_zlib(data, z, &zp->zlib_init, CURLE_WRITE_ERROR);
 
-  /* Dynamically allocate a buffer for decompression because it's uncommonly
-     large to hold on the stack */
-  decomp = malloc(DSIZ);
-  if(!decomp)
+  /* The buffer for decompression is uncommonly large to hold on the stack */
+  if(decomp_alloc(data, writer))
     return exit_zlib(data, z, &zp->zlib_init, CURLE_OUT_OF_MEMORY);
+  decomp = writer->decomp;
 
   /* because the buffer size is fixed, iteratively decompress and transfer to
      the client via downstream_write function. */
@@ -250,7 +275,6 @@ static CURLcode inflate_stream(struct Curl_easy *data,
       break;
     }
   }
-  free(decomp);
 
   /* We're about to leave this call so the `nread' data bytes won't be seen
      again. If we are in a state that would wrongly allow restart in raw mode
@@ -658,9 +682,9 @@ static CURLcode brotli_unencode_write(struct Curl_easy *data,
   if(!bp->br)
     return CURLE_WRITE_ERROR;  /* Stream already ended. */
 
-  decomp = malloc(DSIZ);
-  if(!decomp)
+  if(decomp_alloc(data, writer))
     return CURLE_OUT_OF_MEMORY;
+  decomp = writer->decomp;
 
   while((nbytes || r == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) &&
         result == CURLE_OK) {
@@ -687,7 +711,6 @@ static CURLcode brotli_unencode_write(struct Curl_easy *data,
       break;
     }
   }
-  free(decomp);
   return result;
 }
 
@@ -716,31 +739,224 @@ static const struct content_encoding brotli_encoding = {
 
 
 #ifdef HAVE_ZSTD
+#ifndef CURL_DISABLE_CRYPTO_AUTH
+/* "dcz" is zstd with a dictionary picked by its SHA-256 hash, see the
+   Compression Dictionary Transport draft. */
+#define USE_DCZ
+
+static const unsigned char dcz_magic[] = {
+  0x5e, 0x2a, 0x4d, 0x18, 0x20, 0x00, 0x00, 0x00
+};
+#define DCZ_HEADER_LEN (sizeof(dcz_magic) + SHA256_DIGEST_LENGTH)
+#define ZSTD_HEAD_MAX DCZ_HEADER_LEN
+#else
+#define ZSTD_HEAD_MAX 18 /* largest zstd frame header */
+#endif
+
+/* A zstd dictionary, ready to decode with. */
+struct zstd_dict {
+  ZSTD_DDict *ddict;
+  unsigned int id;           /* dictionary ID, 0 for raw content */
+#ifdef USE_DCZ
+  unsigned char hash[SHA256_DIGEST_LENGTH];
+#endif
+};
+
+/* The dictionaries of an easy handle, loaded on first use. */
+struct Curl_zstd_dicts {
+  struct zstd_dict *dict;
+  size_t count;
+};
+
 /* Zstd writer. */
 struct zstd_writer {
   struct contenc_writer super;
   ZSTD_DStream *zds;    /* State structure for zstd. */
-  void *decomp;
+  bool dcz;             /* The frame follows a dcz header. */
+  bool started;         /* Dictionary picked, decoding. */
+  size_t headlen;       /* Amount of data in head. */
+  unsigned char head[ZSTD_HEAD_MAX]; /* Start of the stream. */
 };
 
+void Curl_zstd_dicts_free(struct Curl_easy *data)
+{
+  struct Curl_zstd_dicts *zd = data->state.zstd_dicts;
+
+  if(zd) {
+    size_t i;
+    for(i = 0; i < zd->count; i++)
+      ZSTD_freeDDict(zd->dict[i].ddict);
+    free(zd->dict);
+    free(zd);
+    data->state.zstd_dicts = NULL;
+  }
+}
+
+static CURLcode zstd_dict_add(struct Curl_easy *data,
+                              struct Curl_zstd_dicts *zd,
+                              const void *buf, size_t len)
+{
+  struct zstd_dict *d = &zd->dict[zd->count];
+
+  d->ddict = len? ZSTD_createDDict(buf, len): NULL;
+  if(!d->ddict) {
+    failf(data, "Bad zstd dictionary");
+    return CURLE_BAD_FUNCTION_ARGUMENT;
+  }
+  zd->count++;
+  d->id = ZSTD_getDictID_fromDDict(d->ddict);
+#ifdef USE_DCZ
+  return Curl_sha256it(d->hash, buf, len);
+#else
+  return CURLE_OK;
+#endif
+}
+
+static CURLcode zstd_dict_file(struct Curl_easy *data,
+                               struct Curl_zstd_dicts *zd,
+                               const char *file)
+{
+  CURLcode result = CURLE_OK;
+  struct dynbuf buf;
+  char chunk[1024];
+  size_t n;
+  FILE *fp = fopen(file, "rb");
+
+  if(!fp) {
+    failf(data, "Failed to open zstd dictionary %s", file);
+    return CURLE_READ_ERROR;
+  }
+  Curl_dyn_init(&buf, CURL_MAX_INPUT_LENGTH);
+  while(!result && (n = fread(chunk, 1, sizeof(chunk), fp)))
+    result = Curl_dyn_addn(&buf, chunk, n);
+  if(!result && ferror(fp))
+    result = CURLE_READ_ERROR;
+  fclose(fp);
+  if(result)
+    failf(data, "Failed to read zstd dictionary %s", file);
+  else
+    result = zstd_dict_add(data, zd, Curl_dyn_ptr(&buf), Curl_dyn_len(&buf));
+  Curl_dyn_free(&buf);
+  return result;
+}
+
+/* Load the dictionaries set with CURLOPT_ZSTD_DICTIONARIES and
+   CURLOPT_ZSTD_DICTIONARY_BLOB, unless already done. */
+static CURLcode zstd_dicts_load(struct Curl_easy *data)
+{
+  CURLcode result = CURLE_OK;
+  struct curl_blob *blob = data->set.blobs[BLOB_ZSTD_DICT];
+  struct curl_slist *item;
+  struct Curl_zstd_dicts *zd;
+  size_t n = blob? 1: 0;
+
+  if(data->state.zstd_dicts)
+    return CURLE_OK;
+  for(item = data->set.zstd_dicts; item; item = item->next)
+    n++;
+  if(!n)
+    return CURLE_OK;
+
+  zd = calloc(1, sizeof(*zd));
+  if(!zd)
+    return CURLE_OUT_OF_MEMORY;
+  data->state.zstd_dicts = zd;
+  zd->dict = calloc(n, sizeof(struct zstd_dict));
+  if(!zd->dict)
+    result = CURLE_OUT_OF_MEMORY;
+
+  for(item = data->set.zstd_dicts; item && !result; item = item->next)
+    result = zstd_dict_file(data, zd, item->data);
+  if(blob && !result)
+    result = zstd_dict_add(data, zd, blob->data, blob->len);
+
+  if(result)
+    Curl_zstd_dicts_free(data);
+  return result;
+}
+
+/* Size of the header of a zstd frame, which tells its dictionary ID. See
+   RFC 8878 section 3.1.1.1. */
+static size_t zstd_headlen(const unsigned char *head, size_t len)
+{
+  static const size_t idsize[] = { 0, 1, 2, 4 };
+  static const size_t fcssize[] = { 0, 2, 4, 8 };
+  unsigned char fhd;
+  size_t n;
+
+  if(len < 5)
+    return 5;
+  fhd = head[4];
+  n = 5 + idsize[fhd & 0x03] + fcssize[fhd >> 6];
+  if(!(fhd & 0x20))
+    n++; /* window descriptor */
+  else if(!(fhd >> 6))
+    n++; /* a single segment frame always has a content size */
+  return n;
+}
+
+/* Reference the dictionary the stream is compressed with, if any. */
+static CURLcode zstd_pick(struct Curl_easy *data, struct zstd_writer *zp)
+{
+  struct Curl_zstd_dicts *zd = data->state.zstd_dicts;
+  const struct zstd_dict *d = NULL;
+  size_t i;
+
+#ifdef USE_DCZ
+  if(zp->dcz) {
+    if(memcmp(zp->head, dcz_magic, sizeof(dcz_magic))) {
+      failf(data, "Bad dcz header");
+      return CURLE_BAD_CONTENT_ENCODING;
+    }
+    for(i = 0; zd && i < zd->count && !d; i++) {
+      if(!memcmp(zd->dict[i].hash, zp->head + sizeof(dcz_magic),
+                 SHA256_DIGEST_LENGTH))
+        d = &zd->dict[i];
+    }
+    if(!d) {
+      failf(data, "No zstd dictionary matches the dcz content");
+      return CURLE_BAD_CONTENT_ENCODING;
+    }
+  }
+  else
+#endif
+  {
+    unsigned int id = ZSTD_getDictID_fromFrame(zp->head, zp->headlen);
+
+    for(i = 0; zd && i < zd->count && !d; i++) {
+      if(zd->dict[i].id == id)
+        d = &zd->dict[i];
+    }
+    if(!d) {
+      if(!id)
+        return CURLE_OK; /* no dictionary used */
+      failf(data, "No zstd dictionary with ID %u", id);
+      return CURLE_BAD_CONTENT_ENCODING;
+    }
+  }
+
+  if(ZSTD_isError(ZSTD_DCtx_refDDict(zp->zds, d->ddict)))
+    return CURLE_BAD_CONTENT_ENCODING;
+  return CURLE_OK;
+}
+
 static CURLcode zstd_init_writer(struct Curl_easy *data,
                                  struct contenc_writer *writer)
 {
   struct zstd_writer *zp = (struct zstd_writer *) writer;
 
-  (void)data;
-
   if(!writer->downstream)
     return CURLE_WRITE_ERROR;
 
   zp->zds = ZSTD_createDStream();
-  zp->decomp = NULL;
+  /* without dictionaries, decode right away */
+  zp->started = !data->set.zstd_dicts && !data->set.blobs[BLOB_ZSTD_DICT];
   return zp->zds ? CURLE_OK : CURLE_OUT_OF_MEMORY;
 }
 
-static CURLcode zstd_unencode_write(struct Curl_easy *data,
-                                    struct contenc_writer *writer,
-                                    const char *buf, size_t nbytes)
+static CURLcode zstd_decode(struct Curl_easy *data,
+                            struct contenc_writer *writer,
+                            const char *buf, size_t nbytes)
 {
   CURLcode result = CURLE_OK;
   struct zstd_writer *zp = (struct zstd_writer *) writer;
@@ -748,18 +964,15 @@ static CURLcode zstd_unencode_write(struct Curl_easy *data,
   ZSTD_outBuffer out;
   size_t errorCode;
 
-  if(!zp->decomp) {
-    zp->decomp = malloc(DSIZ);
-    if(!zp->decomp)
-      return CURLE_OUT_OF_MEMORY;
-  }
+  if(decomp_alloc(data, writer))
+    return CURLE_OUT_OF_MEMORY;
   in.pos = 0;
   in.src = buf;
   in.size = nbytes;
 
   for(;;) {
     out.pos = 0;
-    out.dst = zp->decomp;
+    out.dst = writer->decomp;
     out.size = DSIZ;
 
     errorCode = ZSTD_decompressStream(zp->zds, &out, &in);
@@ -768,7 +981,7 @@ static CURLcode zstd_unencode_write(struct Curl_easy *data,
     }
     if(out.pos > 0) {
       result = Curl_unencode_write(data, writer->downstream,
-                                   zp->decomp, out.pos);
+                                   writer->decomp, out.pos);
       if(result)
         break;
     }
@@ -779,6 +992,51 @@ static CURLcode zstd_unencode_write(struct Curl_easy *data,
   return result;
 }
 
+static CURLcode zstd_unencode_write(struct Curl_easy *data,
+                                    struct contenc_writer *writer,
+                                    const char *buf, size_t nbytes)
+{
+  CURLcode result;
+  struct zstd_writer *zp = (struct zstd_writer *) writer;
+
+  if(!zp->started) {
+    /* Hold back the start of the stream until it tells the dictionary */
+    result = zstd_dicts_load(data);
+    if(result)
+      return result;
+    for(;;) {
+      size_t need = zstd_headlen(zp->head, zp->headlen);
+      size_t n;
+#ifdef USE_DCZ
+      if(zp->dcz)
+        need = DCZ_HEADER_LEN;
+#endif
+      if(zp->headlen >= need)
+        break;
+      if(!nbytes)
+        return CURLE_OK;
+      n = CURLMIN(need - zp->headlen, nbytes);
+      memcpy(zp->head + zp->headlen, buf, n);
+      zp->headlen += n;
+      buf += n;
+      nbytes -= n;
+    }
+    result = zstd_pick(data, zp);
+    if(result)
+      return result;
+    zp->started = TRUE;
+    if(!zp->dcz) {
+      result = zstd_decode(data, writer, (char *) zp->head, zp->headlen);
+      if(result)
+        return result;
+    }
+    if(!nbytes)
+      return CURLE_OK;
+  }
+
+  return zstd_decode(data, writer, buf, nbytes);
+}
+
 static void zstd_close_writer(struct Curl_easy *data,
                               struct contenc_writer *writer)
 {
@@ -786,10 +1044,6 @@ static void zstd_close_writer(struct Curl_easy *data,
 
   (void)data;
 
-  if(zp->decomp) {
-    free(zp->decomp);
-    zp->decomp = NULL;
-  }
   if(zp->zds) {
     ZSTD_freeDStream(zp->zds);
     zp->zds = NULL;
@@ -804,6 +1058,29 @@ static const struct content_encoding zstd_encoding = {
   zstd_close_writer,
   sizeof(struct zstd_writer)
 };
+
+#ifdef USE_DCZ
+/* Dcz handler. */
+static CURLcode dcz_init_writer(struct Curl_easy *data,
+                                struct contenc_writer *writer)
+{
+  struct zstd_writer *zp = (struct zstd_writer *) writer;
+  CURLcode result = zstd_init_writer(data, writer);
+
+  zp->dcz = TRUE;
+  zp->started = FALSE;
+  return result;
+}
+
+static const struct content_encoding dcz_encoding = {
+  "dcz",
+  NULL,
+  dcz_init_writer,
+  zstd_unencode_write,
+  zstd_close_writer,
+  sizeof(struct zstd_writer)
+};
+#endif
 #endif
 
 
@@ -851,11 +1128,22 @@ static const struct content_encoding * const encodings[] = {
 #endif
 #ifdef HAVE_ZSTD
   &zstd_encoding,
+#ifdef USE_DCZ
+  &dcz_encoding,
+#endif
 #endif
   NULL
 };
 
 
+/* Tell if the encoding goes in the default Accept-Encoding list. dcz is
+   only to be asked for along with an Available-Dictionary header. */
+static bool advertised(const struct content_encoding *ce)
+{
+  return !strcasecompare(ce->name, CONTENT_ENCODING_DEFAULT) &&
+    strcmp(ce->name, "dcz");
+}
+
 /* Return a list of comma-separated names of supported encodings. */
 char *Curl_all_content_encodings(void)
 {
@@ -866,7 +1154,7 @@ char *Curl_all_content_encodings(void)
 
   for(cep = encodings; *cep; cep++) {
     ce = *cep;
-    if(!strcasecompare(ce->name, CONTENT_ENCODING_DEFAULT))
+    if(advertised(ce))
       len += strlen(ce->name) + 2;
   }
 
@@ -878,7 +1166,7 @@ char *Curl_all_content_encodings(void)
     char *p = ace;
     for(cep = encodings; *cep; cep++) {
       ce = *cep;
-      if(!strcasecompare(ce->name, CONTENT_ENCODING_DEFAULT)) {
+      if(advertised(ce)) {
         strcpy(p, ce->name);
         p += strlen(p);
         *p++ = ',';
@@ -1006,9 +1294,22 @@ CURLcode Curl_unencode_write(struct Curl_easy *data,
 {
   if(!nbytes)
     return CURLE_OK;
+  writer->bytes_in += nbytes;
   return writer->handler->unencode_write(data, writer, buf, nbytes);
 }
 
+/* Tell how much a decoding stage consumed and produced. */
+static void unencode_stats(struct Curl_easy *data,
+                           struct contenc_writer *writer)
+{
+  struct contenc_writer *down = writer->downstream;
+  curl_off_t out = down? down->bytes_in: 0;
+
+  infof(data, "%s decoder: %" CURL_FORMAT_CURL_OFF_T " bytes into %"
+        CURL_FORMAT_CURL_OFF_T " bytes",
+        writer->handler->name, writer->bytes_in, out);
+}
+
 /* Close and clean-up the connection's writer stack. */
 void Curl_unencode_cleanup(struct Curl_easy *data)
 {
@@ -1017,7 +1318,16 @@ void Curl_unencode_cleanup(struct Curl_easy *data)
 
   while(writer) {
     k->writer_stack = writer->downstream;
+    if(writer->handler->name && writer->bytes_in)
+      unencode_stats(data, writer);
     writer->handler->close_writer(data, writer);
+    if(writer->decomp) {
+      /* keep one buffer around for the next response */
+      if(!data->state.decbuf)
+        data->state.decbuf = writer->decomp;
+      else
+        free(writer->decomp);
+    }
     free(writer);
     writer = k->writer_stack;
   }
@@ -1113,6 +1423,282 @@ CURLcode Curl_build_unencoding_stack(struct Curl_easy *data,
   return CURLE_OK;
 }
 
+
+/*
+ * Request body encoding. The encoder is a read callback put in front of the
+ * one that provides the body, compressing what it returns. The size of the
+ * result is not known up front, so the body is sent chunked over HTTP/1.1.
+ */
+
+#define ENC_RAWSIZE (4 * CURL_MAX_WRITE_SIZE) /* raw data read at a time */
+
+struct upload_encoder;
+
+/* Request body encoding. */
+struct upload_encoding {
+  const char *name;
+  CURLcode (*init)(struct Curl_easy *data, struct upload_encoder *enc);
+  /* Compress pending input into 'buf'. Flush and end the stream once all
+     input is consumed and 'eos' is set. */
+  CURLcode (*encode)(struct Curl_easy *data, struct upload_encoder *enc,
+                     char *buf, size_t len, size_t *nout);
+  void (*close)(struct upload_encoder *enc);
+};
+
+struct upload_encoder {
+  const struct upload_encoding *handler;
+  struct Curl_easy *data;
+  curl_read_callback fread_func; /* the body source */
+  void *in;
+  char *rawbuf;          /* data read from fread_func */
+  const char *next_in;   /* input not yet compressed */
+  size_t avail_in;
+  bool eos;              /* all input has been read */
+  bool done;             /* the end of the stream is returned */
+#ifdef HAVE_LIBZ
+  z_stream z;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_CStream *zcs;
+#endif
+};
+
+#ifdef HAVE_LIBZ
+static CURLcode zlib_encode(struct Curl_easy *data,
+                            struct upload_encoder *enc,
+                            char *buf, size_t len, size_t *nout)
+{
+  z_stream *z = &enc->z;
+  /* zlib counts in uInt, hand over huge input in pieces */
+  uInt n = (uInt)CURLMIN(enc->avail_in, 0x40000000);
+  int status;
+
+  z->next_in = (Bytef *) enc->next_in;
+  z->avail_in = n;
+  z->next_out = (Bytef *) buf;
+  z->avail_out = (uInt)CURLMIN(len, 0x40000000);
+  status = deflate(z, (enc->eos && n == enc->avail_in)? Z_FINISH: Z_NO_FLUSH);
+  if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+    failf(data, "Error while compressing the request body: %s",
+          z->msg? z->msg: "unknown");
+    return CURLE_SEND_ERROR;
+  }
+  enc->next_in += n - z->avail_in;
+  enc->avail_in -= n - z->avail_in;
+  *nout = (char *) z->next_out - buf;
+  if(status == Z_STREAM_END)
+    enc->done = TRUE;
+  return CURLE_OK;
+}
+
+static CURLcode zlib_encode_init(struct upload_encoder *enc, int windowbits)
+{
+  z_stream *z = &enc->z;
+
+  z->zalloc = (alloc_func) zalloc_cb;
+  z->zfree = (free_func) zfree_cb;
+  if(deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowbits, 8,
+                  Z_DEFAULT_STRATEGY) != Z_OK)
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+static CURLcode gzip_encode_init(struct Curl_easy *data,
+                                 struct upload_encoder *enc)
+{
+  (void)data;
+  return zlib_encode_init(enc, MAX_WBITS + 16); /* with gzip wrapper */
+}
+
+static CURLcode deflate_encode_init(struct Curl_easy *data,
+                                    struct upload_encoder *enc)
+{
+  (void)data;
+  return zlib_encode_init(enc, MAX_WBITS);
+}
+
+static void zlib_encode_close(struct upload_encoder *enc)
+{
+  (void)deflateEnd(&enc->z);
+}
+
+static const struct upload_encoding gzip_upload_encoding = {
+  "gzip",
+  gzip_encode_init,
+  zlib_encode,
+  zlib_encode_close
+};
+
+static const struct upload_encoding deflate_upload_encoding = {
+  "deflate",
+  deflate_encode_init,
+  zlib_encode,
+  zlib_encode_close
+};
+#endif /* HAVE_LIBZ */
+
+#ifdef HAVE_ZSTD
+static CURLcode zstd_encode_init(struct Curl_easy *data,
+                                 struct upload_encoder *enc)
+{
+  (void)data;
+  enc->zcs = ZSTD_createCStream();
+  return enc->zcs? CURLE_OK: CURLE_OUT_OF_MEMORY;
+}
+
+static CURLcode zstd_encode(struct Curl_easy *data,
+                            struct upload_encoder *enc,
+                            char *buf, size_t len, size_t *nout)
+{
+  ZSTD_inBuffer in;
+  ZSTD_outBuffer out;
+  size_t rc;
+
+  in.src = enc->next_in;
+  in.size = enc->avail_in;
+  in.pos = 0;
+  out.dst = buf;
+  out.size = len;
+  out.pos = 0;
+  rc = ZSTD_compressStream2(enc->zcs, &out, &in,
+                            enc->eos? ZSTD_e_end: ZSTD_e_continue);
+  if(ZSTD_isError(rc)) {
+    failf(data, "Error while compressing the request body: %s",
+          ZSTD_getErrorName(rc));
+    return CURLE_SEND_ERROR;
+  }
+  enc->next_in += in.pos;
+  enc->avail_in -= in.pos;
+  *nout = out.pos;
+  if(enc->eos && !rc)
+    enc->done = TRUE;
+  return CURLE_OK;
+}
+
+static void zstd_encode_close(struct upload_encoder *enc)
+{
+  ZSTD_freeCStream(enc->zcs);
+}
+
+static const struct upload_encoding zstd_upload_encoding = {
+  "zstd",
+  zstd_encode_init,
+  zstd_encode,
+  zstd_encode_close
+};
+#endif /* HAVE_ZSTD */
+
+static const struct upload_encoding * const upload_encodings[] = {
+#ifdef HAVE_LIBZ
+  &gzip_upload_encoding,
+  &deflate_upload_encoding,
+#endif
+#ifdef HAVE_ZSTD
+  &zstd_upload_encoding,
+#endif
+  NULL
+};
+
+/* The read callback that compresses. */
+static size_t upload_encode_read(char *buffer, size_t size, size_t nitems,
+                                 void *userp)
+{
+  struct upload_encoder *enc = (struct upload_encoder *)userp;
+  struct Curl_easy *data = enc->data;
+  size_t len = size * nitems;
+  size_t nout = 0;
+
+  while(!nout && !enc->done) {
+    if(!enc->avail_in && !enc->eos) {
+      size_t nread;
+
+      nread = enc->fread_func(enc->rawbuf, 1, ENC_RAWSIZE, enc->in);
+      if(nread == CURL_READFUNC_ABORT || nread == CURL_READFUNC_PAUSE)
+        return nread;
+      if(nread > ENC_RAWSIZE) {
+        failf(data, "read function returned funny value");
+        return CURL_READFUNC_ABORT;
+      }
+      enc->next_in = enc->rawbuf;
+      enc->avail_in = nread;
+      enc->eos = !nread;
+    }
+    if(enc->handler->encode(data, enc, buffer, len, &nout))
+      return CURL_READFUNC_ABORT;
+  }
+  return nout;
+}
+
+/* Compress the request body with the encoding set with
+   CURLOPT_UPLOAD_ENCODING. The body is read from 'mem' if set, otherwise
+   from the current read callback. */
+CURLcode Curl_upload_encoder_init(struct Curl_easy *data,
+                                  const char *mem, size_t memlen)
+{
+  const char *name = data->set.str[STRING_UPLOAD_ENCODING];
+  const struct upload_encoding * const *uep;
+  struct upload_encoder *enc;
+  CURLcode result;
+
+  DEBUGASSERT(name);
+  DEBUGASSERT(!data->req.upload_encoder);
+  for(uep = upload_encodings; *uep; uep++)
+    if(strcasecompare(name, (*uep)->name))
+      break;
+  if(!*uep) {
+    failf(data, "Unsupported upload encoding: %s", name);
+    return CURLE_NOT_BUILT_IN;
+  }
+
+  enc = calloc(1, sizeof(*enc));
+  if(!enc)
+    return CURLE_OUT_OF_MEMORY;
+  enc->handler = *uep;
+  enc->data = data;
+  if(mem) {
+    enc->next_in = mem;
+    enc->avail_in = memlen;
+    enc->eos = TRUE;
+  }
+  else {
+    enc->rawbuf = malloc(ENC_RAWSIZE);
+    if(!enc->rawbuf) {
+      free(enc);
+      return CURLE_OUT_OF_MEMORY;
+    }
+  }
+  result = enc->handler->init(data, enc);
+  if(result) {
+    free(enc->rawbuf);
+    free(enc);
+    return result;
+  }
+
+  enc->fread_func = data->state.fread_func;
+  enc->in = data->state.in;
+  data->state.fread_func = upload_encode_read;
+  data->state.in = enc;
+  data->req.upload_encoder = enc;
+  return CURLE_OK;
+}
+
+/* Remove the encoder and put back the read callback it reads from. */
+void Curl_upload_encoder_cleanup(struct Curl_easy *data)
+{
+  struct upload_encoder *enc = data->req.upload_encoder;
+
+  if(enc) {
+    if(data->state.in == enc) {
+      data->state.fread_func = enc->fread_func;
+      data->state.in = enc->in;
+    }
+    enc->handler->close(enc);
+    free(enc->rawbuf);
+    free(enc);
+    data->req.upload_encoder = NULL;
+  }
+}
+
 #else
 /* Stubs for builds without HTTP. */
 CURLcode Curl_build_unencoding_stack(struct Curl_easy *data,
@@ -1140,6 +1726,20 @@ void Curl_unencode_cleanup(struct Curl_easy *data)
   (void) data;
 }
 
+CURLcode Curl_upload_encoder_init(struct Curl_easy *data,
+                                  const char *mem, size_t memlen)
+{
+  (void) data;
+  (void) mem;
+  (void) memlen;
+  return CURLE_NOT_BUILT_IN;
+}
+
+void Curl_upload_encoder_cleanup(struct Curl_easy *data)
+{
+  (void) data;
+}
+
 char *Curl_all_content_encodings(void)
 {
   return strdup(CONTENT_ENCODING_DEFAULT);  /* Satisfy caller. */
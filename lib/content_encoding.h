@@ -29,6 +29,8 @@ struct contenc_writer {
   const struct content_encoding *handler;  /* Encoding handler. */
   struct contenc_writer *downstream;  /* Downstream writer. */
   unsigned int order; /* Ordering within writer stack. */
+  char *decomp;       /* Output buffer of decoding stages, or NULL. */
+  curl_off_t bytes_in; /* Amount of data written to this stage. */
 };
 
 /* Content encoding writer. */
@@ -52,6 +54,14 @@ CURLcode Curl_unencode_write(struct Curl_easy *data,
                              struct contenc_writer *writer,
                              const char *buf, size_t nbytes);
 void Curl_unencode_cleanup(struct Curl_easy *data);
+CURLcode Curl_upload_encoder_init(struct Curl_easy *data,
+                                  const char *mem, size_t memlen);
+void Curl_upload_encoder_cleanup(struct Curl_easy *data);
 char *Curl_all_content_encodings(void);
+#if defined(HAVE_ZSTD) && !defined(CURL_DISABLE_HTTP)
+void Curl_zstd_dicts_free(struct Curl_easy *data);
+#else
+#define Curl_zstd_dicts_free(x) Curl_nop_stmt
+#endif
 
 #endif /* HEADER_CURL_CONTENT_ENCODING_H */
@@ -101,12 +101,26 @@ Example set of cookies:
 #include "parsedate.h"
 #include "rename.h"
 #include "fopen.h"
+#include "arena.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
 #include "memdebug.h"
 
+/* the hash table grows by COOKIE_HASH_GROWTH when the jar holds more than
+   COOKIE_HASH_CHAIN cookies per list on average */
+#define COOKIE_HASH_CHAIN 4
+#define COOKIE_HASH_GROWTH 8
+
+/* the journal is compacted, that is the jar is saved in full, once it would
+   hold more than twice as many cookie lines as there are cookies, plus this
+   many */
+#define COOKIE_JOURNAL_SLACK 64
+
+/* smaller jars are always saved in full, that is cheap enough */
+#define COOKIE_JOURNAL_MIN 1000
+
 static void strstore(char **str, const char *newstr);
 
 static void freecookie(struct Cookie *co)
@@ -265,7 +279,7 @@ static size_t cookie_hash_domain(const char *domain, const size_t len)
     h ^= Curl_raw_toupper(*domain++);
   }
 
-  return (h % COOKIE_HASH_SIZE);
+  return h;
 }
 
 #if defined(_MSC_VER) && (_MSC_VER == 1900)
@@ -273,9 +287,11 @@ static size_t cookie_hash_domain(const char *domain, const size_t len)
 #endif
 
 /*
- * Hash this domain.
+ * Hash this domain into the jar's table. All cookies for the same top domain
+ * end up in the same list.
  */
-static size_t cookiehash(const char * const domain)
+static size_t cookiehash(const struct CookieInfo *c,
+                         const char * const domain)
 {
   const char *top;
   size_t len;
@@ -284,7 +300,51 @@ static size_t cookiehash(const char * const domain)
     return 0;
 
   top = get_top_domain(domain, &len);
-  return cookie_hash_domain(top, len);
+  return cookie_hash_domain(top, len) % c->slots;
+}
+
+/*
+ * Grow the hash table once the lists get long, so that a lookup keeps
+ * walking only a few domains worth of cookies even in a huge jar. The order
+ * within each list is kept. Failing to grow is not an error, the old table
+ * remains in use.
+ */
+static void cookie_grow(struct CookieInfo *c)
+{
+  struct Cookie **table;
+  struct Cookie **tails;
+  size_t slots;
+  size_t i;
+
+  if((size_t)c->numcookies <= c->slots * COOKIE_HASH_CHAIN)
+    return;
+
+  slots = c->slots * COOKIE_HASH_GROWTH;
+  table = calloc(slots, sizeof(struct Cookie *));
+  tails = calloc(slots, sizeof(struct Cookie *));
+  if(table && tails) {
+    size_t oldslots = c->slots;
+    c->slots = slots;
+    for(i = 0; i < oldslots; i++) {
+      struct Cookie *co = c->cookies[i];
+      while(co) {
+        struct Cookie *next = co->next;
+        size_t myhash = cookiehash(c, co->domain);
+        co->next = NULL;
+        if(tails[myhash])
+          tails[myhash]->next = co;
+        else
+          table[myhash] = co;
+        tails[myhash] = co;
+        co = next;
+      }
+    }
+    free(c->cookies);
+    c->cookies = table;
+    table = NULL;
+  }
+  free(table);
+  free(tails);
 }
 
 /*
@@ -366,6 +426,80 @@ static void strstore(char **str, const char *newstr)
   *str = strdup(newstr);
 }
 
+/*
+ * journal_drop
+ *
+ * Forget the journal file. The next save writes the whole jar.
+ */
+static void journal_drop(struct CookieInfo *c)
+{
+  Curl_safefree(c->journal);
+  c->journal_lines = 0;
+  curl_slist_free_all(c->tombstones);
+  c->tombstones = NULL;
+  c->ntombstones = 0;
+}
+
+/*
+ * journal_stat
+ *
+ * Get the size and modification time of a regular file. Returns FALSE if
+ * there is no such file.
+ */
+static bool journal_stat(const char *file, curl_off_t *size, time_t *mtime)
+{
+  struct_stat st;
+  if(stat(file, &st) || !S_ISREG(st.st_mode))
+    return FALSE;
+  *size = (curl_off_t)st.st_size;
+  *mtime = st.st_mtime;
+  return TRUE;
+}
+
+/*
+ * journal_set
+ *
+ * Make the given file, which holds 'lines' cookie lines, the journal of the
+ * jar. All cookies in the jar are in it, except for the dirty ones.
+ */
+static void journal_set(struct CookieInfo *c, const char *file, long lines)
+{
+  journal_drop(c);
+  if(journal_stat(file, &c->journal_size, &c->journal_mtime)) {
+    c->journal = strdup(file);
+    c->journal_lines = lines;
+  }
+}
+
+static char *get_netscape_format(const struct Cookie *co);
+
+/*
+ * journal_tombstone
+ *
+ * Remember the final line for a removed dirty cookie, to be appended to the
+ * journal file. Its expiry time is in the past, so it removes any earlier
+ * version of the cookie when the file is loaded.
+ */
+static void journal_tombstone(struct CookieInfo *c, const struct Cookie *co)
+{
+  struct curl_slist *node = NULL;
+  char *line;
+  if(!co->domain)
+    return;
+  line = get_netscape_format(co);
+  if(line)
+    /* their order does not matter, add it first */
+    node = Curl_slist_append_nodup(NULL, line);
+  if(!node) {
+    free(line);
+    journal_drop(c);
+    return;
+  }
+  node->next = c->tombstones;
+  c->tombstones = node;
+  c->ntombstones++;
+}
+
 /*
  * remove_expired
  *
@@ -379,23 +513,22 @@ static void remove_expired(struct CookieInfo *cookies)
 {
   struct Cookie *co, *nx;
   curl_off_t now = (curl_off_t)time(NULL);
-  unsigned int i;
+  size_t i;
 
   /*
    * If the earliest expiration timestamp in the jar is in the future we can
    * skip scanning the whole jar and instead exit early as there won't be any
    * cookies to evict.  If we need to evict however, reset the next_expiration
-   * counter in order to track the next one. In case the recorded first
-   * expiration is the max offset, then perform the safe fallback of checking
-   * all cookies.
+   * counter in order to track the next one. Every added cookie lowers the
+   * recorded timestamp if needed, so it is never later than the actual first
+   * expiry. The max offset means that no cookie in the jar expires.
    */
-  if(now < cookies->next_expiration &&
-      cookies->next_expiration != CURL_OFF_T_MAX)
+  if(now < cookies->next_expiration)
     return;
   else
     cookies->next_expiration = CURL_OFF_T_MAX;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
+  for(i = 0; i < cookies->slots; i++) {
     struct Cookie *pv = NULL;
     co = cookies->cookies[i];
     while(co) {
@@ -408,6 +541,12 @@ static void remove_expired(struct CookieInfo *cookies)
           pv->next = co->next;
         }
         cookies->numcookies--;
+        if(co->dirty) {
+          cookies->changes--;
+          if(cookies->journal)
+            /* it may have replaced a cookie that is in the journal file */
+            journal_tombstone(cookies, co);
+        }
         freecookie(co);
       }
       else {
@@ -1069,7 +1208,7 @@ Curl_cookie_add(struct Curl_easy *data,
 #endif
 
   /* A non-secure cookie may not overlay an existing secure cookie. */
-  myhash = cookiehash(co->domain);
+  myhash = cookiehash(c, co->domain);
   clist = c->cookies[myhash];
   while(clist) {
     if(strcasecompare(clist->name, co->name)) {
@@ -1177,6 +1316,9 @@ Curl_cookie_add(struct Curl_easy *data,
     free(clist->version);
     free(clist->maxage);
 
+    /* still dirty if the old one was */
+    co->dirty = clist->dirty;
+
     *clist = *co;  /* then store all the new data */
 
     free(co);   /* free the newly allocated memory */
@@ -1197,6 +1339,7 @@ Curl_cookie_add(struct Curl_easy *data,
     else
       c->cookies[myhash] = co;
     c->numcookies++; /* one more cookie in the jar */
+    cookie_grow(c);
   }
 
   /*
@@ -1206,6 +1349,12 @@ Curl_cookie_add(struct Curl_easy *data,
   if(co->expires && (co->expires < c->next_expiration))
     c->next_expiration = co->expires;
 
+  if(c->running && !co->dirty) {
+    /* not in the journal file */
+    co->dirty = TRUE;
+    c->changes++;
+  }
+
   return co;
 }
 
@@ -1232,6 +1381,7 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
   FILE *fp = NULL;
   bool fromfile = TRUE;
   char *line = NULL;
+  long before;
 
   if(!inc) {
     /* we didn't get a struct, create one */
@@ -1241,6 +1391,10 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
     c->filename = strdup(file?file:"none"); /* copy the name just in case */
     if(!c->filename)
       goto fail; /* failed to get memory */
+    c->cookies = calloc(COOKIE_HASH_SIZE, sizeof(struct Cookie *));
+    if(!c->cookies)
+      goto fail; /* failed to get memory */
+    c->slots = COOKIE_HASH_SIZE;
     /*
      * Initialize the next_expiration time to signal that we don't have enough
      * information yet.
@@ -1262,16 +1416,27 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
     fp = NULL;
   }
   else {
-    fp = fopen(file, "rb");
-    if(!fp)
-      infof(data, "WARNING: failed to open cookie file \"%s\"", file);
+    curl_off_t size;
+    time_t mtime;
+    if(c->journal && !strcmp(c->journal, file) &&
+       journal_stat(file, &size, &mtime) &&
+       (size == c->journal_size) && (mtime == c->journal_mtime))
+      /* the jar already has everything in this unchanged file */
+      fp = NULL;
+    else {
+      fp = fopen(file, "rb");
+      if(!fp)
+        infof(data, "WARNING: failed to open cookie file \"%s\"", file);
+    }
   }
 
   c->newsession = newsession; /* new session? */
+  before = c->numcookies;
 
   if(fp) {
     char *lineptr;
     bool headerline;
+    long lines = 0; /* cookie lines in the file */
 
     line = malloc(MAX_COOKIE_LINE);
     if(!line)
@@ -1289,6 +1454,11 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
       while(*lineptr && ISBLANK(*lineptr))
         lineptr++;
 
+      /* superseded and expired lines count too, they stay in the file */
+      if(*lineptr && (*lineptr != '\n') && (*lineptr != '\r') &&
+         ((*lineptr != '#') || checkprefix("#HttpOnly_", lineptr)))
+        lines++;
+
       Curl_cookie_add(data, c, headerline, TRUE, lineptr, NULL, NULL, TRUE);
     }
     free(line); /* free the line buffer */
@@ -1301,6 +1471,16 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
 
     if(fromfile && fp)
       fclose(fp);
+
+    /*
+     * The file can be the journal if the jar had no other cookies than
+     * dirty ones before. Without the session cookies it cannot, since they
+     * would remain in the file.
+     */
+    if(fromfile && !newsession && !c->journal && (before == c->changes))
+      journal_set(c, file, lines);
+    else
+      journal_drop(c);
   }
 
   c->running = TRUE;          /* now, we're running */
@@ -1374,64 +1554,41 @@ static int cookie_sort_ct(const void *p1, const void *p2)
   return (c2->creationtime > c1->creationtime) ? 1 : -1;
 }
 
-#define CLONE(field)                     \
-  do {                                   \
-    if(src->field) {                     \
-      d->field = strdup(src->field);     \
-      if(!d->field)                      \
-        goto fail;                       \
-    }                                    \
-  } while(0)
-
-static struct Cookie *dup_cookie(struct Cookie *src)
-{
-  struct Cookie *d = calloc(sizeof(struct Cookie), 1);
-  if(d) {
-    CLONE(expirestr);
-    CLONE(domain);
-    CLONE(path);
-    CLONE(spath);
-    CLONE(name);
-    CLONE(value);
-    CLONE(maxage);
-    CLONE(version);
-    d->expires = src->expires;
-    d->tailmatch = src->tailmatch;
-    d->secure = src->secure;
-    d->livecookie = src->livecookie;
-    d->httponly = src->httponly;
-    d->creationtime = src->creationtime;
-  }
-  return d;
-
-  fail:
-  freecookie(d);
-  return NULL;
-}
-
 /*
  * Curl_cookie_getlist
  *
- * For a given host and path, return a linked list of cookies that the client
- * should send to the server if used now. The secure boolean informs the cookie
- * if a secure connection is achieved or not.
+ * For a given host and path, fill in the list with the cookies that the
+ * client should send to the server if used now. The secure boolean informs
+ * the cookie if a secure connection is achieved or not.
  *
  * It shall only return cookies that haven't expired.
+ *
+ * The list borrows the cookies from the jar, through their 'getnode'. It is
+ * only valid for as long as the cookie lock is held and must be emptied with
+ * Curl_llist_destroy() before the lock is released. The memory needed for
+ * sorting is allocated from the given arena.
  */
-struct Cookie *Curl_cookie_getlist(struct Curl_easy *data,
-                                   struct CookieInfo *c,
-                                   const char *host, const char *path,
-                                   bool secure)
+CURLcode Curl_cookie_getlist(struct Curl_easy *data,
+                             struct CookieInfo *c,
+                             const char *host, const char *path,
+                             bool secure, struct Curl_arena *arena,
+                             struct Curl_llist *list)
 {
-  struct Cookie *newco;
   struct Cookie *co;
-  struct Cookie *mainco = NULL;
+  struct Cookie **array;
   size_t matches = 0;
+  size_t i;
   bool is_ip;
-  const size_t myhash = cookiehash(host);
+  size_t myhash;
+
+  Curl_llist_init(list, NULL);
 
-  if(!c || !c->cookies[myhash])
-    return NULL; /* no cookie struct or no cookies in the struct */
+  if(!c)
+    return CURLE_OK; /* no cookie struct */
+
+  myhash = cookiehash(c, host);
+  if(!c->cookies[myhash])
+    return CURLE_OK; /* no cookies for this domain */
 
   /* at first, remove expired cookies */
   remove_expired(c);
@@ -1461,71 +1618,52 @@ struct Cookie *Curl_cookie_getlist(struct Curl_easy *data,
         if(!co->spath || pathmatch(co->spath, path) ) {
 
           /*
-           * and now, we know this is a match and we should create an
-           * entry for the return-linked-list
+           * and now, we know this is a match and we should add it to the
+           * list
            */
+          Curl_llist_insert_next(list, list->tail, co, &co->getnode);
 
-          newco = dup_cookie(co);
-          if(newco) {
-            /* then modify our next */
-            newco->next = mainco;
-
-            /* point the main to us */
-            mainco = newco;
-
-            matches++;
-            if(matches >= MAX_COOKIE_SEND_AMOUNT) {
-              infof(data, "Included max number of cookies (%zu) in request!",
-                    matches);
-              break;
-            }
+          matches++;
+          if(matches >= MAX_COOKIE_SEND_AMOUNT) {
+            infof(data, "Included max number of cookies (%zu) in request!",
+                  matches);
+            break;
           }
-          else
-            goto fail;
         }
       }
     }
     co = co->next;
   }
 
-  if(matches) {
-    /*
-     * Now we need to make sure that if there is a name appearing more than
-     * once, the longest specified path version comes first. To make this
-     * the swiftest way, we just sort them all based on path length.
-     */
-    struct Cookie **array;
-    size_t i;
-
-    /* alloc an array and store all cookie pointers */
-    array = malloc(sizeof(struct Cookie *) * matches);
-    if(!array)
-      goto fail;
-
-    co = mainco;
-
-    for(i = 0; co; co = co->next)
-      array[i++] = co;
-
-    /* now sort the cookie pointers in path length order */
-    qsort(array, matches, sizeof(struct Cookie *), cookie_sort);
+  if(matches < 2)
+    return CURLE_OK;
 
-    /* remake the linked list order according to the new order */
+  /*
+   * Now we need to make sure that if there is a name appearing more than
+   * once, the longest specified path version comes first. To make this
+   * the swiftest way, we just sort them all based on path length.
+   */
 
-    mainco = array[0]; /* start here */
-    for(i = 0; i<matches-1; i++)
-      array[i]->next = array[i + 1];
-    array[matches-1]->next = NULL; /* terminate the list */
+  /* alloc an array and store all cookie pointers */
+  array = Curl_arena_alloc(arena, sizeof(struct Cookie *) * matches);
+  if(!array) {
+    Curl_llist_destroy(list, NULL);
+    return CURLE_OUT_OF_MEMORY;
+  }
 
-    free(array); /* remove the temporary data again */
+  for(i = 0; list->head; i++) {
+    array[i] = list->head->ptr;
+    Curl_llist_remove(list, list->head, NULL);
   }
 
-  return mainco; /* return the new list */
+  /* now sort the cookie pointers in path length order */
+  qsort(array, matches, sizeof(struct Cookie *), cookie_sort);
 
-fail:
-  /* failure, clear up the allocated chain and return NULL */
-  Curl_cookie_freelist(mainco);
-  return NULL;
+  /* remake the list according to the new order */
+  for(i = 0; i < matches; i++)
+    Curl_llist_insert_next(list, list->tail, array[i], &array[i]->getnode);
+
+  return CURLE_OK;
 }
 
 /*
@@ -1536,19 +1674,21 @@ fail:
 void Curl_cookie_clearall(struct CookieInfo *cookies)
 {
   if(cookies) {
-    unsigned int i;
-    for(i = 0; i < COOKIE_HASH_SIZE; i++) {
+    size_t i;
+    for(i = 0; i < cookies->slots; i++) {
       Curl_cookie_freelist(cookies->cookies[i]);
       cookies->cookies[i] = NULL;
     }
     cookies->numcookies = 0;
+    cookies->changes = 0;
+    journal_drop(cookies);
   }
 }
 
 /*
  * Curl_cookie_freelist
  *
- * Free a list of cookies previously returned by Curl_cookie_getlist();
+ * Free a list of cookies.
  */
 void Curl_cookie_freelist(struct Cookie *co)
 {
@@ -1568,12 +1708,12 @@ void Curl_cookie_freelist(struct Cookie *co)
 void Curl_cookie_clearsess(struct CookieInfo *cookies)
 {
   struct Cookie *first, *curr, *next, *prev = NULL;
-  unsigned int i;
+  size_t i;
 
   if(!cookies)
     return;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
+  for(i = 0; i < cookies->slots; i++) {
     if(!cookies->cookies[i])
       continue;
 
@@ -1590,6 +1730,8 @@ void Curl_cookie_clearsess(struct CookieInfo *cookies)
         else
           prev->next = next;
 
+        if(curr->dirty)
+          cookies->changes--;
         freecookie(curr);
         cookies->numcookies--;
       }
@@ -1599,6 +1741,8 @@ void Curl_cookie_clearsess(struct CookieInfo *cookies)
 
     cookies->cookies[i] = first;
   }
+  /* the journal file still has the removed ones */
+  journal_drop(cookies);
 }
 
 /*
@@ -1609,10 +1753,14 @@ void Curl_cookie_clearsess(struct CookieInfo *cookies)
 void Curl_cookie_cleanup(struct CookieInfo *c)
 {
   if(c) {
-    unsigned int i;
+    size_t i;
     free(c->filename);
-    for(i = 0; i < COOKIE_HASH_SIZE; i++)
-      Curl_cookie_freelist(c->cookies[i]);
+    journal_drop(c);
+    if(c->cookies) {
+      for(i = 0; i < c->slots; i++)
+        Curl_cookie_freelist(c->cookies[i]);
+      free(c->cookies);
+    }
     free(c); /* free the base struct as well */
   }
 }
@@ -1658,6 +1806,105 @@ static char *get_netscape_format(const struct Cookie *co)
  *
  * The function returns non-zero on write failure.
  */
+/*
+ * cookie_append()
+ *
+ * Bring the journal file up to date by appending the dirty cookies to it, in
+ * creation time order. Since a later line replaces an earlier one for the
+ * same cookie when the file is loaded, this gives the same jar as writing it
+ * in full. Returns TRUE if the file is up to date.
+ */
+static bool cookie_append(struct CookieInfo *c, const char *filename)
+{
+  struct Cookie *co;
+  struct Cookie **array;
+  curl_off_t size;
+  time_t mtime;
+  struct curl_slist *tomb;
+  size_t ndirty = 0;
+  size_t i;
+  FILE *out;
+  bool ok = TRUE;
+
+  if(!journal_stat(filename, &size, &mtime) ||
+     (size != c->journal_size) || (mtime != c->journal_mtime))
+    /* modified by someone else */
+    return FALSE;
+
+  if(!c->changes && !c->tombstones)
+    return TRUE;
+
+  array = malloc(sizeof(struct Cookie *) * (c->changes + 1));
+  if(!array)
+    return FALSE;
+
+  for(i = 0; i < c->slots; i++) {
+    for(co = c->cookies[i]; co; co = co->next) {
+      if(co->dirty && co->domain) {
+        DEBUGASSERT(ndirty < (size_t)c->changes);
+        if(ndirty < (size_t)c->changes)
+          array[ndirty++] = co;
+      }
+    }
+  }
+  qsort(array, ndirty, sizeof(struct Cookie *), cookie_sort_ct);
+
+  out = fopen(filename, FOPEN_APPENDTEXT);
+  if(!out) {
+    free(array);
+    return FALSE;
+  }
+  /* the removed ones go first, a dirty cookie is newer than any of them */
+  for(tomb = c->tombstones; ok && tomb; tomb = tomb->next)
+    if(fprintf(out, "%s\n", tomb->data) < 0)
+      ok = FALSE;
+  /* the sort is newest first */
+  for(i = ndirty; ok && i; i--) {
+    char *format_ptr = get_netscape_format(array[i - 1]);
+    if(!format_ptr || (fprintf(out, "%s\n", format_ptr) < 0))
+      ok = FALSE;
+    free(format_ptr);
+  }
+  if(fclose(out))
+    ok = FALSE;
+  free(array);
+
+  if(!ok) {
+    /* the file may have a partial line now */
+    journal_drop(c);
+    return FALSE;
+  }
+
+  for(i = 0; i < c->slots; i++)
+    for(co = c->cookies[i]; co; co = co->next)
+      co->dirty = FALSE;
+  c->changes = 0;
+  c->journal_lines += (long)ndirty + c->ntombstones;
+  curl_slist_free_all(c->tombstones);
+  c->tombstones = NULL;
+  c->ntombstones = 0;
+  if(!journal_stat(filename, &c->journal_size, &c->journal_mtime))
+    journal_drop(c);
+  return TRUE;
+}
+
+/*
+ * journal_min()
+ *
+ * Return the number of cookies a jar needs to have for its changes to be
+ * appended to the journal.
+ */
+static long journal_min(void)
+{
+#ifdef DEBUGBUILD
+  /* allow the tests to use the journal with small jars */
+  char *min = getenv("CURL_COOKIE_JOURNAL");
+  if(min)
+    return strtol(min, NULL, 10);
+#endif
+  return COOKIE_JOURNAL_MIN;
+}
+
 static CURLcode cookie_output(struct Curl_easy *data,
                               struct CookieInfo *c, const char *filename)
 {
@@ -1666,6 +1913,8 @@ static CURLcode cookie_output(struct Curl_easy *data,
   bool use_stdout = FALSE;
   char *tempstore = NULL;
   CURLcode error = CURLE_OK;
+  size_t nvalid = 0;
+  size_t i;
 
   if(!c)
     /* no cookie engine alive */
@@ -1674,6 +1923,15 @@ static CURLcode cookie_output(struct Curl_easy *data,
   /* at first, remove expired cookies */
   remove_expired(c);
 
+  /* only append the changes to the journal, unless it is due for a
+     compaction */
+  if(c->journal && !strcmp(c->journal, filename) &&
+     (c->numcookies >= journal_min()) &&
+     ((c->journal_lines + c->changes + c->ntombstones) <=
+      (c->numcookies * 2 + COOKIE_JOURNAL_SLACK)) &&
+     cookie_append(c, filename))
+    return CURLE_OK;
+
   if(!strcmp("-", filename)) {
     /* use stdout */
     out = stdout;
@@ -1691,8 +1949,6 @@ static CURLcode cookie_output(struct Curl_easy *data,
         out);
 
   if(c->numcookies) {
-    unsigned int i;
-    size_t nvalid = 0;
     struct Cookie **array;
 
     array = calloc(1, sizeof(struct Cookie *) * c->numcookies);
@@ -1702,7 +1958,7 @@ static CURLcode cookie_output(struct Curl_easy *data,
     }
 
     /* only sort the cookies with a domain property */
-    for(i = 0; i < COOKIE_HASH_SIZE; i++) {
+    for(i = 0; i < c->slots; i++) {
       for(co = c->cookies[i]; co; co = co->next) {
         if(!co->domain)
           continue;
@@ -1734,6 +1990,13 @@ static CURLcode cookie_output(struct Curl_easy *data,
       error = CURLE_WRITE_ERROR;
       goto error;
     }
+
+    /* the file now has all cookies, so it is the new journal */
+    for(i = 0; i < c->slots; i++)
+      for(co = c->cookies[i]; co; co = co->next)
+        co->dirty = FALSE;
+    c->changes = 0;
+    journal_set(c, filename, (long)nvalid);
   }
 
   /*
@@ -1757,12 +2020,12 @@ static struct curl_slist *cookie_list(struct Curl_easy *data)
   struct curl_slist *beg;
   struct Cookie *c;
   char *line;
-  unsigned int i;
+  size_t i;
 
   if(!data->cookies || (data->cookies->numcookies == 0))
     return NULL;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
+  for(i = 0; i < data->cookies->slots; i++) {
     for(c = data->cookies->cookies[i]; c; c = c->next) {
       if(!c->domain)
         continue;
@@ -27,8 +27,11 @@
 
 #include <curl/curl.h>
 
+#include "llist.h"
+
 struct Cookie {
   struct Cookie *next; /* next in the chain */
+  struct Curl_llist_element getnode; /* in the list of matching cookies */
   char *name;        /* <this> = value */
   char *value;       /* name = <this> */
   char *path;         /* path = <this> which is in Set-Cookie: */
@@ -45,6 +48,7 @@ struct Cookie {
   bool secure;       /* whether the 'secure' keyword was used */
   bool livecookie;   /* updated from a server, not a stored file */
   bool httponly;     /* true if the httponly directive is present */
+  bool dirty;        /* changed since the journal file was written */
   int creationtime;  /* time when the cookie was written */
   unsigned char prefix; /* bitmap fields indicating which prefix are set */
 };
@@ -56,11 +60,13 @@ struct Cookie {
 #define COOKIE_PREFIX__SECURE (1<<0)
 #define COOKIE_PREFIX__HOST (1<<1)
 
+/* initial number of hash chains, the table grows with the jar */
 #define COOKIE_HASH_SIZE 256
 
 struct CookieInfo {
-  /* linked list of cookies we know of */
-  struct Cookie *cookies[COOKIE_HASH_SIZE];
+  /* linked lists of cookies we know of, hashed on the top domain */
+  struct Cookie **cookies;
+  size_t slots;    /* number of lists in the 'cookies' table */
 
   char *filename;  /* file we read from/write to */
   long numcookies; /* number of cookies in the "jar" */
@@ -68,6 +74,16 @@ struct CookieInfo {
   bool newsession; /* new session, discard session cookies on load */
   int lastct;      /* last creation-time used in the jar */
   curl_off_t next_expiration; /* the next time at which expiration happens */
+
+  /* The journal is a cookie file that holds all cookies of the jar, except
+     the ones marked dirty. Saving to it only appends the dirty ones. */
+  char *journal;          /* file name, NULL when there is none */
+  curl_off_t journal_size; /* its size when it was last read or written */
+  time_t journal_mtime;   /* its modification time at that point */
+  long journal_lines;     /* number of cookie lines in it */
+  long changes;           /* number of dirty cookies */
+  struct curl_slist *tombstones; /* lines for removed dirty cookies */
+  long ntombstones;       /* number of lines in 'tombstones' */
 };
 
 /* This is the maximum line length we accept for a cookie line. RFC 2109
@@ -115,9 +131,13 @@ struct Cookie *Curl_cookie_add(struct Curl_easy *data,
                                const char *domain, const char *path,
                                bool secure);
 
-struct Cookie *Curl_cookie_getlist(struct Curl_easy *data,
-                                   struct CookieInfo *c, const char *host,
-                                   const char *path, bool secure);
+struct Curl_arena;
+
+CURLcode Curl_cookie_getlist(struct Curl_easy *data,
+                             struct CookieInfo *c, const char *host,
+                             const char *path, bool secure,
+                             struct Curl_arena *arena,
+                             struct Curl_llist *list);
 void Curl_cookie_freelist(struct Cookie *cookies);
 void Curl_cookie_clearall(struct CookieInfo *cookies);
 void Curl_cookie_clearsess(struct CookieInfo *cookies);
@@ -30,5 +30,12 @@ CURLcode Curl_base64url_encode(const char *inputbuff, size_t insize,
                                char **outptr, size_t *outlen);
 CURLcode Curl_base64_decode(const char *src,
                             unsigned char **outptr, size_t *outlen);
+size_t Curl_base64_encode_block(const unsigned char *in, size_t insize,
+                                char *out);
+
+#ifdef DEBUGBUILD
+/* makes the functions above skip their vectorized code */
+extern bool Curl_base64_scalar;
+#endif
 
 #endif /* HEADER_CURL_BASE64_H */
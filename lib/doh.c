@@ -325,7 +325,11 @@ static CURLcode dohprobe(struct Curl_easy *data,
         (data->set.ssl.native_ca_store ?
          CURLSSLOPT_NATIVE_CA : 0) |
         (data->set.ssl.auto_client_cert ?
-         CURLSSLOPT_AUTO_CLIENT_CERT : 0);
+         CURLSSLOPT_AUTO_CLIENT_CERT : 0) |
+        (data->set.ssl.ktls ?
+         CURLSSLOPT_KTLS : 0) |
+        (data->set.ssl.earlydata ?
+         CURLSSLOPT_EARLYDATA : 0);
 
       (void)curl_easy_setopt(doh, CURLOPT_SSL_OPTIONS, mask);
     }
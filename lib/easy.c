@@ -70,6 +70,7 @@
 #include "connect.h" /* for Curl_getconnectinfo */
 #include "slist.h"
 #include "mime.h"
+#include "content_encoding.h"
 #include "amigaos.h"
 #include "warnless.h"
 #include "sigpipe.h"
@@ -1028,6 +1029,7 @@ void curl_easy_reset(struct Curl_easy *data)
 
   /* zero out UserDefined data: */
   Curl_freeset(data);
+  Curl_zstd_dicts_free(data);
   memset(&data->set, 0, sizeof(struct UserDefined));
   (void)Curl_init_userdefined(data);
 
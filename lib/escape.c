@@ -38,6 +38,18 @@
 #include "curl_memory.h"
 #include "memdebug.h"
 
+/* The span scanners below look at 16 bytes at a time where the platform
+   always has the vector instructions for it. The byte values they test
+   for are ASCII. */
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define USE_ESCAPE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define USE_ESCAPE_NEON
+#include <arm_neon.h>
+#endif
+
 /* Portable character check (remember EBCDIC). Do not use isalnum() because
    its behavior is altered by the current locale.
    See https://datatracker.ietf.org/doc/html/rfc3986#section-2.3
@@ -65,6 +77,95 @@ bool Curl_isunreserved(unsigned char in)
   return FALSE;
 }
 
+/*
+ * Curl_unreserved_span() returns the number of bytes at the start of 's' for
+ * which Curl_isunreserved() is TRUE, looking at no more than 'len' bytes.
+ */
+size_t Curl_unreserved_span(const char *s, size_t len)
+{
+  size_t i = 0;
+#if defined(USE_ESCAPE_SSE2)
+  for(; len - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i y = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)),
+                             _mm_set1_epi8('a'));
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(y, _mm_set1_epi8(25)), y);
+    y = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(_mm_min_epu8(y, _mm_set1_epi8(9)),
+                                         y));
+    /* '-' and '.' are next to each other */
+    y = _mm_sub_epi8(x, _mm_set1_epi8('-'));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(_mm_min_epu8(y, _mm_set1_epi8(1)),
+                                         y));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(x, _mm_set1_epi8('~')));
+    if(_mm_movemask_epi8(ok) != 0xffff)
+      break;
+  }
+#elif defined(USE_ESCAPE_NEON)
+  for(; len - i >= 16; i += 16) {
+    uint8x16_t x = vld1q_u8((const uint8_t *)s + i);
+    uint8x16_t ok = vcleq_u8(vsubq_u8(vorrq_u8(x, vdupq_n_u8(0x20)),
+                                      vdupq_n_u8('a')), vdupq_n_u8(25));
+    ok = vorrq_u8(ok, vcleq_u8(vsubq_u8(x, vdupq_n_u8('0')), vdupq_n_u8(9)));
+    ok = vorrq_u8(ok, vcleq_u8(vsubq_u8(x, vdupq_n_u8('-')), vdupq_n_u8(1)));
+    ok = vorrq_u8(ok, vceqq_u8(x, vdupq_n_u8('_')));
+    ok = vorrq_u8(ok, vceqq_u8(x, vdupq_n_u8('~')));
+    if(vminvq_u8(ok) != 0xff)
+      break;
+  }
+#endif
+  /* the tail, or the vector holding the first other byte */
+  while((i < len) && Curl_isunreserved((unsigned char)s[i]))
+    i++;
+  return i;
+}
+
+/*
+ * Curl_plain_span() returns the number of bytes at the start of 's' that are
+ * within 'lo' to 'hi', inclusive, and are neither 'stop1' nor 'stop2',
+ * looking at no more than 'len' bytes.
+ */
+size_t Curl_plain_span(const char *s, size_t len,
+                       unsigned char lo, unsigned char hi,
+                       unsigned char stop1, unsigned char stop2)
+{
+  size_t i = 0;
+#if defined(USE_ESCAPE_SSE2)
+  const __m128i vlo = _mm_set1_epi8((char)lo);
+  const __m128i vrange = _mm_set1_epi8((char)(hi - lo));
+  const __m128i vstop1 = _mm_set1_epi8((char)stop1);
+  const __m128i vstop2 = _mm_set1_epi8((char)stop2);
+  for(; len - i >= 16; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i y = _mm_sub_epi8(x, vlo);
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(y, vrange), y);
+    __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(x, vstop1),
+                                _mm_cmpeq_epi8(x, vstop2));
+    if(_mm_movemask_epi8(_mm_andnot_si128(stop, ok)) != 0xffff)
+      break;
+  }
+#elif defined(USE_ESCAPE_NEON)
+  const uint8x16_t vlo = vdupq_n_u8(lo);
+  const uint8x16_t vrange = vdupq_n_u8((uint8_t)(hi - lo));
+  const uint8x16_t vstop1 = vdupq_n_u8(stop1);
+  const uint8x16_t vstop2 = vdupq_n_u8(stop2);
+  for(; len - i >= 16; i += 16) {
+    uint8x16_t x = vld1q_u8((const uint8_t *)s + i);
+    uint8x16_t ok = vcleq_u8(vsubq_u8(x, vlo), vrange);
+    uint8x16_t stop = vorrq_u8(vceqq_u8(x, vstop1), vceqq_u8(x, vstop2));
+    if(vminvq_u8(vbicq_u8(ok, stop)) != 0xff)
+      break;
+  }
+#endif
+  for(; i < len; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if((c < lo) || (c > hi) || (c == stop1) || (c == stop2))
+      break;
+  }
+  return i;
+}
+
 /* for ABI-compatibility with previous versions */
 char *curl_escape(const char *string, int inlength)
 {
@@ -77,6 +178,8 @@ char *curl_unescape(const char *string, int length)
   return curl_easy_unescape(NULL, string, length, NULL);
 }
 
+static const char hexdigits[] = "0123456789ABCDEF";
+
 /* Escapes for URL the given unescaped string of given length.
  * 'data' is ignored since 7.82.0.
  */
@@ -96,25 +199,40 @@ char *curl_easy_escape(struct Curl_easy *data, const char *string,
   if(!length)
     return strdup("");
 
-  while(length--) {
-    unsigned char in = *string; /* we need to treat the characters unsigned */
-
-    if(Curl_isunreserved(in)) {
-      /* append this */
-      if(Curl_dyn_addn(&d, &in, 1))
+  while(length) {
+    /* copy runs of safe bytes as they are */
+    size_t n = Curl_unreserved_span(string, length);
+    if(n) {
+      if(Curl_dyn_addn(&d, string, n))
         return NULL;
+      string += n;
+      length -= n;
     }
     else {
-      /* encode it */
-      if(Curl_dyn_addf(&d, "%%%02X", in))
+      /* encode it, we need to treat the characters unsigned */
+      unsigned char in = (unsigned char)*string;
+      char enc[3];
+      enc[0] = '%';
+      enc[1] = hexdigits[in >> 4];
+      enc[2] = hexdigits[in & 0x0f];
+      if(Curl_dyn_addn(&d, enc, 3))
         return NULL;
+      string++;
+      length--;
     }
-    string++;
   }
 
   return Curl_dyn_ptr(&d);
 }
 
+/* the value of a hexadecimal digit, the caller has checked it */
+static unsigned char onehex2dec(char in)
+{
+  if(ISDIGIT(in))
+    return (unsigned char)(in - '0');
+  return (unsigned char)((in | 0x20) - 'a' + 10);
+}
+
 /*
  * Curl_urldecode() URL decodes the given string.
  *
@@ -135,37 +253,40 @@ CURLcode Curl_urldecode(const char *string, size_t length,
                         char **ostring, size_t *olen,
                         enum urlreject ctrl)
 {
-  size_t alloc;
   char *ns;
   size_t strindex = 0;
-  unsigned long hex;
 
   DEBUGASSERT(string);
   DEBUGASSERT(ctrl >= REJECT_NADA); /* crash on TRUE/FALSE */
 
-  alloc = (length?length:strlen(string)) + 1;
-  ns = malloc(alloc);
+  if(!length)
+    length = strlen(string);
+  ns = malloc(length + 1);
 
   if(!ns)
     return CURLE_OUT_OF_MEMORY;
 
-  while(--alloc > 0) {
-    unsigned char in = *string;
-    if(('%' == in) && (alloc > 2) &&
+  while(length) {
+    unsigned char in;
+    /* copy runs without '%' or control bytes as they are */
+    size_t n = Curl_plain_span(string, length, 0x20, 0xff, '%', '%');
+    if(n) {
+      memcpy(&ns[strindex], string, n);
+      strindex += n;
+      string += n;
+      length -= n;
+      continue;
+    }
+
+    in = *string;
+    if(('%' == in) && (length > 2) &&
        ISXDIGIT(string[1]) && ISXDIGIT(string[2])) {
       /* this is two hexadecimal digits following a '%' */
-      char hexstr[3];
-      char *ptr;
-      hexstr[0] = string[1];
-      hexstr[1] = string[2];
-      hexstr[2] = 0;
-
-      hex = strtoul(hexstr, &ptr, 16);
-
-      in = curlx_ultouc(hex); /* this long is never bigger than 255 anyway */
+      in = (unsigned char)((onehex2dec(string[1]) << 4) |
+                           onehex2dec(string[2]));
 
       string += 2;
-      alloc -= 2;
+      length -= 2;
     }
 
     if(((ctrl == REJECT_CTRL) && (in < 0x20)) ||
@@ -176,6 +297,7 @@ CURLcode Curl_urldecode(const char *string, size_t length,
 
     ns[strindex++] = in;
     string++;
+    length--;
   }
   ns[strindex] = 0; /* terminate it */
 
@@ -27,6 +27,10 @@
  * allocated string or NULL if an error occurred.  */
 
 bool Curl_isunreserved(unsigned char in);
+size_t Curl_unreserved_span(const char *s, size_t len);
+size_t Curl_plain_span(const char *s, size_t len,
+                       unsigned char lo, unsigned char hi,
+                       unsigned char stop1, unsigned char stop2);
 
 enum urlreject {
   REJECT_NADA = 2,
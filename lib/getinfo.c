@@ -85,6 +85,16 @@ CURLcode Curl_initinfo(struct Curl_easy *data)
   info->conn_scheme = 0;
   info->conn_protocol = 0;
 
+  info->tls_handshake_us = 0;
+  info->tls_verify_us = 0;
+  info->tls_records_in = 0;
+  info->tls_records_out = 0;
+  info->tls_bytes_in = 0;
+  info->tls_bytes_out = 0;
+  info->tls_group[0] = '\0';
+  info->tls_resumed = FALSE;
+  info->tls_earlydata = FALSE;
+
 #ifdef USE_SSL
   Curl_ssl_free_certinfo(data);
 #endif
@@ -180,6 +190,10 @@ static CURLcode getinfo_char(struct Curl_easy *data, CURLINFO info,
     *param_charp = NULL;
 #endif
     break;
+  case CURLINFO_TLS_GROUP:
+    /* Return the key exchange group of the most recent TLS handshake */
+    *param_charp = data->info.tls_group[0] ? data->info.tls_group : NULL;
+    break;
 
   default:
     return CURLE_UNKNOWN_OPTION;
@@ -334,6 +348,12 @@ static CURLcode getinfo_long(struct Curl_easy *data, CURLINFO info,
   case CURLINFO_PROTOCOL:
     *param_longp = data->info.conn_protocol;
     break;
+  case CURLINFO_TLS_SESSION_RESUMED:
+    *param_longp = data->info.tls_resumed ? 1L : 0L;
+    break;
+  case CURLINFO_TLS_EARLYDATA:
+    *param_longp = data->info.tls_earlydata ? 1L : 0L;
+    break;
   default:
     return CURLE_UNKNOWN_OPTION;
   }
@@ -415,6 +435,24 @@ static CURLcode getinfo_offt(struct Curl_easy *data, CURLINFO info,
   case CURLINFO_RETRY_AFTER:
     *param_offt = data->info.retry_after;
     break;
+  case CURLINFO_TLS_HANDSHAKE_TIME_T:
+    *param_offt = data->info.tls_handshake_us;
+    break;
+  case CURLINFO_TLS_VERIFY_TIME_T:
+    *param_offt = data->info.tls_verify_us;
+    break;
+  case CURLINFO_TLS_RECORDS_IN_T:
+    *param_offt = data->info.tls_records_in;
+    break;
+  case CURLINFO_TLS_RECORDS_OUT_T:
+    *param_offt = data->info.tls_records_out;
+    break;
+  case CURLINFO_TLS_BYTES_IN_T:
+    *param_offt = data->info.tls_bytes_in;
+    break;
+  case CURLINFO_TLS_BYTES_OUT_T:
+    *param_offt = data->info.tls_bytes_out;
+    break;
   default:
     return CURLE_UNKNOWN_OPTION;
   }
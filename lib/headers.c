@@ -28,6 +28,7 @@
 #include "strdup.h"
 #include "strcase.h"
 #include "headers.h"
+#include "arena.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -36,6 +37,9 @@
 
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_HEADERS_API)
 
+/* number of slots in the header name index */
+#define HEADERS_NAME_SLOTS 31
+
 /* Generate the curl_header struct for the user. This function MUST assign all
    struct fields in the output struct. */
 static void copy_header_external(struct Curl_easy *data,
@@ -67,9 +71,8 @@ CURLHcode curl_easy_header(CURL *easy,
                            struct curl_header **hout)
 {
   struct Curl_llist_element *e;
-  struct Curl_llist_element *e_pick = NULL;
+  struct Curl_llist *names;
   struct Curl_easy *data = easy;
-  size_t match = 0;
   size_t amount = 0;
   struct Curl_header_store *hs = NULL;
   struct Curl_header_store *pick = NULL;
@@ -84,15 +87,18 @@ CURLHcode curl_easy_header(CURL *easy,
   if(request == -1)
     request = data->state.requests;
 
-  /* we need a first round to count amount of this header */
-  for(e = data->state.httphdrs.head; e; e = e->next) {
+  names = Curl_hash_pick(&data->state.httphdrs_names, (void *)name,
+                         strlen(name));
+  if(!names)
+    return CURLHE_MISSING;
+
+  /* only the headers using this name need to be checked, count the matches
+     and pick the one asked for in the same round */
+  for(e = names->head; e; e = e->next) {
     hs = e->ptr;
-    if(strcasecompare(hs->name, name) &&
-       (hs->type & type) &&
-       (hs->request == request)) {
-      amount++;
-      pick = hs;
-      e_pick = e;
+    if((hs->type & type) && (hs->request == request)) {
+      if(amount++ == nameindex)
+        pick = hs;
     }
   }
   if(!amount)
@@ -100,25 +106,8 @@ CURLHcode curl_easy_header(CURL *easy,
   else if(nameindex >= amount)
     return CURLHE_BADINDEX;
 
-  if(nameindex == amount - 1)
-    /* if the last or only occurrence is what's asked for, then we know it */
-    hs = pick;
-  else {
-    for(e = data->state.httphdrs.head; e; e = e->next) {
-      hs = e->ptr;
-      if(strcasecompare(hs->name, name) &&
-         (hs->type & type) &&
-         (hs->request == request) &&
-         (match++ == nameindex)) {
-        e_pick = e;
-        break;
-      }
-    }
-    if(!e) /* this shouldn't happen */
-      return CURLHE_MISSING;
-  }
   /* this is the name we want */
-  copy_header_external(data, hs, nameindex, amount, e_pick, hout);
+  copy_header_external(data, pick, nameindex, amount, &pick->node, hout);
   return CURLHE_OK;
 }
 
@@ -169,13 +158,12 @@ struct curl_header *curl_easy_nextheader(CURL *easy,
 
   /* count number of occurrences of this name within the mask and figure out
      the index for the currently selected entry */
-  for(e = data->state.httphdrs.head; e; e = e->next) {
+  for(e = hs->names->head; e; e = e->next) {
     struct Curl_header_store *check = e->ptr;
-    if(strcasecompare(hs->name, check->name) &&
-       (check->request == request) &&
+    if((check->request == request) &&
        (check->type & type))
       amount++;
-    if(e == pick)
+    if(check == hs)
       index = amount - 1;
   }
 
@@ -242,18 +230,20 @@ static CURLcode unfold_value(struct Curl_easy *data, const char *value,
     value++;
   }
 
-  /* since this header block might move in the realloc below, it needs to
-     first be unlinked from the list and then re-added again after the
-     realloc */
-  Curl_llist_remove(&data->state.httphdrs, &hs->node, NULL);
-
-  /* new size = struct + new value length + old name+value length */
-  newhs = Curl_saferealloc(hs, sizeof(*hs) + vlen + oalloc + 1);
+  /* new size = struct + new value length + old name+value length. The old
+     block stays in the arena until the headers are cleaned up. */
+  newhs = Curl_arena_alloc(&data->state.httphdrs_arena,
+                           sizeof(*hs) + vlen + oalloc + 1);
   if(!newhs)
     return CURLE_OUT_OF_MEMORY;
+
+  /* the header block moves to the larger copy, so the old one is unlinked
+     from the lists and the copy is added instead */
+  Curl_llist_remove(&data->state.httphdrs, &hs->node, NULL);
+  Curl_llist_remove(hs->names, &hs->namenode, NULL);
+  memcpy(newhs, hs, sizeof(*hs) + oalloc);
   /* ->name' and ->value point into ->buffer (to keep the header allocation
-     in a single memory block), which now potentially have moved. Adjust
-     them. */
+     in a single memory block), which now have moved. Adjust them. */
   newhs->name = newhs->buffer;
   newhs->value = &newhs->buffer[offset];
 
@@ -264,10 +254,70 @@ static CURLcode unfold_value(struct Curl_easy *data, const char *value,
   /* insert this node into the list of headers */
   Curl_llist_insert_next(&data->state.httphdrs, data->state.httphdrs.tail,
                          newhs, &newhs->node);
+  Curl_llist_insert_next(newhs->names, newhs->names->tail,
+                         newhs, &newhs->namenode);
   data->state.prevhead = newhs;
   return CURLE_OK;
 }
 
+/* case insensitive version of Curl_hash_str() for header names */
+static size_t names_hash(void *key, size_t key_length, size_t slots_num)
+{
+  const char *key_str = (const char *) key;
+  const char *end = key_str + key_length;
+  size_t h = 5381;
+
+  while(key_str < end) {
+    h += h << 5;
+    h ^= (unsigned char)Curl_raw_tolower(*key_str++);
+  }
+
+  return (h % slots_num);
+}
+
+static size_t names_compare(void *k1, size_t key1_len,
+                            void *k2, size_t key2_len)
+{
+  if((key1_len == key2_len) && strncasecompare(k1, k2, key1_len))
+    return 1;
+
+  return 0;
+}
+
+/* the lists are allocated from the arena, nothing to free here */
+static void names_dtor(void *p)
+{
+  (void)p;
+}
+
+static void names_init(struct Curl_easy *data)
+{
+  Curl_hash_init(&data->state.httphdrs_names, HEADERS_NAME_SLOTS,
+                 names_hash, names_compare, names_dtor);
+}
+
+/*
+ * Return the list of stored headers using the given name, create it if there
+ * is none yet. Returns NULL on OOM.
+ */
+static struct Curl_llist *names_get(struct Curl_easy *data, const char *name)
+{
+  size_t nlen = strlen(name);
+  struct Curl_llist *names;
+  if(!data->state.httphdrs_names.slots)
+    names_init(data);
+  names = Curl_hash_pick(&data->state.httphdrs_names, (void *)name, nlen);
+  if(!names) {
+    names = Curl_arena_alloc(&data->state.httphdrs_arena, sizeof(*names));
+    if(!names)
+      return NULL;
+    Curl_llist_init(names, NULL);
+    if(!Curl_hash_add(&data->state.httphdrs_names, (void *)name, nlen,
+                      names))
+      return NULL;
+  }
+  return names;
+}
 
 /*
  * Curl_headers_push() gets passed a full HTTP header to store. It gets called
@@ -304,7 +354,7 @@ CURLcode Curl_headers_push(struct Curl_easy *data, const char *header,
       return CURLE_BAD_FUNCTION_ARGUMENT;
   }
 
-  hs = calloc(1, sizeof(*hs) + hlen);
+  hs = Curl_arena_calloc(&data->state.httphdrs_arena, sizeof(*hs) + hlen);
   if(!hs)
     return CURLE_OUT_OF_MEMORY;
   memcpy(hs->buffer, header, hlen);
@@ -312,21 +362,24 @@ CURLcode Curl_headers_push(struct Curl_easy *data, const char *header,
 
   result = namevalue(hs->buffer, hlen, type, &name, &value);
   if(result)
-    goto fail;
+    return result;
 
   hs->name = name;
   hs->value = value;
   hs->type = type;
   hs->request = data->state.requests;
 
+  /* find or create the list of headers using this name */
+  hs->names = names_get(data, name);
+  if(!hs->names)
+    return CURLE_OUT_OF_MEMORY;
+
   /* insert this node into the list of headers */
   Curl_llist_insert_next(&data->state.httphdrs, data->state.httphdrs.tail,
                          hs, &hs->node);
+  Curl_llist_insert_next(hs->names, hs->names->tail, hs, &hs->namenode);
   data->state.prevhead = hs;
   return CURLE_OK;
-  fail:
-  free(hs);
-  return result;
 }
 
 /*
@@ -335,6 +388,7 @@ CURLcode Curl_headers_push(struct Curl_easy *data, const char *header,
 static void headers_init(struct Curl_easy *data)
 {
   Curl_llist_init(&data->state.httphdrs, NULL);
+  names_init(data);
 }
 
 /*
@@ -342,14 +396,8 @@ static void headers_init(struct Curl_easy *data)
  */
 CURLcode Curl_headers_cleanup(struct Curl_easy *data)
 {
-  struct Curl_llist_element *e;
-  struct Curl_llist_element *n;
-
-  for(e = data->state.httphdrs.head; e; e = n) {
-    struct Curl_header_store *hs = e->ptr;
-    n = e->next;
-    free(hs);
-  }
+  Curl_hash_destroy(&data->state.httphdrs_names);
+  Curl_arena_release(&data->state.httphdrs_arena);
   headers_init(data);
   return CURLE_OK;
 }
@@ -29,6 +29,8 @@
 
 struct Curl_header_store {
   struct Curl_llist_element node;
+  struct Curl_llist_element namenode; /* node in the per-name list */
+  struct Curl_llist *names; /* the per-name list this header is stored in */
   char *name; /* points into 'buffer' */
   char *value; /* points into 'buffer */
   int request; /* 0 is the first request, then 1.. 2.. */
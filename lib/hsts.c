@@ -40,6 +40,7 @@
 #include "fopen.h"
 #include "rename.h"
 #include "share.h"
+#include "hash.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -53,6 +54,12 @@
 #define MAX_HSTS_DATELENSTR "64"
 #define UNLIMITED "unlimited"
 
+/* the index starts out small and grows by HSTS_GROWTH whenever the average
+   chain gets longer than HSTS_MAXCHAIN */
+#define HSTS_SLOTS 63
+#define HSTS_GROWTH 8
+#define HSTS_MAXCHAIN 2
+
 #ifdef DEBUGBUILD
 /* to play well with debug builds, we can *set* a fixed time this will
    return */
@@ -73,11 +80,43 @@ static time_t debugtime(void *unused)
 #define time(x) debugtime(x)
 #endif
 
+/* host names are case insensitive */
+static size_t hsts_hash(void *key, size_t key_length, size_t slots_num)
+{
+  const char *key_str = (const char *) key;
+  const char *end = key_str + key_length;
+  size_t h = 5381;
+
+  while(key_str < end) {
+    h += h << 5;
+    h ^= (unsigned char)Curl_raw_tolower(*key_str++);
+  }
+
+  return (h % slots_num);
+}
+
+static size_t hsts_compare(void *k1, size_t key1_len,
+                           void *k2, size_t key2_len)
+{
+  if((key1_len == key2_len) && strncasecompare(k1, k2, key1_len))
+    return 1;
+
+  return 0;
+}
+
+/* the entries are owned by the list, nothing to free here */
+static void hsts_index_dtor(void *p)
+{
+  (void)p;
+}
+
 struct hsts *Curl_hsts_init(void)
 {
   struct hsts *h = calloc(sizeof(struct hsts), 1);
   if(h) {
     Curl_llist_init(&h->list, NULL);
+    Curl_hash_init(&h->index, HSTS_SLOTS, hsts_hash, hsts_compare,
+                   hsts_index_dtor);
   }
   return h;
 }
@@ -88,6 +127,41 @@ static void hsts_free(struct stsentry *e)
   free(e);
 }
 
+/* unlink the entry from both the list and the index, then free it */
+static void hsts_remove(struct hsts *h, struct stsentry *sts)
+{
+  Curl_hash_delete(&h->index, (void *)sts->host, strlen(sts->host));
+  Curl_llist_remove(&h->list, &sts->node, NULL);
+  hsts_free(sts);
+}
+
+/*
+ * Rebuild the index with more slots once the chains get long, so that
+ * loading a large preload list stays linear. The old index is kept intact
+ * until the new one is complete.
+ */
+static CURLcode hsts_grow(struct hsts *h)
+{
+  struct Curl_hash index;
+  struct Curl_llist_element *e;
+
+  if(h->list.size <= (size_t)h->index.slots * HSTS_MAXCHAIN)
+    return CURLE_OK;
+
+  Curl_hash_init(&index, h->index.slots * HSTS_GROWTH + 1, hsts_hash,
+                 hsts_compare, hsts_index_dtor);
+  for(e = h->list.head; e; e = e->next) {
+    struct stsentry *sts = e->ptr;
+    if(!Curl_hash_add(&index, (void *)sts->host, strlen(sts->host), sts)) {
+      Curl_hash_destroy(&index);
+      return CURLE_OUT_OF_MEMORY;
+    }
+  }
+  Curl_hash_destroy(&h->index);
+  h->index = index;
+  return CURLE_OK;
+}
+
 void Curl_hsts_cleanup(struct hsts **hp)
 {
   struct hsts *h = *hp;
@@ -99,6 +173,7 @@ void Curl_hsts_cleanup(struct hsts **hp)
       n = e->next;
       hsts_free(sts);
     }
+    Curl_hash_destroy(&h->index);
     free(h->filename);
     free(h);
     *hp = NULL;
@@ -115,9 +190,17 @@ static CURLcode hsts_create(struct hsts *h,
                             bool subdomains,
                             curl_off_t expires)
 {
-  struct stsentry *sts = hsts_entry();
+  struct stsentry *sts = Curl_hsts(h, hostname, FALSE);
   char *duphost;
   size_t hlen;
+  if(sts) {
+    /* already present, update it in place */
+    sts->expires = expires;
+    sts->includeSubDomains = subdomains;
+    return CURLE_OK;
+  }
+
+  sts = hsts_entry();
   if(!sts)
     return CURLE_OUT_OF_MEMORY;
 
@@ -135,7 +218,13 @@ static CURLcode hsts_create(struct hsts *h,
   sts->host = duphost;
   sts->expires = expires;
   sts->includeSubDomains = subdomains;
+  if(!Curl_hash_add(&h->index, duphost, hlen, sts)) {
+    hsts_free(sts);
+    return CURLE_OUT_OF_MEMORY;
+  }
   Curl_llist_insert_next(&h->list, h->list.tail, sts, &sts->node);
+  /* a failed grow leaves the current index in place, still usable */
+  (void)hsts_grow(h);
   return CURLE_OK;
 }
 
@@ -213,10 +302,8 @@ CURLcode Curl_hsts_parse(struct hsts *h, const char *hostname,
   if(!expires) {
     /* remove the entry if present verbatim (without subdomain match) */
     sts = Curl_hsts(h, hostname, FALSE);
-    if(sts) {
-      Curl_llist_remove(&h->list, &sts->node, NULL);
-      hsts_free(sts);
-    }
+    if(sts)
+      hsts_remove(h, sts);
     return CURLE_OK;
   }
 
@@ -226,24 +313,33 @@ CURLcode Curl_hsts_parse(struct hsts *h, const char *hostname,
   else
     expires += now;
 
-  /* check if it already exists */
-  sts = Curl_hsts(h, hostname, FALSE);
-  if(sts) {
-    /* just update these fields */
-    sts->expires = expires;
-    sts->includeSubDomains = subdomains;
-  }
-  else
-    return hsts_create(h, hostname, subdomains, expires);
+  /* updates the entry if it already exists */
+  return hsts_create(h, hostname, subdomains, expires);
+}
 
-  return CURLE_OK;
+/*
+ * Return the entry for this exact host name, unless it has expired. Expired
+ * entries are removed when they are found.
+ */
+static struct stsentry *hsts_pick(struct hsts *h, const char *host,
+                                  time_t now)
+{
+  struct stsentry *sts = Curl_hash_pick(&h->index, (void *)host,
+                                        strlen(host));
+  if(sts && (sts->expires <= now)) {
+    hsts_remove(h, sts);
+    sts = NULL;
+  }
+  return sts;
 }
 
 /*
  * Return TRUE if the given host name is currently an HSTS one.
  *
  * The 'subdomain' argument tells the function if subdomain matching should be
- * attempted.
+ * attempted. A superdomain with includeSubDomains set is then looked up one
+ * label at a time before the host name itself, as RFC 6797 section 8.2
+ * describes.
  */
 struct stsentry *Curl_hsts(struct hsts *h, const char *hostname,
                            bool subdomain)
@@ -252,8 +348,6 @@ struct stsentry *Curl_hsts(struct hsts *h, const char *hostname,
     char buffer[MAX_HSTS_HOSTLEN + 1];
     time_t now = time(NULL);
     size_t hlen = strlen(hostname);
-    struct Curl_llist_element *e;
-    struct Curl_llist_element *n;
 
     if((hlen > MAX_HSTS_HOSTLEN) || !hlen)
       return NULL;
@@ -264,31 +358,36 @@ struct stsentry *Curl_hsts(struct hsts *h, const char *hostname,
     buffer[hlen] = 0;
     hostname = buffer;
 
-    for(e = h->list.head; e; e = n) {
-      struct stsentry *sts = e->ptr;
-      n = e->next;
-      if(sts->expires <= now) {
-        /* remove expired entries */
-        Curl_llist_remove(&h->list, &sts->node, NULL);
-        hsts_free(sts);
-        continue;
+    if(subdomain) {
+      const char *p;
+      for(p = strchr(hostname, '.'); p; p = strchr(p, '.')) {
+        struct stsentry *sts = hsts_pick(h, ++p, now);
+        if(sts && sts->includeSubDomains)
+          return sts;
       }
-      if(subdomain && sts->includeSubDomains) {
-        size_t ntail = strlen(sts->host);
-        if(ntail < hlen) {
-          size_t offs = hlen - ntail;
-          if((hostname[offs-1] == '.') &&
-             strncasecompare(&hostname[offs], sts->host, ntail))
-            return sts;
-        }
-      }
-      if(strcasecompare(hostname, sts->host))
-        return sts;
     }
+    return hsts_pick(h, hostname, now);
   }
   return NULL; /* no match */
 }
 
+/*
+ * Remove all expired entries. Lookups only drop the ones they run into.
+ */
+static void hsts_sweep(struct hsts *h)
+{
+  struct Curl_llist_element *e;
+  struct Curl_llist_element *n;
+  time_t now = time(NULL);
+
+  for(e = h->list.head; e; e = n) {
+    struct stsentry *sts = e->ptr;
+    n = e->next;
+    if(sts->expires <= now)
+      hsts_remove(h, sts);
+  }
+}
+
 /*
  * Send this HSTS entry to the write callback.
  */
@@ -362,6 +461,8 @@ CURLcode Curl_hsts_save(struct Curl_easy *data, struct hsts *h,
     /* no cache activated */
     return CURLE_OK;
 
+  hsts_sweep(h);
+
   /* if no new name is given, use the one we stored from the load */
   if(!file && h->filename)
     file = h->filename;
@@ -28,6 +28,7 @@
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_HSTS)
 #include <curl/curl.h>
 #include "llist.h"
+#include "hash.h"
 
 #ifdef DEBUGBUILD
 extern time_t deltatime;
@@ -40,9 +41,12 @@ struct stsentry {
   curl_off_t expires; /* the timestamp of this entry's expiry */
 };
 
-/* The HSTS cache. Needs to be able to tailmatch host names. */
+/* The HSTS cache. Needs to be able to tailmatch host names. The list keeps
+   the entries in insertion order for saving, the hash indexes them by host
+   name for lookups. */
 struct hsts {
   struct Curl_llist list;
+  struct Curl_hash index;
   char *filename;
   unsigned int flags;
 };
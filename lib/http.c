@@ -1593,6 +1593,8 @@ CURLcode Curl_http_done(struct Curl_easy *data,
   data->state.authproxy.multipass = FALSE;
 
   Curl_unencode_cleanup(data);
+  Curl_upload_encoder_cleanup(data);
+  Curl_aws_sigv4_cleanup(data);
 
   /* set the proper values (possibly modified on POST) */
   conn->seek_func = data->set.seek_func; /* restore */
@@ -1815,8 +1817,9 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
           }
           else {
             if(*(--ptr) == ';') {
-              /* copy the source */
-              semicolonp = strdup(headers->data);
+              /* copy the source, released with the request */
+              semicolonp = Curl_arena_strdup(&data->req.arena,
+                                             headers->data);
               if(!semicolonp) {
 #ifndef USE_HYPER
                 Curl_dyn_free(req);
@@ -1884,8 +1887,6 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
             result = Curl_dyn_addf(req, "%s\r\n", compare);
 #endif
           }
-          if(semicolonp)
-            free(semicolonp);
           if(result)
             return result;
         }
@@ -2245,6 +2246,49 @@ CURLcode Curl_http_target(struct Curl_easy *data,
   return result;
 }
 
+/*
+ * Tell if the request body is to be compressed with CURLOPT_UPLOAD_ENCODING.
+ * Not for HTTP/3, which sends CURLOPT_POSTFIELDS on its own.
+ */
+static bool http_encode_body(struct Curl_easy *data,
+                             struct connectdata *conn,
+                             Curl_HttpReq httpreq)
+{
+#ifndef USE_HYPER
+  if(data->set.str[STRING_UPLOAD_ENCODING] && !conn->bits.authneg &&
+     conn->httpversion < 30) {
+    switch(httpreq) {
+    case HTTPREQ_POST:
+    case HTTPREQ_POST_FORM:
+    case HTTPREQ_POST_MIME:
+    case HTTPREQ_PUT:
+      return TRUE;
+    default:
+      break;
+    }
+  }
+#else
+  (void)data;
+  (void)conn;
+  (void)httpreq;
+#endif
+  return FALSE;
+}
+
+/* Put the request body compressor in front of the body source. */
+static CURLcode http_encode_body_start(struct Curl_easy *data,
+                                       Curl_HttpReq httpreq)
+{
+  if(httpreq == HTTPREQ_POST && data->set.postfields) {
+    curl_off_t len = data->set.postfieldsize;
+    return Curl_upload_encoder_init(data, data->set.postfields,
+                                    (len == -1)?
+                                    strlen(data->set.postfields):
+                                    (size_t)len);
+  }
+  return Curl_upload_encoder_init(data, NULL, 0);
+}
+
 CURLcode Curl_http_body(struct Curl_easy *data, struct connectdata *conn,
                         Curl_HttpReq httpreq, const char **tep)
 {
@@ -2297,6 +2341,13 @@ CURLcode Curl_http_body(struct Curl_easy *data, struct connectdata *conn,
   }
 #endif
 
+  if(http_encode_body(data, conn, httpreq)) {
+    /* the size of the compressed body is not known up front */
+    data->state.infilesize = -1;
+    if(http->sendit)
+      http->postsize = -1;
+  }
+
   ptr = Curl_checkheaders(data, STRCONST("Transfer-Encoding"));
   if(ptr) {
     /* Some kind of TE is requested, check if 'chunked' is chosen */
@@ -2347,11 +2398,19 @@ CURLcode Curl_http_bodysend(struct Curl_easy *data, struct connectdata *conn,
   CURLcode result = CURLE_OK;
   struct HTTP *http = data->req.p.http;
   const char *ptr;
+  bool encode = http_encode_body(data, conn, httpreq);
 
   /* If 'authdone' is FALSE, we must not set the write socket index to the
      Curl_transfer() call below, as we're not ready to actually upload any
      data yet. */
 
+  if(encode && !Curl_checkheaders(data, STRCONST("Content-Encoding"))) {
+    result = Curl_dyn_addf(r, "Content-Encoding: %s\r\n",
+                           data->set.str[STRING_UPLOAD_ENCODING]);
+    if(result)
+      return result;
+  }
+
   switch(httpreq) {
 
   case HTTPREQ_PUT: /* Let's PUT the data to the server! */
@@ -2385,6 +2444,12 @@ CURLcode Curl_http_bodysend(struct Curl_easy *data, struct connectdata *conn,
     /* set the upload size to the progress meter */
     Curl_pgrsSetUploadSize(data, http->postsize);
 
+    if(encode) {
+      result = http_encode_body_start(data, httpreq);
+      if(result)
+        return result;
+    }
+
     /* this sends the buffer and frees all the buffer resources */
     result = Curl_buffer_send(r, data, data->req.p.http,
                               &data->info.request_size, 0,
@@ -2479,6 +2544,12 @@ CURLcode Curl_http_bodysend(struct Curl_easy *data, struct connectdata *conn,
     data->state.in = (void *) http->sendit;
     http->sending = HTTPSEND_BODY;
 
+    if(encode) {
+      result = http_encode_body_start(data, httpreq);
+      if(result)
+        return result;
+    }
+
     /* this sends the buffer and frees all the buffer resources */
     result = Curl_buffer_send(r, data, data->req.p.http,
                               &data->info.request_size, 0,
@@ -2543,7 +2614,7 @@ CURLcode Curl_http_bodysend(struct Curl_easy *data, struct connectdata *conn,
 
 #ifndef USE_HYPER
     /* With Hyper the body is always passed on separately */
-    if(data->set.postfields) {
+    if(data->set.postfields && !encode) {
 
       /* In HTTP2, we send request body in DATA frame regardless of
          its size. */
@@ -2639,6 +2710,13 @@ CURLcode Curl_http_bodysend(struct Curl_easy *data, struct connectdata *conn,
           http->postdata = (char *)&http->postdata;
       }
     }
+
+    if(encode) {
+      result = http_encode_body_start(data, httpreq);
+      if(result)
+        return result;
+    }
+
     /* issue the request */
     result = Curl_buffer_send(r, data, data->req.p.http,
                               &data->info.request_size, included_body,
@@ -2691,7 +2769,6 @@ CURLcode Curl_http_cookies(struct Curl_easy *data,
     addcookies = data->set.str[STRING_COOKIE];
 
   if(data->cookies || addcookies) {
-    struct Cookie *co = NULL; /* no cookies from start */
     int count = 0;
 
     if(data->cookies && data->state.cookie_engine) {
@@ -2702,37 +2779,41 @@ CURLcode Curl_http_cookies(struct Curl_easy *data,
         strcasecompare("localhost", host) ||
         !strcmp(host, "127.0.0.1") ||
         !strcmp(host, "::1") ? TRUE : FALSE;
+      struct Curl_llist list;
+      /* the list borrows the cookies from the jar, keep it locked until the
+         header is done */
       Curl_share_lock(data, CURL_LOCK_DATA_COOKIE, CURL_LOCK_ACCESS_SINGLE);
-      co = Curl_cookie_getlist(data, data->cookies, host, data->state.up.path,
-                               secure_context);
-      Curl_share_unlock(data, CURL_LOCK_DATA_COOKIE);
-    }
-    if(co) {
-      struct Cookie *store = co;
-      /* now loop through all cookies that matched */
-      while(co) {
-        if(co->value) {
-          if(0 == count) {
-            result = Curl_dyn_addn(r, STRCONST("Cookie: "));
+      result = Curl_cookie_getlist(data, data->cookies, host,
+                                   data->state.up.path, secure_context,
+                                   &data->req.arena, &list);
+      if(!result) {
+        struct Curl_llist_element *n;
+        /* now loop through all cookies that matched */
+        for(n = list.head; n; n = n->next) {
+          struct Cookie *co = n->ptr;
+          if(co->value) {
+            if(0 == count) {
+              result = Curl_dyn_addn(r, STRCONST("Cookie: "));
+              if(result)
+                break;
+            }
+            if((Curl_dyn_len(r) + strlen(co->name) + strlen(co->value) + 1) >=
+               MAX_COOKIE_HEADER_LEN) {
+              infof(data, "Restricted outgoing cookies due to header size, "
+                    "'%s' not sent", co->name);
+              linecap = TRUE;
+              break;
+            }
+            result = Curl_dyn_addf(r, "%s%s=%s", count?"; ":"",
+                                   co->name, co->value);
             if(result)
               break;
+            count++;
           }
-          if((Curl_dyn_len(r) + strlen(co->name) + strlen(co->value) + 1) >=
-             MAX_COOKIE_HEADER_LEN) {
-            infof(data, "Restricted outgoing cookies due to header size, "
-                  "'%s' not sent", co->name);
-            linecap = TRUE;
-            break;
-          }
-          result = Curl_dyn_addf(r, "%s%s=%s", count?"; ":"",
-                                 co->name, co->value);
-          if(result)
-            break;
-          count++;
         }
-        co = co->next; /* next cookie please */
+        Curl_llist_destroy(&list, NULL);
       }
-      Curl_cookie_freelist(store);
+      Curl_share_unlock(data, CURL_LOCK_DATA_COOKIE);
     }
     if(addcookies && !result && !linecap) {
       if(!count)
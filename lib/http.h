@@ -235,6 +235,7 @@ struct HTTP {
   size_t push_headers_used;  /* number of entries filled in */
   size_t push_headers_alloc; /* number of entries allocated */
   uint32_t error; /* HTTP/2 stream error code */
+  uint32_t local_window; /* receive window last set for the stream */
 #endif
 #if defined(USE_NGHTTP2) || defined(USE_NGHTTP3)
   bool bodystarted;
@@ -62,7 +62,15 @@
 #define NGHTTP2_HAS_SET_LOCAL_WINDOW_SIZE 1
 #endif
 
-#define HTTP2_HUGE_WINDOW_SIZE (32 * 1024 * 1024) /* 32 MB */
+/* The receive windows start out at H2_WINDOW_INITIAL and are grown from
+   there as the bandwidth-delay product of the connection is measured, up to
+   H2_WINDOW_MAX. A connection never gets less than H2_WINDOW_MIN. */
+#define H2_WINDOW_INITIAL (1024 * 1024)     /* 1 MB */
+#define H2_WINDOW_MAX (32 * 1024 * 1024)    /* 32 MB */
+#define H2_WINDOW_MIN NGHTTP2_INITIAL_WINDOW_SIZE
+
+/* opaque data of the PING frames used for measuring */
+static const uint8_t bdp_ping_data[8] = "curlbdp";
 
 #define DEBUG_HTTP2
 #ifdef DEBUG_HTTP2
@@ -82,7 +90,7 @@ static int populate_settings(nghttp2_settings_entry *iv,
   iv[0].value = Curl_multi_max_concurrent_streams(data->multi);
 
   iv[1].settings_id = NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE;
-  iv[1].value = HTTP2_HUGE_WINDOW_SIZE;
+  iv[1].value = H2_WINDOW_INITIAL;
 
   iv[2].settings_id = NGHTTP2_SETTINGS_ENABLE_PUSH;
   iv[2].value = data->multi->push_cb != NULL;
@@ -117,6 +125,9 @@ struct h2_cf_ctx {
   size_t inbuflen; /* number of bytes filled in inbuf */
   size_t nread_inbuf; /* number of bytes read from in inbuf */
 
+  char *outbuf; /* frames from nghttp2 collected to be sent together */
+  size_t outbuflen; /* number of bytes in outbuf */
+
   /* We need separate buffer for transmission and reception because we
      may call nghttp2_session_send() after the
      nghttp2_session_mem_recv() but mem buffer is still not full. In
@@ -125,6 +136,13 @@ struct h2_cf_ctx {
   int32_t pause_stream_id; /* stream ID which paused
                               nghttp2_session_mem_recv */
   size_t drain_total; /* sum of all stream's UrlState.drain */
+
+  uint32_t conn_window; /* local connection window, counted in the multi's
+                           h2_window */
+  uint32_t stream_window; /* local window for streams that are not paused */
+  struct curltime bdp_ping_sent; /* when the outstanding BDP ping was sent */
+  size_t bdp_bytes; /* DATA bytes received since then */
+  bool bdp_ping_out; /* a BDP ping is waiting for its ACK */
 };
 
 static void h2_cf_ctx_clear(struct h2_cf_ctx *ctx)
@@ -133,6 +151,7 @@ static void h2_cf_ctx_clear(struct h2_cf_ctx *ctx)
     nghttp2_session_del(ctx->h2);
   }
   free(ctx->inbuf);
+  free(ctx->outbuf);
   memset(ctx, 0, sizeof(*ctx));
 }
 
@@ -225,10 +244,126 @@ static CURLcode http2_data_setup(struct Curl_cfilter *cf,
   stream->upload_len = 0;
   stream->mem = data->state.buffer;
   stream->len = data->set.buffer_size;
+  stream->local_window = H2_WINDOW_INITIAL;
 
   return CURLE_OK;
 }
 
+/*
+ * Set the local connection window to 'want', or less if that would make the
+ * sum of all connection windows in the multi handle exceed its limit.
+ */
+static int h2_conn_window_set(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              uint32_t want)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  struct Curl_multi *multi = data->multi;
+  int rc;
+
+  if(multi) {
+    size_t others = multi->h2_window - CURLMIN(multi->h2_window,
+                                               ctx->conn_window);
+    if(multi->max_h2_window) {
+      size_t avail = multi->max_h2_window -
+        CURLMIN(multi->max_h2_window, others);
+      if(want > avail)
+        want = (uint32_t)avail;
+    }
+    if(want < H2_WINDOW_MIN)
+      want = H2_WINDOW_MIN;
+    multi->h2_window = others + want;
+  }
+
+  rc = nghttp2_session_set_local_window_size(ctx->h2, NGHTTP2_FLAG_NONE, 0,
+                                             (int32_t)want);
+  if(rc)
+    return rc;
+  ctx->conn_window = want;
+  if(ctx->stream_window > want)
+    ctx->stream_window = want;
+  return 0;
+}
+
+/*
+ * Return the connection window to the multi handle, as the connection goes
+ * away.
+ */
+static void h2_conn_window_release(struct Curl_cfilter *cf,
+                                   struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  if(ctx && ctx->conn_window && data && data->multi) {
+    struct Curl_multi *multi = data->multi;
+    multi->h2_window -= CURLMIN(multi->h2_window, ctx->conn_window);
+    ctx->conn_window = 0;
+  }
+}
+
+/*
+ * Measure the bandwidth-delay product the same way gRPC does: a PING is sent
+ * when DATA arrives and the DATA received until its ACK comes back is what
+ * the connection delivers in one round trip. When that is close to the
+ * window, the window limits the transfer speed and gets doubled.
+ */
+static void h2_bdp_data(struct Curl_cfilter *cf, size_t len)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+
+  if(ctx->bdp_ping_out)
+    ctx->bdp_bytes += len;
+  else if(ctx->stream_window < H2_WINDOW_MAX) {
+    if(!nghttp2_submit_ping(ctx->h2, NGHTTP2_FLAG_NONE, bdp_ping_data)) {
+      ctx->bdp_ping_out = TRUE;
+      ctx->bdp_ping_sent = Curl_now();
+      ctx->bdp_bytes = len;
+    }
+  }
+}
+
+static void h2_bdp_ack(struct Curl_cfilter *cf, struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  size_t sample = ctx->bdp_bytes;
+
+  ctx->bdp_ping_out = FALSE;
+  if(sample * 3 >= (size_t)ctx->stream_window * 2) {
+    uint32_t want = (uint32_t)CURLMIN(sample * 2, H2_WINDOW_MAX);
+    if(want > ctx->stream_window) {
+      ctx->stream_window = want;
+      if(want > ctx->conn_window && h2_conn_window_set(cf, data, want))
+        return;
+      H2BUGF(infof(data, CFMSG(cf, "BDP %zu bytes in %" CURL_FORMAT_TIMEDIFF_T
+                               "us, window now %u/%u"), sample,
+                   Curl_timediff_us(Curl_now(), ctx->bdp_ping_sent),
+                   ctx->stream_window, ctx->conn_window));
+    }
+  }
+}
+
+/*
+ * Bring the local window of the transfer's stream to the size currently
+ * used for the connection. Paused transfers keep their closed window.
+ */
+static int h2_stream_window_update(struct Curl_cfilter *cf,
+                                   struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  struct HTTP *stream = data->req.p.http;
+
+  if((stream->stream_id > 0) &&
+     (stream->local_window != ctx->stream_window) &&
+     !(data->req.keepon & KEEP_RECV_PAUSE)) {
+    int32_t window = (int32_t)ctx->stream_window;
+    int rc = nghttp2_session_set_local_window_size(ctx->h2, NGHTTP2_FLAG_NONE,
+                                                   stream->stream_id, window);
+    if(rc)
+      return rc;
+    stream->local_window = ctx->stream_window;
+  }
+  return 0;
+}
+
 /*
  * Initialize the cfilter context
  */
@@ -246,6 +381,9 @@ static CURLcode h2_cf_ctx_init(struct Curl_cfilter *cf,
   ctx->inbuf = malloc(H2_BUFSIZE);
   if(!ctx->inbuf)
       goto out;
+  ctx->outbuf = malloc(H2_BUFSIZE);
+  if(!ctx->outbuf)
+      goto out;
 
   rc = nghttp2_session_callbacks_new(&cbs);
   if(rc) {
@@ -322,8 +460,8 @@ static CURLcode h2_cf_ctx_init(struct Curl_cfilter *cf,
     }
   }
 
-  rc = nghttp2_session_set_local_window_size(ctx->h2, NGHTTP2_FLAG_NONE, 0,
-                                             HTTP2_HUGE_WINDOW_SIZE);
+  ctx->stream_window = H2_WINDOW_INITIAL;
+  rc = h2_conn_window_set(cf, data, H2_WINDOW_INITIAL);
   if(rc) {
     failf(data, "nghttp2_session_set_local_window_size() failed: %s(%d)",
           nghttp2_strerror(rc), rc);
@@ -342,6 +480,7 @@ out:
 
 static int h2_session_send(struct Curl_cfilter *cf,
                            struct Curl_easy *data);
+static int h2_session_flush(struct Curl_cfilter *cf, struct Curl_easy *data);
 static int h2_process_pending_input(struct Curl_cfilter *cf,
                                     struct Curl_easy *data,
                                     CURLcode *err);
@@ -448,7 +587,7 @@ static CURLcode http2_send_ping(struct Curl_cfilter *cf,
   }
 
   set_transfer(ctx, data); /* set the transfer */
-  rc = nghttp2_session_send(ctx->h2);
+  rc = h2_session_flush(cf, data);
   if(rc) {
     failf(data, "nghttp2_session_send() failed: %s(%d)",
           nghttp2_strerror(rc), rc);
@@ -467,9 +606,37 @@ void Curl_http2_ver(char *p, size_t len)
 }
 
 /*
- * The implementation of nghttp2_send_callback type. Here we write |data| with
- * size |length| to the network and return the number of bytes actually
- * written. See the documentation of nghttp2_send_callback for the details.
+ * Send as much of the collected frames in outbuf as the lower filters take
+ * right now. Returns 0 or an nghttp2 error code.
+ */
+static int h2_out_flush(struct Curl_cfilter *cf, struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  CURLcode result = CURLE_OK;
+
+  while(ctx->outbuflen) {
+    ssize_t written = Curl_conn_cf_send(cf->next, data, ctx->outbuf,
+                                        ctx->outbuflen, &result);
+    if(written < 0) {
+      if(result == CURLE_AGAIN)
+        break;
+      failf(data, "Failed sending HTTP2 data");
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+    if(!written)
+      break;
+    ctx->outbuflen -= (size_t)written;
+    if(ctx->outbuflen)
+      memmove(ctx->outbuf, ctx->outbuf + written, ctx->outbuflen);
+  }
+  return 0;
+}
+
+/*
+ * The frames nghttp2 produces are collected in outbuf and sent together once
+ * the session has no more to send, or when outbuf is full. This makes one
+ * write of all frames that are ready on all streams instead of one write per
+ * frame. Large frames go out directly when nothing is collected.
  */
 static ssize_t send_callback(nghttp2_session *h2,
                              const uint8_t *buf, size_t blen, int flags,
@@ -478,26 +645,59 @@ static ssize_t send_callback(nghttp2_session *h2,
   struct Curl_cfilter *cf = userp;
   struct h2_cf_ctx *ctx = cf->ctx;
   struct Curl_easy *data = get_transfer(ctx);
-  ssize_t written;
-  CURLcode result = CURLE_OK;
+  size_t nwrite;
 
   (void)h2;
   (void)flags;
 
-  written = Curl_conn_cf_send(cf->next, data, buf, blen, &result);
-  if(result == CURLE_AGAIN) {
-    return NGHTTP2_ERR_WOULDBLOCK;
+  if(!ctx->outbuflen && (blen >= H2_BUFSIZE / 2)) {
+    CURLcode result = CURLE_OK;
+    ssize_t written = Curl_conn_cf_send(cf->next, data, buf, blen, &result);
+    if(result == CURLE_AGAIN)
+      return NGHTTP2_ERR_WOULDBLOCK;
+
+    if(written == -1) {
+      failf(data, "Failed sending HTTP2 data");
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+
+    if(!written)
+      return NGHTTP2_ERR_WOULDBLOCK;
+
+    return written;
   }
 
-  if(written == -1) {
-    failf(data, "Failed sending HTTP2 data");
-    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  if(ctx->outbuflen == H2_BUFSIZE) {
+    if(h2_out_flush(cf, data))
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    if(ctx->outbuflen == H2_BUFSIZE)
+      return NGHTTP2_ERR_WOULDBLOCK;
   }
 
-  if(!written)
-    return NGHTTP2_ERR_WOULDBLOCK;
+  nwrite = CURLMIN(blen, H2_BUFSIZE - ctx->outbuflen);
+  memcpy(ctx->outbuf + ctx->outbuflen, buf, nwrite);
+  ctx->outbuflen += nwrite;
+  return (ssize_t)nwrite;
+}
 
-  return written;
+/*
+ * Have nghttp2 produce all frames it has ready and send them off.
+ */
+static int h2_session_flush(struct Curl_cfilter *cf, struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+  int rv = nghttp2_session_send(ctx->h2);
+  if(!rv)
+    rv = h2_out_flush(cf, data);
+  return rv;
+}
+
+/*
+ * Returns nonzero if there is anything left to send on the connection.
+ */
+static int h2_want_write(struct h2_cf_ctx *ctx)
+{
+  return ctx->outbuflen || nghttp2_session_want_write(ctx->h2);
 }
 
 
@@ -803,6 +1003,12 @@ static int on_frame_recv(nghttp2_session *session, const nghttp2_frame *frame,
     case NGHTTP2_WINDOW_UPDATE:
       H2BUGF(infof(data, CFMSG(cf, "recv frame WINDOW_UPDATE")));
       break;
+    case NGHTTP2_PING:
+      if(data && ctx->bdp_ping_out && (frame->hd.flags & NGHTTP2_FLAG_ACK) &&
+         !memcmp(frame->ping.opaque_data, bdp_ping_data,
+                 sizeof(bdp_ping_data)))
+        h2_bdp_ack(cf, data);
+      break;
     default:
       H2BUGF(infof(data, CFMSG(cf, "recv frame %x on 0"), frame->hd.type));
     }
@@ -936,6 +1142,8 @@ static int on_data_chunk_recv(nghttp2_session *session, uint8_t flags,
   if(!stream)
     return NGHTTP2_ERR_CALLBACK_FAILURE;
 
+  h2_bdp_data(cf, len);
+
   nread = CURLMIN(stream->len, len);
   memcpy(&stream->mem[stream->memlen], mem, nread);
 
@@ -1335,9 +1543,14 @@ static void http2_data_done(struct Curl_cfilter *cf,
     /* RST_STREAM */
     set_transfer(ctx, data); /* set the transfer */
     H2BUGF(infof(data, "RST stream %u", stream->stream_id));
-    if(!nghttp2_submit_rst_stream(ctx->h2, NGHTTP2_FLAG_NONE,
-                                  stream->stream_id, NGHTTP2_STREAM_CLOSED))
-      (void)nghttp2_session_send(ctx->h2);
+    (void)nghttp2_submit_rst_stream(ctx->h2, NGHTTP2_FLAG_NONE,
+                                    stream->stream_id, NGHTTP2_STREAM_CLOSED);
+  }
+
+  if(h2_want_write(ctx)) {
+    /* send what is left now, this transfer does not come back for it */
+    set_transfer(ctx, data);
+    (void)h2_session_flush(cf, data);
   }
 
   if(data->state.drain)
@@ -1402,7 +1615,7 @@ CURLcode Curl_http2_request_upgrade(struct dynbuf *req,
 static int should_close_session(struct h2_cf_ctx *ctx)
 {
   return ctx->drain_total == 0 && !nghttp2_session_want_read(ctx->h2) &&
-    !nghttp2_session_want_write(ctx->h2);
+    !h2_want_write(ctx);
 }
 
 /*
@@ -1499,7 +1712,7 @@ static CURLcode http2_data_done_send(struct Curl_cfilter *cf,
   }
 
   /* If nghttp2 still has pending frames unsent */
-  if(nghttp2_session_want_write(ctx->h2)) {
+  if(h2_want_write(ctx)) {
     struct SingleRequest *k = &data->req;
     int rv;
 
@@ -1510,7 +1723,7 @@ static CURLcode http2_data_done_send(struct Curl_cfilter *cf,
     if(rv)
       result = CURLE_SEND_ERROR;
 
-    if(nghttp2_session_want_write(ctx->h2)) {
+    if(h2_want_write(ctx)) {
        /* re-set KEEP_SEND to make sure we are called again */
        k->keepon |= KEEP_SEND;
     }
@@ -1657,7 +1870,7 @@ static int h2_session_send(struct Curl_cfilter *cf, struct Curl_easy *data)
       return rv;
   }
 
-  return nghttp2_session_send(ctx->h2);
+  return h2_session_flush(cf, data);
 }
 
 static ssize_t h2_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
@@ -1683,6 +1896,18 @@ static ssize_t h2_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
   stream->upload_mem = NULL;
   stream->upload_len = 0;
 
+  /* the window update, if any, goes out with the next session send */
+  if(h2_stream_window_update(cf, data)) {
+    *err = CURLE_HTTP2;
+    return -1;
+  }
+
+  /* frames collected earlier that could not be sent then */
+  if(ctx->outbuflen && h2_out_flush(cf, data)) {
+    *err = CURLE_SEND_ERROR;
+    return -1;
+  }
+
   /*
    * At this point 'stream' is just in the Curl_easy the connection
    * identifies as its owner at this time.
@@ -1746,6 +1971,14 @@ static ssize_t h2_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
       stream->pausedata = NULL;
       stream->pauselen = 0;
 
+      /* Let DATA for this stream that is still in the connection buffer
+         get copied straight into the rest of the caller's buffer, behind
+         the data returned now, instead of it pausing the session again
+         and getting returned in a separate call. */
+      stream->mem = buf;
+      stream->memlen = nread;
+      stream->len = len - nread;
+
       /* When NGHTTP2_ERR_PAUSE is returned from
          data_source_read_callback, we might not process DATA frame
          fully.  Calling nghttp2_session_mem_recv() again will
@@ -1756,6 +1989,18 @@ static ssize_t h2_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
       if(h2_process_pending_input(cf, data, err) != 0) {
         return -1;
       }
+
+      if((size_t)nread < stream->memlen) {
+        nread = stream->memlen;
+        if(ctx->pause_stream_id == stream->stream_id)
+          ; /* paused again, more to return in the next call */
+        else if(!stream->closed)
+          drained_transfer(cf, data);
+        else
+          /* closed, trigger another read ASAP to detect that */
+          Curl_expire(data, 0, EXPIRE_RUN_NOW);
+      }
+      stream->memlen = 0;
     }
     H2BUGF(infof(data, "http2_recv: returns unpaused %zd bytes on stream %u",
                  nread, stream->stream_id));
@@ -2007,6 +2252,12 @@ static ssize_t h2_cf_send(struct Curl_cfilter *cf, struct Curl_easy *data,
         stream_id, (void *)data);
   stream->stream_id = stream_id;
 
+  /* a new stream starts with the initial window from our settings */
+  if(h2_stream_window_update(cf, data)) {
+    *err = CURLE_HTTP2;
+    return -1;
+  }
+
   rv = h2_session_send(cf, data);
   if(rv) {
     H2BUGF(infof(data,
@@ -2052,14 +2303,27 @@ static int h2_cf_get_select_socks(struct Curl_cfilter *cf,
     bitmap |= GETSOCK_READSOCK(0);
 
   /* we're (still uploading OR the HTTP/2 layer wants to send data) AND
-     there's a window to send data in */
-  if((((k->keepon & (KEEP_SEND|KEEP_SEND_PAUSE)) == KEEP_SEND) ||
-      nghttp2_session_want_write(ctx->h2)) &&
-     (nghttp2_session_get_remote_window_size(ctx->h2) &&
-      nghttp2_session_get_stream_remote_window_size(ctx->h2,
-                                                    stream->stream_id)))
+     there's a window to send data in, OR there are collected frames left to
+     send */
+  if(((((k->keepon & (KEEP_SEND|KEEP_SEND_PAUSE)) == KEEP_SEND) ||
+       nghttp2_session_want_write(ctx->h2)) &&
+      (nghttp2_session_get_remote_window_size(ctx->h2) &&
+       nghttp2_session_get_stream_remote_window_size(ctx->h2,
+                                                     stream->stream_id))) ||
+     ctx->outbuflen)
     bitmap |= GETSOCK_WRITESOCK(0);
 
+  /* the filters below may have to wait on the socket as well */
+  if(cf->next && cf->next->connected) {
+    curl_socket_t next_sock[MAX_SOCKSPEREASYHANDLE];
+    int next_bitmap = cf->next->cft->get_select_socks(cf->next, data,
+                                                      next_sock);
+    if(next_bitmap & GETSOCK_READSOCK(0))
+      bitmap |= GETSOCK_READSOCK(0);
+    if(next_bitmap & GETSOCK_WRITESOCK(0))
+      bitmap |= GETSOCK_WRITESOCK(0);
+  }
+
   return bitmap;
 }
 
@@ -2107,9 +2371,9 @@ static void h2_cf_close(struct Curl_cfilter *cf, struct Curl_easy *data)
 {
   struct h2_cf_ctx *ctx = cf->ctx;
 
-  (void)data;
   if(ctx) {
     /* GOAWAY? */
+    h2_conn_window_release(cf, data);
     h2_cf_ctx_clear(ctx);
   }
 }
@@ -2118,8 +2382,8 @@ static void h2_cf_destroy(struct Curl_cfilter *cf, struct Curl_easy *data)
 {
   struct h2_cf_ctx *ctx = cf->ctx;
 
-  (void)data;
   if(ctx) {
+    h2_conn_window_release(cf, data);
     h2_cf_ctx_free(ctx);
     cf->ctx = NULL;
   }
@@ -2135,7 +2399,7 @@ static CURLcode http2_data_pause(struct Curl_cfilter *cf,
 #ifdef NGHTTP2_HAS_SET_LOCAL_WINDOW_SIZE
   if(ctx && ctx->h2) {
     struct HTTP *stream = data->req.p.http;
-    uint32_t window = !pause * HTTP2_HUGE_WINDOW_SIZE;
+    uint32_t window = !pause * ctx->stream_window;
     int rv = nghttp2_session_set_local_window_size(ctx->h2,
                                                    NGHTTP2_FLAG_NONE,
                                                    stream->stream_id,
@@ -2145,6 +2409,7 @@ static CURLcode http2_data_pause(struct Curl_cfilter *cf,
             nghttp2_strerror(rv), rv);
       return CURLE_HTTP2;
     }
+    stream->local_window = window;
 
     /* make sure the window update gets sent */
     rv = h2_session_send(cf, data);
@@ -2169,6 +2434,25 @@ static CURLcode http2_data_pause(struct Curl_cfilter *cf,
   return CURLE_OK;
 }
 
+/*
+ * Send the frames that are collected or that nghttp2 has ready, for any
+ * stream on the connection. The transfer calls this when it had nothing to
+ * read or write, which includes the socket becoming writable while
+ * h2_cf_get_select_socks() asked for it.
+ */
+static CURLcode http2_data_idle(struct Curl_cfilter *cf,
+                                struct Curl_easy *data)
+{
+  struct h2_cf_ctx *ctx = cf->ctx;
+
+  if(ctx && ctx->h2 && h2_want_write(ctx)) {
+    set_transfer(ctx, data);
+    if(h2_session_flush(cf, data))
+      return CURLE_SEND_ERROR;
+  }
+  return CURLE_OK;
+}
+
 static CURLcode h2_cf_cntrl(struct Curl_cfilter *cf,
                             struct Curl_easy *data,
                             int event, int arg1, void *arg2)
@@ -2193,6 +2477,10 @@ static CURLcode h2_cf_cntrl(struct Curl_cfilter *cf,
     http2_data_done(cf, data, arg1 != 0);
     break;
   }
+  case CF_CTRL_DATA_IDLE: {
+    result = http2_data_idle(cf, data);
+    break;
+  }
   default:
     break;
   }
@@ -60,12 +60,79 @@
 
 static void sha256_to_hex(char *dst, unsigned char *sha, size_t dst_l)
 {
+  static const char hex[] = "0123456789abcdef";
   int i;
 
   DEBUGASSERT(dst_l >= 65);
+  (void)dst_l;
   for(i = 0; i < 32; ++i) {
-    msnprintf(dst + (i * 2), dst_l - (i * 2), "%02x", sha[i]);
+    dst[i * 2] = hex[sha[i] >> 4];
+    dst[i * 2 + 1] = hex[sha[i] & 0x0f];
   }
+  dst[64] = 0;
+}
+
+/* The signing key only depends on the secret and on the credential scope,
+   which changes once a day, so the last one derived is kept in the easy
+   handle. The secret is not stored, only a hash of it and the scope. */
+static CURLcode signing_key(struct Curl_easy *data,
+                            const char *secret,
+                            const char *date,
+                            const char *region,
+                            const char *service,
+                            const char *request_type,
+                            unsigned char *key)
+{
+  struct aws_sigv4_key *cache = data->state.aws_sigv4;
+  const char *parts[5];
+  struct dynbuf id_input;
+  unsigned char id[32];
+  unsigned char sign0[32];
+  CURLcode ret;
+  int i;
+
+  parts[0] = secret;
+  parts[1] = date;
+  parts[2] = region;
+  parts[3] = service;
+  parts[4] = request_type;
+
+  /* none of the parts contain a zero byte, so using their terminating zeroes
+     as separators makes the input unambiguous */
+  Curl_dyn_init(&id_input, CURL_MAX_INPUT_LENGTH);
+  for(i = 0; i < 5; i++) {
+    if(Curl_dyn_addn(&id_input, parts[i], strlen(parts[i]) + 1))
+      return CURLE_OUT_OF_MEMORY;
+  }
+  ret = Curl_sha256it(id, Curl_dyn_uptr(&id_input), Curl_dyn_len(&id_input));
+  Curl_dyn_free(&id_input);
+  if(ret)
+    return ret;
+
+  if(cache && !memcmp(cache->id, id, sizeof(id))) {
+    memcpy(key, cache->key, sizeof(cache->key));
+#ifdef DEBUGBUILD
+    infof(data, "aws_sigv4: reusing the kept signing key");
+#endif
+    return CURLE_OK;
+  }
+
+  HMAC_SHA256(secret, strlen(secret), date, strlen(date), sign0);
+  HMAC_SHA256(sign0, sizeof(sign0), region, strlen(region), key);
+  HMAC_SHA256(key, 32, service, strlen(service), sign0);
+  HMAC_SHA256(sign0, sizeof(sign0), request_type, strlen(request_type), key);
+
+  if(!cache) {
+    cache = malloc(sizeof(*cache));
+    if(!cache)
+      return CURLE_OK; /* works fine without it */
+    data->state.aws_sigv4 = cache;
+  }
+  memcpy(cache->id, id, sizeof(id));
+  memcpy(cache->key, key, sizeof(cache->key));
+
+fail:
+  return ret;
 }
 
 static char *find_date_hdr(struct Curl_easy *data, const char *sig_hdr)
@@ -135,6 +202,7 @@ static CURLcode make_headers(struct Curl_easy *data,
                              char *timestamp,
                              char *provider1,
                              char **date_header,
+                             struct curl_slist *extra,
                              struct dynbuf *canonical_headers,
                              struct dynbuf *signed_headers)
 {
@@ -196,6 +264,13 @@ static CURLcode make_headers(struct Curl_easy *data,
     head = tmp_head;
   }
 
+  for(l = extra; l; l = l->next) {
+    tmp_head = curl_slist_append(head, l->data);
+    if(!tmp_head)
+      goto fail;
+    head = tmp_head;
+  }
+
   trim_headers(head);
 
   *date_header = find_date_hdr(data, date_hdr_key);
@@ -267,6 +342,10 @@ fail:
 }
 
 #define CONTENT_SHA256_KEY_LEN (MAX_SIGV4_LEN + sizeof("X--Content-Sha256"))
+#define DECODED_LEN_KEY_LEN \
+  (MAX_SIGV4_LEN + sizeof("X--Decoded-Content-Length"))
+#define STREAMING_HASH_LEN \
+  (MAX_SIGV4_LEN + sizeof("STREAMING-4-HMAC-SHA256-PAYLOAD"))
 
 /* try to parse a payload hash from the content-sha256 header */
 static char *parse_content_sha_hdr(struct Curl_easy *data,
@@ -300,6 +379,277 @@ static char *parse_content_sha_hdr(struct Curl_easy *data,
   return value;
 }
 
+/*
+ * Streaming signed uploads (STREAMING-AWS4-HMAC-SHA256-PAYLOAD). The body is
+ * sent in "aws-chunked" encoding, every chunk carrying a signature that
+ * chains to the one of the chunk before it, starting with the signature of
+ * the request headers. The chunker is a read callback put in front of the one
+ * that provides the body, so only one chunk is kept in memory at a time.
+ */
+
+/* body bytes in each chunk but the last ones, AWS wants at least 8 KiB */
+#define AWS_CHUNK_SIZE (64 * 1024)
+/* room for "<hex size>;chunk-signature=<signature>\r\n" */
+#define AWS_CHUNK_HDR_MAX (16 + sizeof(";chunk-signature=") - 1 + 64 + 2)
+
+/* hex of the SHA-256 of nothing */
+#define EMPTY_SHA256 \
+  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+
+struct aws_chunker {
+  struct Curl_easy *data;
+  curl_read_callback fread_func; /* the body source */
+  void *in;
+  curl_off_t left;         /* body bytes not read into a chunk yet */
+  char *sts_prefix;        /* start of every chunk's string to sign */
+  unsigned char key[32];   /* the signing key */
+  char seed[65];           /* signature of the request headers, in hex */
+  char sig[65];            /* signature of the previous chunk, in hex */
+  char *out;               /* framed chunk not returned yet */
+  size_t outlen;
+  size_t filled;           /* body bytes read into the current chunk */
+  bool done;               /* the final, empty, chunk is framed */
+  char buf[AWS_CHUNK_HDR_MAX + AWS_CHUNK_SIZE + 2];
+};
+
+/* size of a chunk carrying 'n' body bytes, framing included */
+static curl_off_t aws_chunk_len(size_t n)
+{
+  char hex[17];
+  int hexlen = msnprintf(hex, sizeof(hex), "%zx", n);
+
+  return (curl_off_t)(hexlen + sizeof(";chunk-signature=") - 1 + 64 + 2 +
+                      n + 2);
+}
+
+/* size of a 'len' bytes body in aws-chunked encoding */
+static curl_off_t aws_chunked_size(curl_off_t len)
+{
+  curl_off_t full = len / AWS_CHUNK_SIZE;
+  size_t rest = (size_t)(len % AWS_CHUNK_SIZE);
+
+  return full * aws_chunk_len(AWS_CHUNK_SIZE) +
+    (rest ? aws_chunk_len(rest) : 0) + aws_chunk_len(0);
+}
+
+/* sign the body read into the chunker and frame it */
+static CURLcode aws_chunk_sign(struct aws_chunker *ch)
+{
+  char *body = &ch->buf[AWS_CHUNK_HDR_MAX];
+  unsigned char sha_hash[32];
+  char sha_hex[65];
+  char hdr[AWS_CHUNK_HDR_MAX + 1];
+  char *str_to_sign;
+  int hdrlen;
+  CURLcode ret;
+
+  if(Curl_sha256it(sha_hash, (unsigned char *)body, ch->filled))
+    return CURLE_OUT_OF_MEMORY;
+  sha256_to_hex(sha_hex, sha_hash, sizeof(sha_hex));
+
+  str_to_sign = curl_maprintf("%s%s\n" /* previous signature */
+                              EMPTY_SHA256 "\n"
+                              "%s", /* hash of the chunk */
+                              ch->sts_prefix, ch->sig, sha_hex);
+  if(!str_to_sign)
+    return CURLE_OUT_OF_MEMORY;
+  ret = Curl_hmacit(Curl_HMAC_SHA256, ch->key, sizeof(ch->key),
+                    (unsigned char *)str_to_sign, strlen(str_to_sign),
+                    sha_hash);
+  free(str_to_sign);
+  if(ret)
+    return ret;
+  sha256_to_hex(ch->sig, sha_hash, sizeof(ch->sig));
+
+  hdrlen = msnprintf(hdr, sizeof(hdr), "%zx;chunk-signature=%s\r\n",
+                     ch->filled, ch->sig);
+  ch->out = body - hdrlen;
+  memcpy(ch->out, hdr, hdrlen);
+  memcpy(body + ch->filled, "\r\n", 2);
+  ch->outlen = hdrlen + ch->filled + 2;
+
+  ch->left -= ch->filled;
+  if(!ch->filled)
+    ch->done = TRUE;
+  ch->filled = 0;
+  return CURLE_OK;
+}
+
+/* The read callback that returns the signed chunks. */
+static size_t aws_chunk_read(char *buffer, size_t size, size_t nitems,
+                             void *userp)
+{
+  struct aws_chunker *ch = (struct aws_chunker *)userp;
+  size_t len = size * nitems;
+
+  if(!ch->outlen) {
+    char *body = &ch->buf[AWS_CHUNK_HDR_MAX];
+    size_t want = (size_t)CURLMIN(ch->left, AWS_CHUNK_SIZE);
+
+    if(ch->done)
+      return 0;
+
+    /* all chunks but the last ones must be full, as the size of the whole
+       request body has been sent already */
+    while(ch->filled < want) {
+      size_t nread = ch->fread_func(body + ch->filled, 1,
+                                    want - ch->filled, ch->in);
+      if(nread == CURL_READFUNC_ABORT || nread == CURL_READFUNC_PAUSE)
+        return nread;
+      if(nread > want - ch->filled) {
+        failf(ch->data, "read function returned funny value");
+        return CURL_READFUNC_ABORT;
+      }
+      if(!nread) {
+        failf(ch->data, "read function returned less data than the "
+              "upload size");
+        return CURL_READFUNC_ABORT;
+      }
+      ch->filled += nread;
+    }
+
+    if(aws_chunk_sign(ch))
+      return CURL_READFUNC_ABORT;
+  }
+
+  len = CURLMIN(len, ch->outlen);
+  memcpy(buffer, ch->out, len);
+  ch->out += len;
+  ch->outlen -= len;
+  return len;
+}
+
+static CURLcode aws_chunker_init(struct Curl_easy *data,
+                                 const unsigned char *key,
+                                 const char *seed_sig,
+                                 const char *algorithm,
+                                 const char *timestamp,
+                                 const char *credential_scope)
+{
+  struct aws_chunker *ch;
+
+  Curl_aws_sigv4_cleanup(data);
+  ch = calloc(1, sizeof(*ch));
+  if(!ch)
+    return CURLE_OUT_OF_MEMORY;
+  ch->sts_prefix = curl_maprintf("%s-PAYLOAD\n%s\n%s\n",
+                                 algorithm, timestamp, credential_scope);
+  if(!ch->sts_prefix) {
+    free(ch);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  ch->data = data;
+  ch->left = data->set.filesize;
+  memcpy(ch->key, key, sizeof(ch->key));
+  strcpy(ch->seed, seed_sig);
+  strcpy(ch->sig, seed_sig);
+
+  ch->fread_func = data->state.fread_func;
+  ch->in = data->state.in;
+  data->state.fread_func = aws_chunk_read;
+  data->state.in = ch;
+  data->req.aws_chunker = ch;
+  return CURLE_OK;
+}
+
+/* Start the chunks over, for a body source rewound to its start. */
+void Curl_aws_sigv4_rewind(struct Curl_easy *data)
+{
+  struct aws_chunker *ch = data->req.aws_chunker;
+
+  if(ch) {
+    ch->left = data->set.filesize;
+    strcpy(ch->sig, ch->seed);
+    ch->outlen = 0;
+    ch->filled = 0;
+    ch->done = FALSE;
+  }
+}
+
+/* Clear memory about to be freed. The stores go through a volatile pointer,
+   as the compiler may drop a memset() of memory that is not read again. */
+static void wipe(void *ptr, size_t len)
+{
+  volatile unsigned char *p = ptr;
+
+  while(len--)
+    *p++ = 0;
+}
+
+/* Remove the chunker and put back the read callback it reads from. */
+void Curl_aws_sigv4_cleanup(struct Curl_easy *data)
+{
+  struct aws_chunker *ch = data->req.aws_chunker;
+
+  if(ch) {
+    if(data->state.in == ch) {
+      data->state.fread_func = ch->fread_func;
+      data->state.in = ch->in;
+    }
+    free(ch->sts_prefix);
+    wipe(ch->key, sizeof(ch->key));
+    free(ch);
+    data->req.aws_chunker = NULL;
+  }
+}
+
+/* The kept key can sign requests for the rest of its day, so it is wiped
+   before it is freed. */
+void Curl_aws_sigv4_free(struct Curl_easy *data)
+{
+  if(data->state.aws_sigv4) {
+    wipe(data->state.aws_sigv4, sizeof(*data->state.aws_sigv4));
+    Curl_safefree(data->state.aws_sigv4);
+  }
+}
+
+/* The headers that go with a streaming signed upload, added to 'extra' to be
+   signed and to 'out' to be sent. */
+static CURLcode stream_headers(struct Curl_easy *data,
+                               const char *provider1,
+                               struct curl_slist **extra,
+                               struct dynbuf *out)
+{
+  char key[DECODED_LEN_KEY_LEN];
+  size_t key_len;
+  char *hdr[2];
+  struct curl_slist *tmp;
+  CURLcode ret = CURLE_OK;
+  int i;
+
+  hdr[0] = NULL;
+  hdr[1] = NULL;
+  if(!Curl_checkheaders(data, STRCONST("Content-Encoding"))) {
+    hdr[0] = strdup("Content-Encoding: aws-chunked");
+    if(!hdr[0])
+      return CURLE_OUT_OF_MEMORY;
+  }
+  key_len = msnprintf(key, sizeof(key), "x-%s-decoded-content-length",
+                      provider1);
+  if(!Curl_checkheaders(data, key, key_len)) {
+    hdr[1] = curl_maprintf("%s: %" CURL_FORMAT_CURL_OFF_T,
+                           key, data->set.filesize);
+    if(!hdr[1]) {
+      free(hdr[0]);
+      return CURLE_OUT_OF_MEMORY;
+    }
+  }
+
+  for(i = 0; i < 2; i++) {
+    if(!hdr[i])
+      continue;
+    tmp = curl_slist_append(*extra, hdr[i]);
+    if(!tmp || Curl_dyn_addf(out, "%s\r\n", hdr[i])) {
+      ret = CURLE_OUT_OF_MEMORY;
+      break;
+    }
+    *extra = tmp;
+  }
+  free(hdr[0]);
+  free(hdr[1]);
+  return ret;
+}
+
 CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
 {
   CURLcode ret = CURLE_OUT_OF_MEMORY;
@@ -333,6 +683,11 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
   unsigned char sign0[32] = {0};
   unsigned char sign1[32] = {0};
   char *auth_headers = NULL;
+  Curl_HttpReq httpreq;
+  const char *method;
+  bool streaming = FALSE;
+  struct curl_slist *extra = NULL;
+  struct dynbuf extra_headers;
 
   DEBUGASSERT(!proxy);
   (void)proxy;
@@ -345,6 +700,7 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
   /* we init those buffers here, so goto fail will free initialized dynbuf */
   Curl_dyn_init(&canonical_headers, CURL_MAX_HTTP_HEADER);
   Curl_dyn_init(&signed_headers, CURL_MAX_HTTP_HEADER);
+  Curl_dyn_init(&extra_headers, CURL_MAX_HTTP_HEADER);
 
   /*
    * Parameters parsing
@@ -428,8 +784,39 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
     goto fail;
   }
 
+  Curl_http_method(data, conn, &method, &httpreq);
+
+  payload_hash = parse_content_sha_hdr(data, provider1, &payload_hash_len);
+  if(payload_hash) {
+    char stream_hash[STREAMING_HASH_LEN];
+    size_t stream_hash_len =
+      msnprintf(stream_hash, sizeof(stream_hash),
+                "STREAMING-%s4-HMAC-SHA256-PAYLOAD", provider0);
+    streaming = (payload_hash_len == stream_hash_len) &&
+      strncasecompare(payload_hash, stream_hash, stream_hash_len);
+  }
+  if(streaming) {
+    /* the size of the signed body goes into the headers */
+    if(httpreq != HTTPREQ_PUT || data->set.filesize < 0 ||
+       data->set.str[STRING_UPLOAD_ENCODING]) {
+      failf(data, "streaming signatures need an upload of known size");
+      ret = CURLE_BAD_FUNCTION_ARGUMENT;
+      goto fail;
+    }
+    if(data->state.resume_from) {
+      /* the chunks are signed from the start of the body on */
+      failf(data, "streaming signatures cannot resume an upload");
+      ret = CURLE_BAD_FUNCTION_ARGUMENT;
+      goto fail;
+    }
+    ret = stream_headers(data, provider1, &extra, &extra_headers);
+    if(ret)
+      goto fail;
+  }
+
   ret = make_headers(data, hostname, timestamp, provider1,
-                     &date_header, &canonical_headers, &signed_headers);
+                     &date_header, extra, &canonical_headers,
+                     &signed_headers);
   if(ret)
     goto fail;
   ret = CURLE_OUT_OF_MEMORY;
@@ -437,8 +824,6 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
   memcpy(date, timestamp, sizeof(date));
   date[sizeof(date) - 1] = 0;
 
-  payload_hash = parse_content_sha_hdr(data, provider1, &payload_hash_len);
-
   if(!payload_hash) {
     if(post_data) {
       if(data->set.postfieldsize < 0)
@@ -455,28 +840,21 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
     payload_hash_len = strlen(sha_hex);
   }
 
-  {
-    Curl_HttpReq httpreq;
-    const char *method;
-
-    Curl_http_method(data, conn, &method, &httpreq);
-
-    canonical_request =
-      curl_maprintf("%s\n" /* HTTPRequestMethod */
-                    "%s\n" /* CanonicalURI */
-                    "%s\n" /* CanonicalQueryString */
-                    "%s\n" /* CanonicalHeaders */
-                    "%s\n" /* SignedHeaders */
-                    "%.*s",  /* HashedRequestPayload in hex */
-                    method,
-                    data->state.up.path,
-                    data->state.up.query ? data->state.up.query : "",
-                    Curl_dyn_ptr(&canonical_headers),
-                    Curl_dyn_ptr(&signed_headers),
-                    (int)payload_hash_len, payload_hash);
-    if(!canonical_request)
-      goto fail;
-  }
+  canonical_request =
+    curl_maprintf("%s\n" /* HTTPRequestMethod */
+                  "%s\n" /* CanonicalURI */
+                  "%s\n" /* CanonicalQueryString */
+                  "%s\n" /* CanonicalHeaders */
+                  "%s\n" /* SignedHeaders */
+                  "%.*s",  /* HashedRequestPayload in hex */
+                  method,
+                  data->state.up.path,
+                  data->state.up.query ? data->state.up.query : "",
+                  Curl_dyn_ptr(&canonical_headers),
+                  Curl_dyn_ptr(&signed_headers),
+                  (int)payload_hash_len, payload_hash);
+  if(!canonical_request)
+    goto fail;
 
   /* provider 0 lowercase */
   Curl_strntolower(provider0, provider0, strlen(provider0));
@@ -521,10 +899,10 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
   if(!secret)
     goto fail;
 
-  HMAC_SHA256(secret, strlen(secret), date, strlen(date), sign0);
-  HMAC_SHA256(sign0, sizeof(sign0), region, strlen(region), sign1);
-  HMAC_SHA256(sign1, sizeof(sign1), service, strlen(service), sign0);
-  HMAC_SHA256(sign0, sizeof(sign0), request_type, strlen(request_type), sign1);
+  ret = signing_key(data, secret, date, region, service, request_type,
+                    sign1);
+  if(ret)
+    goto fail;
   HMAC_SHA256(sign1, sizeof(sign1), str_to_sign, strlen(str_to_sign), sign0);
 
   sha256_to_hex(sha_hex, sign0, sizeof(sha_hex));
@@ -534,17 +912,35 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
                                "Credential=%s/%s, "
                                "SignedHeaders=%s, "
                                "Signature=%s\r\n"
-                               "%s\r\n",
+                               "%s\r\n"
+                               "%s",
                                provider0,
                                user,
                                credential_scope,
                                Curl_dyn_ptr(&signed_headers),
                                sha_hex,
-                               date_header);
+                               date_header,
+                               Curl_dyn_len(&extra_headers) ?
+                               Curl_dyn_ptr(&extra_headers) : "");
   if(!auth_headers) {
     goto fail;
   }
 
+  if(streaming) {
+    char algorithm[MAX_SIGV4_LEN + sizeof("4-HMAC-SHA256")];
+
+    msnprintf(algorithm, sizeof(algorithm), "%s4-HMAC-SHA256", provider0);
+    /* sign1 still holds the signing key */
+    ret = aws_chunker_init(data, sign1, sha_hex, algorithm, timestamp,
+                           credential_scope);
+    if(ret) {
+      free(auth_headers);
+      goto fail;
+    }
+    /* what is sent is the body with the chunk framing */
+    data->state.infilesize = aws_chunked_size(data->set.filesize);
+  }
+
   Curl_safefree(data->state.aptr.userpwd);
   data->state.aptr.userpwd = auth_headers;
   data->state.authhost.done = TRUE;
@@ -553,6 +949,8 @@ CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy)
 fail:
   Curl_dyn_free(&canonical_headers);
   Curl_dyn_free(&signed_headers);
+  Curl_dyn_free(&extra_headers);
+  curl_slist_free_all(extra);
   free(canonical_request);
   free(request_type);
   free(credential_scope);
@@ -25,7 +25,26 @@
  ***************************************************************************/
 #include "curl_setup.h"
 
+/* The last signing key derived, kept in the easy handle */
+struct aws_sigv4_key {
+  unsigned char id[32];  /* SHA-256 of the secret and the scope parts */
+  unsigned char key[32]; /* the signing key derived from them */
+};
+
 /* this is for creating aws_sigv4 header output */
 CURLcode Curl_output_aws_sigv4(struct Curl_easy *data, bool proxy);
 
+#if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_CRYPTO_AUTH)
+/* remove the chunk signer of a streaming signed upload */
+void Curl_aws_sigv4_cleanup(struct Curl_easy *data);
+/* restart the chunk signer when the upload is rewound */
+void Curl_aws_sigv4_rewind(struct Curl_easy *data);
+/* wipe and free the kept signing key */
+void Curl_aws_sigv4_free(struct Curl_easy *data);
+#else
+#define Curl_aws_sigv4_cleanup(x) Curl_nop_stmt
+#define Curl_aws_sigv4_rewind(x) Curl_nop_stmt
+#define Curl_aws_sigv4_free(x) Curl_nop_stmt
+#endif
+
 #endif /* HEADER_CURL_HTTP_AWS_SIGV4_H */
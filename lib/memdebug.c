@@ -129,6 +129,16 @@ static bool countcheck(const char *func, int line, const char *source)
   return FALSE; /* allow this */
 }
 
+/* Arena allocations do not call malloc() one by one. This is called for each
+   of them instead, to make them fail as part of the memory limit countdown
+   just like plain allocations. Returns TRUE if this one should fail. */
+bool curl_dbg_arena(size_t size, int line, const char *source)
+{
+  DEBUGASSERT(size != 0);
+  (void)size;
+  return countcheck("arena", line, source);
+}
+
 ALLOC_FUNC void *curl_dbg_malloc(size_t wantedsize,
                                  int line, const char *source)
 {
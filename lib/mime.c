@@ -43,6 +43,7 @@
 #include "slist.h"
 #include "strcase.h"
 #include "dynbuf.h"
+#include "curl_base64.h"
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
@@ -437,6 +438,7 @@ static size_t encoder_base64_read(char *buffer, size_t size, bool ateof,
 {
   struct mime_encoder_state *st = &part->encstate;
   size_t cursize = 0;
+  size_t len;
   int i;
   char *ptr = buffer;
 
@@ -465,17 +467,19 @@ static size_t encoder_base64_read(char *buffer, size_t size, bool ateof,
     if(st->bufend - st->bufbeg < 3)
       break;
 
-    /* Encode three bytes as four characters. */
-    i = st->buf[st->bufbeg++] & 0xFF;
-    i = (i << 8) | (st->buf[st->bufbeg++] & 0xFF);
-    i = (i << 8) | (st->buf[st->bufbeg++] & 0xFF);
-    *ptr++ = base64[(i >> 18) & 0x3F];
-    *ptr++ = base64[(i >> 12) & 0x3F];
-    *ptr++ = base64[(i >> 6) & 0x3F];
-    *ptr++ = base64[i & 0x3F];
-    cursize += 4;
-    st->pos += 4;
-    size -= 4;
+    /* Encode as many groups of three bytes as fit on the line. */
+    len = (MAX_ENCODED_LINE_LENGTH - st->pos) / 4;
+    if(len > size / 4)
+      len = size / 4;
+    if(len > (st->bufend - st->bufbeg) / 3)
+      len = (st->bufend - st->bufbeg) / 3;
+    len = Curl_base64_encode_block((unsigned char *)st->buf + st->bufbeg,
+                                   len * 3, ptr);
+    st->bufbeg += len / 4 * 3;
+    ptr += len;
+    cursize += len;
+    st->pos += len;
+    size -= len;
   }
 
   /* If at eof, we have to flush the buffered data. */
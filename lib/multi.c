@@ -48,8 +48,10 @@
 #include "vtls/vtls.h"
 #include "http_proxy.h"
 #include "http2.h"
+#include "http_aws_sigv4.h"
 #include "socketpair.h"
 #include "socks.h"
+#include "thrdpool.h"
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
 #include "curl_memory.h"
@@ -1467,6 +1469,17 @@ CURLMcode curl_multi_wakeup(struct Curl_multi *multi)
   if(!GOOD_MULTI_HANDLE(multi))
     return CURLM_BAD_HANDLE;
 
+  return Curl_multi_wakeup(multi);
+}
+
+/*
+ * Curl_multi_wakeup() is curl_multi_wakeup() without the handle check, for
+ * libcurl's own threads. They are stopped before the multi handle is
+ * cleaned up, but may call this while curl_multi_cleanup() has already
+ * marked the handle as bad.
+ */
+CURLMcode Curl_multi_wakeup(struct Curl_multi *multi)
+{
 #ifdef ENABLE_WAKEUP
 #ifdef USE_WINSOCK
   if(WSASetEvent(multi->wsa_event))
@@ -1747,6 +1760,9 @@ static CURLcode readrewind(struct Curl_easy *data)
      starts */
   data->req.keepon &= ~KEEP_SEND;
 
+  /* a streaming signed upload signs its chunks over again */
+  Curl_aws_sigv4_rewind(data);
+
   /* We have sent away data. If not using CURLOPT_POSTFIELDS or
      CURLOPT_HTTPPOST, call app to rewind
   */
@@ -2730,6 +2746,11 @@ CURLMcode curl_multi_cleanup(struct Curl_multi *multi)
     if(multi->in_callback)
       return CURLM_RECURSIVE_API_CALL;
 
+#ifdef USE_THRDPOOL
+    /* no thread may use the handle from here on */
+    Curl_thrdpool_quiesce(multi->verify_pool);
+#endif
+
     multi->magic = 0; /* not good anymore */
 
     /* First remove all remaining easy handles */
@@ -2769,6 +2790,11 @@ CURLMcode curl_multi_cleanup(struct Curl_multi *multi)
     Curl_hash_destroy(&multi->hostcache);
     Curl_psl_destroy(&multi->psl);
 
+#ifdef USE_THRDPOOL
+    /* before the wakeup pair is closed, the threads may still use it */
+    Curl_thrdpool_destroy(multi->verify_pool);
+#endif
+
 #ifdef USE_WINSOCK
     WSACloseEvent(multi->wsa_event);
 #else
@@ -3283,6 +3309,24 @@ CURLMcode curl_multi_setopt(struct Curl_multi *multi,
       multi->max_concurrent_streams = curlx_sltoui(streams);
     }
     break;
+  case CURLMOPT_MAX_HTTP2_WINDOW:
+    {
+      long window = va_arg(param, long);
+      if(window < 0)
+        window = 0;
+      multi->max_h2_window = (size_t)window;
+    }
+    break;
+  case CURLMOPT_SSL_VERIFY_THREADS:
+    {
+      long threads = va_arg(param, long);
+      if(threads < 0)
+        threads = 0;
+      else if(threads > 64)
+        threads = 64;
+      multi->ssl_verify_threads = (int)threads;
+    }
+    break;
   default:
     res = CURLM_UNKNOWN_OPTION;
     break;
@@ -3742,3 +3786,15 @@ unsigned int Curl_multi_max_concurrent_streams(struct Curl_multi *multi)
   DEBUGASSERT(multi);
   return multi->max_concurrent_streams;
 }
+
+#ifdef USE_THRDPOOL
+struct Curl_thrdpool *Curl_multi_verify_pool(struct Curl_multi *multi)
+{
+  DEBUGASSERT(multi);
+  if(!multi->verify_pool && multi->ssl_verify_threads)
+    /* on failure, verification stays in this thread */
+    multi->verify_pool = Curl_thrdpool_create(multi,
+                                              multi->ssl_verify_threads);
+  return multi->verify_pool;
+}
+#endif
@@ -149,6 +149,12 @@ struct Curl_multi {
   struct curltime timer_lastcall; /* the fixed time for the timeout for the
                                     previous callback */
   unsigned int max_concurrent_streams;
+  size_t max_h2_window; /* if >0, limit of the sum of the HTTP/2 connection
+                           receive windows */
+  size_t h2_window; /* sum of the current HTTP/2 connection receive
+                       windows */
+  int ssl_verify_threads; /* CURLMOPT_SSL_VERIFY_THREADS */
+  struct Curl_thrdpool *verify_pool; /* started on first use */
 
 #ifdef USE_WINSOCK
   WSAEVENT wsa_event; /* winsock event used for waits */
@@ -95,7 +95,14 @@ CURLMcode Curl_multi_add_perform(struct Curl_multi *multi,
                                  struct connectdata *conn);
 
 
+/* curl_multi_wakeup() for a handle libcurl's own threads know is good */
+CURLMcode Curl_multi_wakeup(struct Curl_multi *multi);
+
 /* Return the value of the CURLMOPT_MAX_CONCURRENT_STREAMS option */
 unsigned int Curl_multi_max_concurrent_streams(struct Curl_multi *multi);
 
+/* Return the pool of threads to verify server certificates in, starting it
+   when needed, or NULL when CURLMOPT_SSL_VERIFY_THREADS is not set */
+struct Curl_thrdpool *Curl_multi_verify_pool(struct Curl_multi *multi);
+
 #endif /* HEADER_CURL_MULTIIF_H */
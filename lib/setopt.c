@@ -600,6 +600,15 @@ CURLcode Curl_vsetopt(struct Curl_easy *data, CURLoption option, va_list param)
       result = Curl_setstropt(&data->set.str[STRING_ENCODING], argptr);
     break;
 
+  case CURLOPT_UPLOAD_ENCODING:
+    /*
+     * Content encoding to compress the request body with, or NULL to send
+     * it as it is.
+     */
+    result = Curl_setstropt(&data->set.str[STRING_UPLOAD_ENCODING],
+                            va_arg(param, char *));
+    break;
+
   case CURLOPT_TRANSFER_ENCODING:
     data->set.http_transfer_encoding = (0 != va_arg(param, long)) ?
       TRUE : FALSE;
@@ -944,6 +953,25 @@ CURLcode Curl_vsetopt(struct Curl_easy *data, CURLoption option, va_list param)
      */
     data->set.http200aliases = va_arg(param, struct curl_slist *);
     break;
+
+#ifdef HAVE_ZSTD
+  case CURLOPT_ZSTD_DICTIONARIES:
+    /*
+     * Set a list of zstd dictionary files to decode content with
+     */
+    data->set.zstd_dicts = va_arg(param, struct curl_slist *);
+    Curl_zstd_dicts_free(data);
+    break;
+
+  case CURLOPT_ZSTD_DICTIONARY_BLOB:
+    /*
+     * Blob that holds a zstd dictionary to decode content with
+     */
+    result = Curl_setblobopt(&data->set.blobs[BLOB_ZSTD_DICT],
+                             va_arg(param, struct curl_blob *));
+    Curl_zstd_dicts_free(data);
+    break;
+#endif
 #endif   /* CURL_DISABLE_HTTP */
 
 #if !defined(CURL_DISABLE_HTTP) || !defined(CURL_DISABLE_SMTP) ||       \
@@ -2365,6 +2393,8 @@ CURLcode Curl_vsetopt(struct Curl_easy *data, CURLoption option, va_list param)
     data->set.ssl.revoke_best_effort = !!(arg & CURLSSLOPT_REVOKE_BEST_EFFORT);
     data->set.ssl.native_ca_store = !!(arg & CURLSSLOPT_NATIVE_CA);
     data->set.ssl.auto_client_cert = !!(arg & CURLSSLOPT_AUTO_CLIENT_CERT);
+    data->set.ssl.ktls = !!(arg & CURLSSLOPT_KTLS);
+    data->set.ssl.earlydata = !!(arg & CURLSSLOPT_EARLYDATA);
     /* If a setting is added here it should also be added in dohprobe()
        which sets its own CURLOPT_SSL_OPTIONS based on these settings. */
     break;
@@ -2381,6 +2411,7 @@ CURLcode Curl_vsetopt(struct Curl_easy *data, CURLoption option, va_list param)
     data->set.proxy_ssl.native_ca_store = !!(arg & CURLSSLOPT_NATIVE_CA);
     data->set.proxy_ssl.auto_client_cert =
       !!(arg & CURLSSLOPT_AUTO_CLIENT_CERT);
+    data->set.proxy_ssl.ktls = !!(arg & CURLSSLOPT_KTLS);
     break;
 #endif
 
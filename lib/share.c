@@ -129,6 +129,12 @@ curl_share_setopt(struct Curl_share *share, CURLSHoption option, ...)
 #endif
       break;
 
+    case CURL_LOCK_DATA_CA_STORE:
+#ifndef USE_SSL
+      res = CURLSHE_NOT_BUILT_IN;
+#endif
+      break;
+
     default:
       res = CURLSHE_BAD_OPTION;
     }
@@ -176,6 +182,14 @@ curl_share_setopt(struct Curl_share *share, CURLSHoption option, ...)
     case CURL_LOCK_DATA_CONNECT:
       break;
 
+    case CURL_LOCK_DATA_CA_STORE:
+#ifdef USE_SSL
+      Curl_ssl_ca_store_unshare(share);
+#else
+      res = CURLSHE_NOT_BUILT_IN;
+#endif
+      break;
+
     default:
       res = CURLSHE_BAD_OPTION;
       break;
@@ -224,6 +238,16 @@ curl_share_cleanup(struct Curl_share *share)
   }
 
   Curl_conncache_close_all_connections(&share->conn_cache);
+
+#ifdef USE_SSL
+  if(share->ca_store_users) {
+    /* connections elsewhere still verify with the shared CA store */
+    if(share->unlockfunc)
+      share->unlockfunc(NULL, CURL_LOCK_DATA_SHARE, share->clientdata);
+    return CURLSHE_IN_USE;
+  }
+#endif
+
   Curl_conncache_destroy(&share->conn_cache);
   Curl_hash_destroy(&share->hostcache);
 
@@ -242,6 +266,7 @@ curl_share_cleanup(struct Curl_share *share)
       Curl_ssl_kill_session(&(share->sslsession[i]));
     free(share->sslsession);
   }
+  Curl_ssl_ca_store_unshare(share);
 #endif
 
   Curl_psl_destroy(&share->psl);
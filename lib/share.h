@@ -66,6 +66,8 @@ struct Curl_share {
   struct Curl_ssl_session *sslsession;
   size_t max_ssl_sessions;
   long sessionage;
+  struct Curl_ssl_ca_store *ca_store; /* CA store for new connections */
+  size_t ca_store_users; /* references to any CA store held outside */
 #endif
 };
 
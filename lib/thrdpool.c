@@ -0,0 +1,239 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include "thrdpool.h"
+
+#ifdef USE_THRDPOOL
+
+#include <curl/curl.h>
+
+#if defined(USE_THREADS_POSIX)
+#  ifdef HAVE_PTHREAD_H
+#    include <pthread.h>
+#  endif
+#endif
+
+#include "urldata.h"
+#include "curl_threads.h"
+#include "socketpair.h"
+#include "multiif.h"
+#include "curl_memory.h"
+/* The last #include file should be: */
+#include "memdebug.h"
+
+/*
+ * The worker threads block reading the socketpair. Every queued job writes
+ * one byte to it, so that one thread wakes up per job, and destroying the
+ * pool writes one byte per thread after setting 'quit'.
+ */
+struct Curl_thrdpool {
+  struct Curl_multi *multi;
+  curl_mutex_t mutex;
+  struct Curl_llist queue; /* jobs not yet picked up by a thread */
+  curl_socket_t sock[2];   /* 0 is read by the threads, 1 is written to */
+  curl_thread_t *threads;
+  int nthreads;
+  bool quit;
+};
+
+static void thrdpool_signal(struct Curl_thrdpool *pool)
+{
+  char buf[1];
+  buf[0] = 1;
+  while(swrite(pool->sock[1], buf, sizeof(buf)) < 0) {
+    if(SOCKERRNO != EINTR)
+      break;
+  }
+}
+
+static unsigned int CURL_STDCALL thrdpool_worker(void *arg)
+{
+  struct Curl_thrdpool *pool = arg;
+
+  for(;;) {
+    struct Curl_llist_element *e;
+    struct Curl_thrdjob *job;
+    char buf[1];
+    bool abandoned;
+    ssize_t nread = sread(pool->sock[0], buf, sizeof(buf));
+
+    if(nread < 0 && SOCKERRNO == EINTR)
+      continue;
+
+    Curl_mutex_acquire(&pool->mutex);
+    if(nread <= 0 || pool->quit) {
+      Curl_mutex_release(&pool->mutex);
+      break;
+    }
+    e = pool->queue.head;
+    if(!e) {
+      Curl_mutex_release(&pool->mutex);
+      continue;
+    }
+    job = e->ptr;
+    Curl_llist_remove(&pool->queue, e, NULL);
+    job->state = THRDJOB_RUNNING;
+    Curl_mutex_release(&pool->mutex);
+
+    job->run(job);
+
+    Curl_mutex_acquire(&pool->mutex);
+    abandoned = (job->state == THRDJOB_ABANDONED);
+    if(!abandoned)
+      job->state = THRDJOB_DONE;
+    Curl_mutex_release(&pool->mutex);
+
+    if(abandoned)
+      job->dtor(job);
+    else
+      Curl_multi_wakeup(pool->multi);
+  }
+  return 0;
+}
+
+struct Curl_thrdpool *Curl_thrdpool_create(struct Curl_multi *multi,
+                                           int threads)
+{
+  struct Curl_thrdpool *pool;
+  int i;
+
+  if(threads < 1)
+    return NULL;
+  pool = calloc(1, sizeof(*pool));
+  if(!pool)
+    return NULL;
+  pool->threads = calloc(threads, sizeof(curl_thread_t));
+  if(!pool->threads) {
+    free(pool);
+    return NULL;
+  }
+  if(Curl_socketpair(AF_UNIX, SOCK_STREAM, 0, pool->sock) < 0) {
+    free(pool->threads);
+    free(pool);
+    return NULL;
+  }
+  pool->multi = multi;
+  Curl_mutex_init(&pool->mutex);
+  Curl_llist_init(&pool->queue, NULL);
+
+  for(i = 0; i < threads; i++) {
+    curl_thread_t t = Curl_thread_create(thrdpool_worker, pool);
+    if(t == curl_thread_t_null)
+      break;
+    pool->threads[pool->nthreads++] = t;
+  }
+  if(!pool->nthreads) {
+    Curl_thrdpool_destroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void Curl_thrdpool_quiesce(struct Curl_thrdpool *pool)
+{
+  int i;
+
+  if(!pool)
+    return;
+
+  Curl_mutex_acquire(&pool->mutex);
+  pool->quit = TRUE;
+  Curl_mutex_release(&pool->mutex);
+  for(i = 0; i < pool->nthreads; i++)
+    thrdpool_signal(pool);
+  for(i = 0; i < pool->nthreads; i++)
+    Curl_thread_join(&pool->threads[i]);
+  pool->nthreads = 0;
+}
+
+void Curl_thrdpool_destroy(struct Curl_thrdpool *pool)
+{
+  struct Curl_llist_element *e;
+
+  if(!pool)
+    return;
+
+  Curl_thrdpool_quiesce(pool);
+
+  /* the owners of the jobs left are still waiting for them */
+  while((e = pool->queue.head)) {
+    struct Curl_thrdjob *job = e->ptr;
+    Curl_llist_remove(&pool->queue, e, NULL);
+    job->run(job);
+    job->pool = NULL;
+    job->state = THRDJOB_DONE;
+  }
+
+  sclose(pool->sock[0]);
+  sclose(pool->sock[1]);
+  Curl_mutex_destroy(&pool->mutex);
+  free(pool->threads);
+  free(pool);
+}
+
+void Curl_thrdpool_add(struct Curl_thrdpool *pool, struct Curl_thrdjob *job)
+{
+  Curl_mutex_acquire(&pool->mutex);
+  job->pool = pool;
+  job->state = THRDJOB_QUEUED;
+  Curl_llist_insert_next(&pool->queue, pool->queue.tail, job, &job->node);
+  Curl_mutex_release(&pool->mutex);
+  thrdpool_signal(pool);
+}
+
+bool Curl_thrdjob_done(struct Curl_thrdjob *job)
+{
+  struct Curl_thrdpool *pool = job->pool;
+  bool done;
+
+  if(!pool)
+    return job->state == THRDJOB_DONE;
+  Curl_mutex_acquire(&pool->mutex);
+  done = (job->state == THRDJOB_DONE);
+  Curl_mutex_release(&pool->mutex);
+  return done;
+}
+
+void Curl_thrdjob_release(struct Curl_thrdjob *job)
+{
+  struct Curl_thrdpool *pool = job->pool;
+  bool running = FALSE;
+
+  if(pool) {
+    Curl_mutex_acquire(&pool->mutex);
+    if(job->state == THRDJOB_QUEUED)
+      Curl_llist_remove(&pool->queue, &job->node, NULL);
+    else if(job->state == THRDJOB_RUNNING) {
+      job->state = THRDJOB_ABANDONED;
+      running = TRUE;
+    }
+    Curl_mutex_release(&pool->mutex);
+  }
+  if(!running)
+    job->dtor(job);
+}
+
+#endif /* USE_THRDPOOL */
@@ -0,0 +1,88 @@
+#ifndef HEADER_CURL_THRDPOOL_H
+#define HEADER_CURL_THRDPOOL_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curl_setup.h"
+
+#if (defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)) && \
+  !defined(CURL_DISABLE_SOCKETPAIR)
+
+#define USE_THRDPOOL
+
+#include "llist.h"
+
+struct Curl_multi;
+struct Curl_thrdpool;
+
+#define THRDJOB_QUEUED    0
+#define THRDJOB_RUNNING   1
+#define THRDJOB_DONE      2
+#define THRDJOB_ABANDONED 3 /* released while running, the worker frees it */
+
+/* A job to run in a thread of the pool. The owner embeds this as the first
+   member of its own struct and sets 'run' and 'dtor'. */
+struct Curl_thrdjob {
+  /* called in a worker thread, may only use what the job owns */
+  void (*run)(struct Curl_thrdjob *job);
+  /* frees the job, in whatever thread lets go of it last */
+  void (*dtor)(struct Curl_thrdjob *job);
+  struct Curl_thrdpool *pool; /* NULL when not in a pool */
+  struct Curl_llist_element node;
+  int state; /* THRDJOB_*, protected by the pool mutex */
+};
+
+/*
+ * Curl_thrdpool_create() starts 'threads' worker threads that run the jobs
+ * added to the pool and wake up 'multi' when one is done. Returns NULL on
+ * failure.
+ */
+struct Curl_thrdpool *Curl_thrdpool_create(struct Curl_multi *multi,
+                                           int threads);
+
+/*
+ * Curl_thrdpool_quiesce() stops and joins the worker threads, after they
+ * finish the jobs they run. The pool stays usable to release jobs, and the
+ * jobs still queued are run by Curl_thrdpool_destroy().
+ */
+void Curl_thrdpool_quiesce(struct Curl_thrdpool *pool);
+
+/*
+ * Curl_thrdpool_destroy() stops and joins the worker threads. Jobs still
+ * queued are run in the calling thread first.
+ */
+void Curl_thrdpool_destroy(struct Curl_thrdpool *pool);
+
+/* Queue the job to be run by the next idle worker thread. */
+void Curl_thrdpool_add(struct Curl_thrdpool *pool, struct Curl_thrdjob *job);
+
+/* Returns TRUE once the job has run. */
+bool Curl_thrdjob_done(struct Curl_thrdjob *job);
+
+/* Lets go of the job. It is freed now or, when a worker thread is running
+   it, by that thread once it is done. */
+void Curl_thrdjob_release(struct Curl_thrdjob *job);
+
+#endif /* USE_THRDPOOL */
+
+#endif /* HEADER_CURL_THRDPOOL_H */
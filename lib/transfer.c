@@ -1232,6 +1232,56 @@ out:
   return result;
 }
 
+/*
+ * Add the sockets the connection filters wait for to the ones in 'sock' and
+ * 'bitmap' the transfer waits for. A filter may have to send or receive on
+ * its own, like for HTTP/2 frames of other streams that are still to be
+ * sent. For a socket a filter reports, the filter also decides if the
+ * transfer waits for it to be writable, as sending may first need something
+ * to be received, like a TLS handshake going on behind early data or a
+ * window update for an HTTP/2 stream. Returns the new bitmap.
+ */
+static int conn_filter_getsock(struct Curl_easy *data,
+                               struct connectdata *conn,
+                               curl_socket_t *sock, int bitmap)
+{
+  curl_socket_t fsock[MAX_SOCKSPEREASYHANDLE];
+  int fbitmap;
+  int nsocks = 0;
+  int i;
+
+  if(!Curl_conn_is_connected(conn, FIRSTSOCKET))
+    return bitmap;
+
+  fbitmap = Curl_conn_get_select_socks(data, FIRSTSOCKET, fsock);
+  if(fbitmap == GETSOCK_BLANK)
+    return bitmap;
+
+  while((nsocks < MAX_SOCKSPEREASYHANDLE) &&
+        (bitmap & (GETSOCK_READSOCK(nsocks) | GETSOCK_WRITESOCK(nsocks))))
+    nsocks++;
+
+  for(i = 0; i < MAX_SOCKSPEREASYHANDLE; i++) {
+    int n;
+    if(!(fbitmap & (GETSOCK_READSOCK(i) | GETSOCK_WRITESOCK(i))))
+      break;
+    for(n = 0; (n < nsocks) && (sock[n] != fsock[i]); n++)
+      ;
+    if(n == nsocks) {
+      if(nsocks == MAX_SOCKSPEREASYHANDLE)
+        break;
+      sock[nsocks++] = fsock[i];
+    }
+    else
+      bitmap &= ~GETSOCK_WRITESOCK(n);
+    if(fbitmap & GETSOCK_READSOCK(i))
+      bitmap |= GETSOCK_READSOCK(n);
+    if(fbitmap & GETSOCK_WRITESOCK(i))
+      bitmap |= GETSOCK_WRITESOCK(n);
+  }
+  return bitmap;
+}
+
 /*
  * Curl_single_getsock() gets called by the multi interface code when the app
  * has requested to get the sockets for the current connection. This function
@@ -1275,7 +1325,7 @@ int Curl_single_getsock(struct Curl_easy *data,
     bitmap |= GETSOCK_WRITESOCK(sockindex);
   }
 
-  return bitmap;
+  return conn_filter_getsock(data, conn, sock, bitmap);
 }
 
 /* Curl_init_CONNECT() gets called each time the handle switches to CONNECT
@@ -80,6 +80,7 @@
 #include "content_encoding.h"
 #include "http_digest.h"
 #include "http_negotiate.h"
+#include "http_aws_sigv4.h"
 #include "select.h"
 #include "multiif.h"
 #include "easyif.h"
@@ -414,6 +415,7 @@ CURLcode Curl_close(struct Curl_easy **datap)
   Curl_ssl_close_all(data);
   Curl_safefree(data->state.first_host);
   Curl_safefree(data->state.scratch);
+  Curl_aws_sigv4_free(data);
   Curl_ssl_free_certinfo(data);
 
   /* Cleanup possible redirect junk */
@@ -430,6 +432,8 @@ CURLcode Curl_close(struct Curl_easy **datap)
   Curl_safefree(data->state.buffer);
   Curl_dyn_free(&data->state.headerb);
   Curl_safefree(data->state.ulbuf);
+  Curl_safefree(data->state.decbuf);
+  Curl_zstd_dicts_free(data);
   Curl_flush_cookies(data, TRUE);
 #ifndef CURL_DISABLE_COOKIES
   curl_slist_free_all(data->set.cookielist); /* clean up list */
@@ -2067,6 +2071,7 @@ void Curl_free_request_state(struct Curl_easy *data)
 {
   Curl_safefree(data->req.p.http);
   Curl_safefree(data->req.newurl);
+  Curl_arena_release(&data->req.arena);
 
 #ifndef CURL_DISABLE_DOH
   if(data->req.doh) {
@@ -2607,11 +2612,7 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
   char *ubuf = NULL;
   char *pbuf = NULL;
   char *obuf = NULL;
-  const char *psep = NULL;
-  const char *osep = NULL;
-  size_t ulen;
-  size_t plen;
-  size_t olen;
+  struct login_parts parts;
 
   /* the input length check is because this is called directly from setopt
      and isn't going through the regular string length check */
@@ -2619,45 +2620,19 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
   if(llen > CURL_MAX_INPUT_LENGTH)
     return CURLE_BAD_FUNCTION_ARGUMENT;
 
-  /* Attempt to find the password separator */
-  if(passwdp) {
-    psep = strchr(login, ':');
-
-    /* Within the constraint of the login string */
-    if(psep >= login + len)
-      psep = NULL;
-  }
-
-  /* Attempt to find the options separator */
-  if(optionsp) {
-    osep = strchr(login, ';');
-
-    /* Within the constraint of the login string */
-    if(osep >= login + len)
-      osep = NULL;
-  }
-
-  /* Calculate the portion lengths */
-  ulen = (psep ?
-          (size_t)(osep && psep > osep ? osep - login : psep - login) :
-          (osep ? (size_t)(osep - login) : len));
-  plen = (psep ?
-          (osep && osep > psep ? (size_t)(osep - psep) :
-                                 (size_t)(login + len - psep)) - 1 : 0);
-  olen = (osep ?
-          (psep && psep > osep ? (size_t)(psep - osep) :
-                                 (size_t)(login + len - osep)) - 1 : 0);
+  Curl_split_login_details(login, len, passwdp != NULL, optionsp != NULL,
+                           &parts);
 
   /* Allocate the user portion buffer, which can be zero length */
   if(userp) {
-    ubuf = malloc(ulen + 1);
+    ubuf = malloc(parts.ulen + 1);
     if(!ubuf)
       result = CURLE_OUT_OF_MEMORY;
   }
 
   /* Allocate the password portion buffer */
-  if(!result && passwdp && psep) {
-    pbuf = malloc(plen + 1);
+  if(!result && parts.passwd) {
+    pbuf = malloc(parts.plen + 1);
     if(!pbuf) {
       free(ubuf);
       result = CURLE_OUT_OF_MEMORY;
@@ -2665,8 +2640,8 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
   }
 
   /* Allocate the options portion buffer */
-  if(!result && optionsp && olen) {
-    obuf = malloc(olen + 1);
+  if(!result && parts.olen) {
+    obuf = malloc(parts.olen + 1);
     if(!obuf) {
       free(pbuf);
       free(ubuf);
@@ -2677,24 +2652,24 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
   if(!result) {
     /* Store the user portion if necessary */
     if(ubuf) {
-      memcpy(ubuf, login, ulen);
-      ubuf[ulen] = '\0';
+      memcpy(ubuf, login, parts.ulen);
+      ubuf[parts.ulen] = '\0';
       Curl_safefree(*userp);
       *userp = ubuf;
     }
 
     /* Store the password portion if necessary */
     if(pbuf) {
-      memcpy(pbuf, psep + 1, plen);
-      pbuf[plen] = '\0';
+      memcpy(pbuf, parts.passwd, parts.plen);
+      pbuf[parts.plen] = '\0';
       Curl_safefree(*passwdp);
       *passwdp = pbuf;
     }
 
     /* Store the options portion if necessary */
     if(obuf) {
-      memcpy(obuf, osep + 1, olen);
-      obuf[olen] = '\0';
+      memcpy(obuf, parts.options, parts.olen);
+      obuf[parts.olen] = '\0';
       Curl_safefree(*optionsp);
       *optionsp = obuf;
     }
@@ -2703,6 +2678,44 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
   return result;
 }
 
+/*
+ * Curl_split_login_details()
+ *
+ * Find where the user name, password and options portions are in a login
+ * string of the formats Curl_parse_login_details() takes, without copying
+ * them. The user name always starts at 'login'. The password and options
+ * pointers are NULL when there is no such separator, or when the caller did
+ * not ask for that portion.
+ */
+void Curl_split_login_details(const char *login, size_t len,
+                              bool passwd, bool options,
+                              struct login_parts *parts)
+{
+  const char *psep = NULL;
+  const char *osep = NULL;
+
+  /* Attempt to find the password separator */
+  if(passwd)
+    psep = memchr(login, ':', len);
+
+  /* Attempt to find the options separator */
+  if(options)
+    osep = memchr(login, ';', len);
+
+  /* Calculate the portion lengths */
+  parts->ulen = (psep ?
+                 (size_t)(osep && psep > osep ? osep - login : psep - login) :
+                 (osep ? (size_t)(osep - login) : len));
+  parts->plen = (psep ?
+                 (osep && osep > psep ? (size_t)(osep - psep) :
+                  (size_t)(login + len - psep)) - 1 : 0);
+  parts->olen = (osep ?
+                 (psep && psep > osep ? (size_t)(psep - osep) :
+                  (size_t)(login + len - osep)) - 1 : 0);
+  parts->passwd = psep ? psep + 1 : NULL;
+  parts->options = osep ? osep + 1 : NULL;
+}
+
 /*************************************************************
  * Figure out the remote port number and fix it in the URL
  *
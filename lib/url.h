@@ -46,6 +46,19 @@ CURLcode Curl_parse_login_details(const char *login, const size_t len,
                                   char **userptr, char **passwdptr,
                                   char **optionsptr);
 
+/* where the portions of a login string are, see Curl_split_login_details */
+struct login_parts {
+  size_t ulen;         /* the user name starts at the login */
+  const char *passwd;  /* NULL if none */
+  size_t plen;
+  const char *options; /* NULL if none */
+  size_t olen;
+};
+
+void Curl_split_login_details(const char *login, size_t len,
+                              bool passwd, bool options,
+                              struct login_parts *parts);
+
 const struct Curl_handler *Curl_builtin_scheme(const char *scheme,
                                                size_t schemelen);
 
@@ -57,7 +57,10 @@
 /* scheme is not URL encoded, the longest libcurl supported ones are... */
 #define MAX_SCHEME_LEN 40
 
-/* Internal representation of CURLU. Point to URL-encoded strings. */
+/* Internal representation of CURLU. Point to URL-encoded strings.
+
+   The parts parseurl() finds are all stored in the single 'buf' allocation.
+   Parts set or replaced later are allocated one by one. */
 struct Curl_URL {
   char *scheme;
   char *user;
@@ -69,23 +72,117 @@ struct Curl_URL {
   char *path;
   char *query;
   char *fragment;
+  char *buf;     /* the parts stored together */
+  unsigned int inbuf; /* PART_* bits of the parts that point into 'buf' */
   long portnum; /* the numerical version */
 };
 
 #define DEFAULT_SCHEME "https"
 
+/* the parts of a URL take up no more than its length, except for the
+   scheme, a port number without leading zeroes, room for normalizing an
+   IPv4 address and the zero terminators */
+#define PARTS_SLACK (MAX_SCHEME_LEN + 48)
+
+/* fills in the 'buf' of a CURLU, which is allocated large enough up front */
+struct partsbuf {
+  char *buf;
+  size_t len;
+  size_t size;
+};
+
+/* store a zero terminated copy of a part, leaving 'room' bytes for it to
+   grow into */
+static char *add_part_room(struct partsbuf *pb, const char *part,
+                           size_t len, size_t room)
+{
+  char *p = &pb->buf[pb->len];
+  DEBUGASSERT(room >= len);
+  DEBUGASSERT(pb->len + room < pb->size);
+  memcpy(p, part, len);
+  p[len] = 0;
+  pb->len += room + 1;
+  return p;
+}
+
+static char *add_part(struct partsbuf *pb, const char *part, size_t len)
+{
+  return add_part_room(pb, part, len, len);
+}
+
+#define PART_SCHEME   (1<<0)
+#define PART_USER     (1<<1)
+#define PART_PASSWORD (1<<2)
+#define PART_OPTIONS  (1<<3)
+#define PART_HOST     (1<<4)
+#define PART_ZONEID   (1<<5)
+#define PART_PORT     (1<<6)
+#define PART_PATH     (1<<7)
+#define PART_QUERY    (1<<8)
+#define PART_FRAGMENT (1<<9)
+
+static unsigned int part_bit(struct Curl_URL *u, char **partp)
+{
+  if(partp == &u->scheme)
+    return PART_SCHEME;
+  if(partp == &u->user)
+    return PART_USER;
+  if(partp == &u->password)
+    return PART_PASSWORD;
+  if(partp == &u->options)
+    return PART_OPTIONS;
+  if(partp == &u->host)
+    return PART_HOST;
+  if(partp == &u->zoneid)
+    return PART_ZONEID;
+  if(partp == &u->port)
+    return PART_PORT;
+  if(partp == &u->path)
+    return PART_PATH;
+  if(partp == &u->query)
+    return PART_QUERY;
+  DEBUGASSERT(partp == &u->fragment);
+  return PART_FRAGMENT;
+}
+
+/* mark the parts set so far as stored in 'buf', all but the zone id which
+   is always allocated on its own */
+static void parts_in_buf(struct Curl_URL *u)
+{
+  u->inbuf = (u->scheme ? PART_SCHEME : 0) |
+    (u->user ? PART_USER : 0) |
+    (u->password ? PART_PASSWORD : 0) |
+    (u->options ? PART_OPTIONS : 0) |
+    (u->host ? PART_HOST : 0) |
+    (u->port ? PART_PORT : 0) |
+    (u->path ? PART_PATH : 0) |
+    (u->query ? PART_QUERY : 0) |
+    (u->fragment ? PART_FRAGMENT : 0);
+}
+
+/* free a part unless it is stored in the shared buffer */
+static void free_part(struct Curl_URL *u, char **partp)
+{
+  unsigned int flag = part_bit(u, partp);
+  if(!(u->inbuf & flag))
+    free(*partp);
+  u->inbuf &= ~flag;
+  *partp = NULL;
+}
+
 static void free_urlhandle(struct Curl_URL *u)
 {
-  free(u->scheme);
-  free(u->user);
-  free(u->password);
-  free(u->options);
-  free(u->host);
-  free(u->zoneid);
-  free(u->port);
-  free(u->path);
-  free(u->query);
-  free(u->fragment);
+  free_part(u, &u->scheme);
+  free_part(u, &u->user);
+  free_part(u, &u->password);
+  free_part(u, &u->options);
+  free_part(u, &u->host);
+  free_part(u, &u->zoneid);
+  free_part(u, &u->port);
+  free_part(u, &u->path);
+  free_part(u, &u->query);
+  free_part(u, &u->fragment);
+  Curl_safefree(u->buf);
 }
 
 /*
@@ -143,12 +240,26 @@ static CURLUcode urlencode_str(struct dynbuf *o, const char *url,
   if(!relative)
     host_sep = (const unsigned char *) find_host_sep(url);
 
-  for(iptr = (unsigned char *)url;    /* read from here */
-      len; iptr++, len--) {
+  iptr = (const unsigned char *)url;
+  if(host_sep > iptr) {
+    /* the host part is added as it is */
+    size_t n = (size_t)(host_sep - iptr);
+    if(n > len)
+      n = len;
+    if(Curl_dyn_addn(o, iptr, n))
+      return CURLUE_OUT_OF_MEMORY;
+    iptr += n;
+    len -= n;
+  }
 
-    if(iptr < host_sep) {
-      if(Curl_dyn_addn(o, iptr, 1))
+  while(len) {
+    /* copy runs of ASCII that stays as it is in one go */
+    size_t n = Curl_plain_span((const char *)iptr, len, 0, 0x7f, ' ', '?');
+    if(n) {
+      if(Curl_dyn_addn(o, iptr, n))
         return CURLUE_OUT_OF_MEMORY;
+      iptr += n;
+      len -= n;
       continue;
     }
 
@@ -161,20 +272,22 @@ static CURLUcode urlencode_str(struct dynbuf *o, const char *url,
         if(Curl_dyn_addn(o, "+", 1))
           return CURLUE_OUT_OF_MEMORY;
       }
-      continue;
-    }
-
-    if(*iptr == '?')
-      left = FALSE;
-
-    if(urlchar_needs_escaping(*iptr)) {
-      if(Curl_dyn_addf(o, "%%%02x", *iptr))
-        return CURLUE_OUT_OF_MEMORY;
     }
     else {
-      if(Curl_dyn_addn(o, iptr, 1))
-        return CURLUE_OUT_OF_MEMORY;
+      if(*iptr == '?')
+        left = FALSE;
+
+      if(urlchar_needs_escaping(*iptr)) {
+        if(Curl_dyn_addf(o, "%%%02x", *iptr))
+          return CURLUE_OUT_OF_MEMORY;
+      }
+      else {
+        if(Curl_dyn_addn(o, iptr, 1))
+          return CURLUE_OUT_OF_MEMORY;
+      }
     }
+    iptr++;
+    len--;
   }
 
   return CURLUE_OK;
@@ -370,21 +483,13 @@ static char *concat_url(char *base, const char *relurl)
 static bool junkscan(const char *part, unsigned int flags)
 {
   if(part) {
-    static const char badbytes[]={
-      /* */ 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
-      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
-      0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
-      0x7f, 0x00 /* null-terminate */
-    };
     size_t n = strlen(part);
-    size_t nfine = strcspn(part, badbytes);
-    if(nfine != n)
+    /* a single scan for the bad bytes, and space when not allowed */
+    if(Curl_plain_span(part, n, 0x20, 0xff, 0x7f,
+                       (flags & CURLU_ALLOW_SPACE) ? 0x7f : ' ') != n)
       /* since we don't know which part is scanned, return a generic error
          code */
       return TRUE;
-    if(!(flags & CURLU_ALLOW_SPACE) && strchr(part, ' '))
-      return TRUE;
   }
   return FALSE;
 }
@@ -393,36 +498,31 @@ static bool junkscan(const char *part, unsigned int flags)
  * parse_hostname_login()
  *
  * Parse the login details (user name, password and options) from the URL and
- * strip them out of the host name
+ * strip them out of the host name. The login details are cut into zero
+ * terminated parts where they are, and '*hostp' is moved past them.
  *
  */
 static CURLUcode parse_hostname_login(struct Curl_URL *u,
-                                      struct dynbuf *host,
+                                      char **hostp, size_t *hostlen,
                                       unsigned int flags)
 {
-  CURLUcode result = CURLUE_OK;
-  CURLcode ccode;
-  char *userp = NULL;
-  char *passwdp = NULL;
-  char *optionsp = NULL;
+  struct login_parts parts;
   const struct Curl_handler *h = NULL;
 
   /* At this point, we assume all the other special cases have been taken
    * care of, so the host is at most
    *
    *   [user[:password][;options]]@]hostname
-   *
-   * We need somewhere to put the embedded details, so do that first.
    */
 
-  char *login = Curl_dyn_ptr(host);
+  char *login = *hostp;
   char *ptr;
 
   DEBUGASSERT(login);
 
   ptr = strchr(login, '@');
   if(!ptr)
-    goto out;
+    return CURLUE_OK;
 
   /* We will now try to extract the
    * possible login information in a string like:
@@ -435,68 +535,55 @@ static CURLUcode parse_hostname_login(struct Curl_URL *u,
 
   /* We could use the login information in the URL so extract it. Only parse
      options if the handler says we should. Note that 'h' might be NULL! */
-  ccode = Curl_parse_login_details(login, ptr - login - 1,
-                                   &userp, &passwdp,
-                                   (h && (h->flags & PROTOPT_URLOPTIONS)) ?
-                                   &optionsp:NULL);
-  if(ccode) {
-    result = CURLUE_BAD_LOGIN;
-    goto out;
-  }
-
-  if(userp) {
-    if(flags & CURLU_DISALLOW_USER) {
-      /* Option DISALLOW_USER is set and url contains username. */
-      result = CURLUE_USER_NOT_ALLOWED;
-      goto out;
-    }
-    if(junkscan(userp, flags)) {
-      result = CURLUE_BAD_USER;
-      goto out;
-    }
-    u->user = userp;
-  }
-
-  if(passwdp) {
-    if(junkscan(passwdp, flags)) {
-      result = CURLUE_BAD_PASSWORD;
-      goto out;
-    }
-    u->password = passwdp;
+  Curl_split_login_details(login, ptr - login - 1, TRUE,
+                           h && (h->flags & PROTOPT_URLOPTIONS), &parts);
+
+  if(flags & CURLU_DISALLOW_USER)
+    /* Option DISALLOW_USER is set and url contains username. */
+    return CURLUE_USER_NOT_ALLOWED;
+
+  /* each portion ends on a separator or on the '@', cut them there */
+  login[parts.ulen] = 0;
+  if(junkscan(login, flags))
+    return CURLUE_BAD_USER;
+  u->user = login;
+
+  if(parts.passwd) {
+    char *passwd = (char *)parts.passwd;
+    passwd[parts.plen] = 0;
+    if(junkscan(passwd, flags))
+      return CURLUE_BAD_PASSWORD;
+    u->password = passwd;
   }
 
-  if(optionsp) {
-    if(junkscan(optionsp, flags)) {
-      result = CURLUE_BAD_LOGIN;
-      goto out;
-    }
-    u->options = optionsp;
+  if(parts.olen) {
+    char *options = (char *)parts.options;
+    options[parts.olen] = 0;
+    if(junkscan(options, flags))
+      return CURLUE_BAD_LOGIN;
+    u->options = options;
   }
 
-  /* move the name to the start of the host buffer */
-  if(Curl_dyn_tail(host, strlen(ptr)))
-    return CURLUE_OUT_OF_MEMORY;
+  /* the host name starts after the login */
+  *hostlen -= ptr - login;
+  *hostp = ptr;
 
   return CURLUE_OK;
-  out:
-
-  free(userp);
-  free(passwdp);
-  free(optionsp);
-  u->user = NULL;
-  u->password = NULL;
-  u->options = NULL;
-
-  return result;
 }
 
-UNITTEST CURLUcode Curl_parse_port(struct Curl_URL *u, struct dynbuf *host,
-                                   bool has_scheme)
+/*
+ * Cut off and check the port number at the end of the 'hlen' bytes long host
+ * name. The port number without leading zeroes is stored in 'portbuf', which
+ * is left empty if there is none.
+ */
+static CURLUcode parse_port(struct Curl_URL *u, char *hostname, size_t *hlen,
+                            bool has_scheme, char *portbuf, size_t buflen)
 {
   char *portptr = NULL;
   char endbracket;
   int len;
-  char *hostname = Curl_dyn_ptr(host);
+
+  portbuf[0] = 0;
   /*
    * Find the end of an IPv6 address, either on the ']' ending bracket or
    * a percent-encoded zone index.
@@ -532,7 +619,6 @@ UNITTEST CURLUcode Curl_parse_port(struct Curl_URL *u, struct dynbuf *host,
   if(portptr) {
     char *rest;
     long port;
-    char portbuf[7];
     size_t keep = portptr - hostname;
 
     /* Browser behavior adaptation. If there's a colon with no digits after,
@@ -542,7 +628,8 @@ UNITTEST CURLUcode Curl_parse_port(struct Curl_URL *u, struct dynbuf *host,
        Don't do it if the URL has no scheme, to make something that looks like
        a scheme not work!
     */
-    Curl_dyn_setlen(host, keep);
+    hostname[keep] = 0;
+    *hlen = keep;
     portptr++;
     if(!*portptr)
       return has_scheme ? CURLUE_OK : CURLUE_BAD_PORT_NUMBER;
@@ -560,15 +647,30 @@ UNITTEST CURLUcode Curl_parse_port(struct Curl_URL *u, struct dynbuf *host,
 
     *rest = 0;
     /* generate a new port number string to get rid of leading zeroes etc */
-    msnprintf(portbuf, sizeof(portbuf), "%ld", port);
+    msnprintf(portbuf, buflen, "%ld", port);
     u->portnum = port;
+  }
+
+  return CURLUE_OK;
+}
+
+#ifdef DEBUGBUILD
+UNITTEST CURLUcode Curl_parse_port(struct Curl_URL *u, struct dynbuf *host,
+                                   bool has_scheme)
+{
+  char portbuf[7];
+  size_t hlen = Curl_dyn_len(host);
+  CURLUcode result = parse_port(u, Curl_dyn_ptr(host), &hlen, has_scheme,
+                                portbuf, sizeof(portbuf));
+  Curl_dyn_setlen(host, hlen);
+  if(!result && portbuf[0]) {
     u->port = strdup(portbuf);
     if(!u->port)
       return CURLUE_OUT_OF_MEMORY;
   }
-
-  return CURLUE_OK;
+  return result;
 }
+#endif
 
 static CURLUcode hostname_check(struct Curl_URL *u, char *hostname,
                                 size_t hlen) /* length of hostname */
@@ -735,11 +837,11 @@ static bool ipv4_normalize(const char *hostname, char *outp, size_t olen)
   return TRUE;
 }
 
-/* if necessary, replace the host content with a URL decoded version */
-static CURLUcode decode_host(struct dynbuf *host)
+/* if necessary, replace the host content with a URL decoded version, which
+   is never longer */
+static CURLUcode decode_host(char *hostname, size_t *hlen)
 {
   char *per = NULL;
-  const char *hostname = Curl_dyn_ptr(host);
   if(hostname[0] == '[')
     /* only decode if not an ipv6 numerical */
     return CURLUE_OK;
@@ -755,11 +857,10 @@ static CURLUcode decode_host(struct dynbuf *host)
                                      REJECT_CTRL);
     if(result)
       return CURLUE_BAD_HOSTNAME;
-    Curl_dyn_reset(host);
-    result = Curl_dyn_addn(host, decoded, dlen);
+    DEBUGASSERT(dlen <= *hlen);
+    memcpy(hostname, decoded, dlen + 1);
+    *hlen = dlen;
     free(decoded);
-    if(result)
-      return CURLUE_OUT_OF_MEMORY;
   }
 
   return CURLUE_OK;
@@ -922,16 +1023,16 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
   size_t urllen;
   CURLUcode result = CURLUE_OK;
   size_t fraglen = 0;
-  struct dynbuf host;
+  const char *hostp = NULL; /* the host name and port, not zero terminated */
+  size_t hostlen = 0;
+  char *host = NULL;
+  struct partsbuf pb;
 
   DEBUGASSERT(url);
 
-  Curl_dyn_init(&host, CURL_MAX_INPUT_LENGTH);
-
   /*************************************************************
    * Parse the URL.
    ************************************************************/
-  /* allocate scratch area */
   urllen = strlen(url);
   if(urllen > CURL_MAX_INPUT_LENGTH) {
     /* excessive input length */
@@ -939,6 +1040,15 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
     goto fail;
   }
 
+  /* allocate the storage for all parts, URL encoding makes them grow */
+  pb.size = urllen * ((flags & CURLU_URLENCODE) ? 3 : 1) + PARTS_SLACK;
+  pb.len = 0;
+  pb.buf = u->buf = malloc(pb.size);
+  if(!pb.buf) {
+    result = CURLUE_OUT_OF_MEMORY;
+    goto fail;
+  }
+
   schemelen = Curl_is_absolute_url(url, schemebuf, sizeof(schemebuf),
                                    flags & (CURLU_GUESS_SCHEME|
                                             CURLU_DEFAULT_SCHEME));
@@ -954,11 +1064,7 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
     /* path has been allocated large enough to hold this */
     path = (char *)&url[5];
 
-    schemep = u->scheme = strdup("file");
-    if(!u->scheme) {
-      result = CURLUE_OUT_OF_MEMORY;
-      goto fail;
-    }
+    schemep = u->scheme = add_part(&pb, "file", 4);
 
     /* Extra handling URLs with an authority component (i.e. that start with
      * "file://")
@@ -1011,10 +1117,8 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
 
           len = path - ptr;
           if(len) {
-            if(Curl_dyn_addn(&host, ptr, len)) {
-              result = CURLUE_OUT_OF_MEMORY;
-              goto fail;
-            }
+            hostp = ptr;
+            hostlen = len;
             uncpath = TRUE;
           }
 
@@ -1033,7 +1137,7 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
 
     if(!uncpath)
       /* no host for file: URLs by default */
-      Curl_dyn_reset(&host);
+      hostlen = 0;
 
 #if !defined(MSDOS) && !defined(WIN32) && !defined(__CYGWIN__)
     /* Don't allow Windows drive letters when not in Windows.
@@ -1056,8 +1160,6 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
   else {
     /* clear path */
     const char *p;
-    const char *hostp;
-    size_t len;
 
     if(schemelen) {
       int i = 0;
@@ -1105,41 +1207,24 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
     while(*p && !HOSTNAME_END(*p))
       p++;
 
-    len = p - hostp;
-    if(len) {
-      if(Curl_dyn_addn(&host, hostp, len)) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
-    }
-    else {
-      if(!(flags & CURLU_NO_AUTHORITY)) {
-        result = CURLUE_NO_HOST;
-        goto fail;
-      }
+    hostlen = p - hostp;
+    if(!hostlen && !(flags & CURLU_NO_AUTHORITY)) {
+      result = CURLUE_NO_HOST;
+      goto fail;
     }
 
     path = (char *)p;
 
-    if(schemep) {
-      u->scheme = strdup(schemep);
-      if(!u->scheme) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
-    }
+    if(schemep)
+      u->scheme = add_part(&pb, schemep, strlen(schemep));
   }
 
   fragment = strchr(path, '#');
   if(fragment) {
     fraglen = strlen(fragment);
     if(fraglen > 1) {
-      /* skip the leading '#' in the copy but include the terminating null */
-      u->fragment = Curl_memdup(fragment + 1, fraglen);
-      if(!u->fragment) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
+      /* skip the leading '#' in the copy */
+      u->fragment = add_part(&pb, fragment + 1, fraglen - 1);
 
       if(junkscan(u->fragment, flags)) {
         result = CURLUE_BAD_FRAGMENT;
@@ -1161,16 +1246,11 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
           result = CURLUE_OUT_OF_MEMORY;
           goto fail;
         }
-        u->query = Curl_dyn_ptr(&enc);
-      }
-      else {
-        u->query = Curl_memdup(query + 1, qlen);
-        if(!u->query) {
-          result = CURLUE_OUT_OF_MEMORY;
-          goto fail;
-        }
-        u->query[qlen - 1] = 0;
+        u->query = add_part(&pb, Curl_dyn_ptr(&enc), Curl_dyn_len(&enc));
+        Curl_dyn_free(&enc);
       }
+      else
+        u->query = add_part(&pb, query + 1, qlen - 1);
 
       if(junkscan(u->query, flags)) {
         result = CURLUE_BAD_QUERY;
@@ -1179,11 +1259,7 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
     }
     else {
       /* single byte query */
-      u->query = strdup("");
-      if(!u->query) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
+      u->query = add_part(&pb, "", 0);
     }
   }
   else
@@ -1197,79 +1273,72 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
       goto fail;
     }
     pathlen = Curl_dyn_len(&enc);
-    path = u->path = Curl_dyn_ptr(&enc);
+    u->path = add_part(&pb, Curl_dyn_ptr(&enc), pathlen);
+    Curl_dyn_free(&enc);
   }
+  else if(pathlen)
+    u->path = add_part(&pb, path, pathlen);
 
-  if(!pathlen) {
-    /* there is no path left, unset */
-    path = NULL;
-  }
-  else {
-    if(!u->path) {
-      u->path = Curl_memdup(path, pathlen + 1);
-      if(!u->path) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
-      u->path[pathlen] = 0;
-      path = u->path;
-    }
-    else if(flags & CURLU_URLENCODE)
-      /* it might have encoded more than just the path so cut it */
-      u->path[pathlen] = 0;
-
+  if(pathlen) {
     if(junkscan(u->path, flags)) {
       result = CURLUE_BAD_PATH;
       goto fail;
     }
 
-    if(!(flags & CURLU_PATH_AS_IS)) {
-      /* remove ../ and ./ sequences according to RFC3986 */
-      char *newp = dedotdotify((char *)path, pathlen);
+    /* remove ../ and ./ sequences according to RFC3986, a path without any
+       dot segment is left as it is */
+    if(!(flags & CURLU_PATH_AS_IS) &&
+       ((u->path[0] == '.') || strstr(u->path, "/."))) {
+      char *newp = dedotdotify(u->path, pathlen);
       if(!newp) {
         result = CURLUE_OUT_OF_MEMORY;
         goto fail;
       }
-      free(u->path);
-      u->path = newp;
+      /* the result is never longer */
+      strcpy(u->path, newp);
+      free(newp);
     }
   }
 
-  if(Curl_dyn_len(&host)) {
+  if(hostlen) {
     char normalized_ipv4[sizeof("255.255.255.255") + 1];
+    char portbuf[7];
+
+    /* leave room for the normalized IPv4 address, which can be longer */
+    host = add_part_room(&pb, hostp, hostlen,
+                         hostlen + sizeof(normalized_ipv4));
 
     /*
      * Parse the login details and strip them out of the host name.
      */
-    result = parse_hostname_login(u, &host, flags);
+    result = parse_hostname_login(u, &host, &hostlen, flags);
     if(!result)
-      result = Curl_parse_port(u, &host, schemelen);
+      result = parse_port(u, host, &hostlen, schemelen,
+                          portbuf, sizeof(portbuf));
     if(result)
       goto fail;
+    if(portbuf[0])
+      u->port = add_part(&pb, portbuf, strlen(portbuf));
 
-    if(junkscan(Curl_dyn_ptr(&host), flags)) {
+    if(junkscan(host, flags)) {
       result = CURLUE_BAD_HOSTNAME;
       goto fail;
     }
 
-    if(ipv4_normalize(Curl_dyn_ptr(&host),
-                      normalized_ipv4, sizeof(normalized_ipv4))) {
-      Curl_dyn_reset(&host);
-      if(Curl_dyn_add(&host, normalized_ipv4)) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
+    if(ipv4_normalize(host, normalized_ipv4, sizeof(normalized_ipv4))) {
+      strcpy(host, normalized_ipv4);
+      hostlen = strlen(host);
     }
     else {
-      result = decode_host(&host);
+      result = decode_host(host, &hostlen);
       if(!result)
-        result = hostname_check(u, Curl_dyn_ptr(&host), Curl_dyn_len(&host));
+        result = hostname_check(u, host, hostlen);
       if(result)
         goto fail;
     }
 
     if((flags & CURLU_GUESS_SCHEME) && !schemep) {
-      const char *hostname = Curl_dyn_ptr(&host);
+      const char *hostname = host;
       /* legacy curl-style guess based on host name */
       if(checkprefix("ftp.", hostname))
         schemep = "ftp";
@@ -1286,26 +1355,19 @@ static CURLUcode parseurl(const char *url, CURLU *u, unsigned int flags)
       else
         schemep = "http";
 
-      u->scheme = strdup(schemep);
-      if(!u->scheme) {
-        result = CURLUE_OUT_OF_MEMORY;
-        goto fail;
-      }
+      u->scheme = add_part(&pb, schemep, strlen(schemep));
     }
   }
-  else if(flags & CURLU_NO_AUTHORITY) {
+  else if(flags & CURLU_NO_AUTHORITY)
     /* allowed to be empty. */
-    if(Curl_dyn_add(&host, "")) {
-      result = CURLUE_OUT_OF_MEMORY;
-      goto fail;
-    }
-  }
+    host = add_part(&pb, "", 0);
 
-  u->host = Curl_dyn_ptr(&host);
+  u->host = host;
+  parts_in_buf(u);
 
   return result;
   fail:
-  Curl_dyn_free(&host);
+  parts_in_buf(u);
   free_urlhandle(u);
   return result;
 }
@@ -1342,19 +1404,27 @@ void curl_url_cleanup(CURLU *u)
   }
 }
 
-#define DUP(dest, src, name)                    \
-  do {                                          \
-    if(src->name) {                             \
-      dest->name = strdup(src->name);           \
-      if(!dest->name)                           \
-        goto fail;                              \
-    }                                           \
+#define DUPLEN(src, name) (src->name ? strlen(src->name) + 1 : 0)
+
+#define DUP(dest, src, name)                                    \
+  do {                                                          \
+    if(src->name)                                               \
+      dest->name = add_part(&pb, src->name, strlen(src->name)); \
   } while(0)
 
 CURLU *curl_url_dup(CURLU *in)
 {
   struct Curl_URL *u = calloc(sizeof(struct Curl_URL), 1);
   if(u) {
+    /* copy all parts into a single buffer */
+    struct partsbuf pb;
+    pb.size = DUPLEN(in, scheme) + DUPLEN(in, user) + DUPLEN(in, password) +
+      DUPLEN(in, options) + DUPLEN(in, host) + DUPLEN(in, port) +
+      DUPLEN(in, path) + DUPLEN(in, query) + DUPLEN(in, fragment) + 1;
+    pb.len = 0;
+    pb.buf = u->buf = malloc(pb.size);
+    if(!pb.buf)
+      goto fail;
     DUP(u, in, scheme);
     DUP(u, in, user);
     DUP(u, in, password);
@@ -1364,6 +1434,7 @@ CURLU *curl_url_dup(CURLU *in)
     DUP(u, in, path);
     DUP(u, in, query);
     DUP(u, in, fragment);
+    parts_in_buf(u);
     u->portnum = in->portnum;
   }
   return u;
@@ -1372,6 +1443,30 @@ CURLU *curl_url_dup(CURLU *in)
   return NULL;
 }
 
+/* concatenate 'num' strings into a single allocation */
+static char *join_parts(const char * const *parts, size_t num)
+{
+  size_t lens[17];
+  size_t total = 0;
+  size_t i;
+  char *out;
+  DEBUGASSERT(num <= sizeof(lens)/sizeof(lens[0]));
+  for(i = 0; i < num; i++) {
+    lens[i] = strlen(parts[i]);
+    total += lens[i];
+  }
+  out = malloc(total + 1);
+  if(out) {
+    char *p = out;
+    for(i = 0; i < num; i++) {
+      memcpy(p, parts[i], lens[i]);
+      p += lens[i];
+    }
+    *p = 0;
+  }
+  return out;
+}
+
 CURLUcode curl_url_get(CURLU *u, CURLUPart what,
                        char **part, unsigned int flags)
 {
@@ -1465,10 +1560,15 @@ CURLUcode curl_url_get(CURLU *u, CURLUPart what,
     char *allochost = NULL;
     punycode = (flags & CURLU_PUNYCODE)?1:0;
     if(u->scheme && strcasecompare("file", u->scheme)) {
-      url = aprintf("file://%s%s%s",
-                    u->path,
-                    u->fragment? "#": "",
-                    u->fragment? u->fragment : "");
+      const char *parts[4];
+      size_t n = 0;
+      parts[n++] = "file://";
+      parts[n++] = u->path ? u->path : "";
+      if(u->fragment) {
+        parts[n++] = "#";
+        parts[n++] = u->fragment;
+      }
+      url = join_parts(parts, n);
     }
     else if(!u->host)
       return CURLUE_NO_HOST;
@@ -1556,28 +1656,48 @@ CURLUcode curl_url_get(CURLU *u, CURLUPart what,
               return CURLUE_OUT_OF_MEMORY;
             host++;
           }
-          free(u->host);
+          free_part(u, &u->host);
           u->host = Curl_dyn_ptr(&enc);
         }
       }
 
-      url = aprintf("%s://%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
-                    scheme,
-                    u->user ? u->user : "",
-                    u->password ? ":": "",
-                    u->password ? u->password : "",
-                    options ? ";" : "",
-                    options ? options : "",
-                    (u->user || u->password || options) ? "@": "",
-                    allochost ? allochost : u->host,
-                    port ? ":": "",
-                    port ? port : "",
-                    (u->path && (u->path[0] != '/')) ? "/": "",
-                    u->path ? u->path : "/",
-                    (u->query && u->query[0]) ? "?": "",
-                    (u->query && u->query[0]) ? u->query : "",
-                    u->fragment? "#": "",
-                    u->fragment? u->fragment : "");
+      {
+        const char *parts[17];
+        size_t n = 0;
+        bool login = u->user || u->password || options;
+        bool query = u->query && u->query[0];
+        parts[n++] = scheme;
+        parts[n++] = "://";
+        if(u->user)
+          parts[n++] = u->user;
+        if(u->password) {
+          parts[n++] = ":";
+          parts[n++] = u->password;
+        }
+        if(options) {
+          parts[n++] = ";";
+          parts[n++] = options;
+        }
+        if(login)
+          parts[n++] = "@";
+        parts[n++] = allochost ? allochost : u->host;
+        if(port) {
+          parts[n++] = ":";
+          parts[n++] = port;
+        }
+        if(u->path && (u->path[0] != '/'))
+          parts[n++] = "/";
+        parts[n++] = u->path ? u->path : "/";
+        if(query) {
+          parts[n++] = "?";
+          parts[n++] = u->query;
+        }
+        if(u->fragment) {
+          parts[n++] = "#";
+          parts[n++] = u->fragment;
+        }
+        url = join_parts(parts, n);
+      }
       free(allochost);
     }
     if(!url)
@@ -1699,7 +1819,7 @@ CURLUcode curl_url_set(CURLU *u, CURLUPart what,
       return CURLUE_UNKNOWN_PART;
     }
     if(storep && *storep) {
-      Curl_safefree(*storep);
+      free_part(u, storep);
     }
     else if(!storep) {
       free_urlhandle(u);
@@ -1735,7 +1855,7 @@ CURLUcode curl_url_set(CURLU *u, CURLUPart what,
       /* hostname with bad content */
       return CURLUE_BAD_HOSTNAME;
     storep = &u->host;
-    Curl_safefree(u->zoneid);
+    free_part(u, &u->zoneid);
     break;
   }
   case CURLUPART_ZONEID:
@@ -1813,19 +1933,27 @@ CURLUcode curl_url_set(CURLU *u, CURLUPart what,
 
     if(urlencode) {
       const unsigned char *i;
+      const unsigned char *end = (const unsigned char *)part + nalloc;
       struct dynbuf enc;
 
       Curl_dyn_init(&enc, nalloc * 3 + 1);
 
-      for(i = (const unsigned char *)part; *i; i++) {
+      for(i = (const unsigned char *)part; i < end; i++) {
         CURLcode result;
-        if((*i == ' ') && plusencode) {
+        /* copy runs of unreserved characters in one go */
+        size_t n = Curl_unreserved_span((const char *)i, (size_t)(end - i));
+        if(n) {
+          result = Curl_dyn_addn(&enc, i, n);
+          if(result)
+            return CURLUE_OUT_OF_MEMORY;
+          i += n - 1;
+        }
+        else if((*i == ' ') && plusencode) {
           result = Curl_dyn_addn(&enc, "+", 1);
           if(result)
             return CURLUE_OUT_OF_MEMORY;
         }
-        else if(Curl_isunreserved(*i) ||
-                ((*i == '/') && urlskipslash) ||
+        else if(((*i == '/') && urlskipslash) ||
                 ((*i == '=') && equalsencode)) {
           if((*i == '=') && equalsencode)
             /* only skip the first equals sign */
@@ -1881,7 +2009,7 @@ CURLUcode curl_url_set(CURLU *u, CURLUPart what,
         if(Curl_dyn_add(&enc, newp))
           goto nomem;
         free((char *)newp);
-        free(*storep);
+        free_part(u, storep);
         *storep = Curl_dyn_ptr(&enc);
         return CURLUE_OK;
         nomem:
@@ -1903,7 +2031,7 @@ CURLUcode curl_url_set(CURLU *u, CURLUPart what,
       }
     }
 
-    free(*storep);
+    free_part(u, storep);
     *storep = (char *)newp;
   }
   /* set after the string, to make it not assigned if the allocation above
@@ -151,6 +151,7 @@ typedef unsigned int curl_prot_t;
 #include "hash.h"
 #include "splay.h"
 #include "dynbuf.h"
+#include "arena.h"
 
 /* return the count of bytes sent, or -1 on error */
 typedef ssize_t (Curl_send)(struct Curl_easy *data,   /* transfer */
@@ -261,6 +262,7 @@ typedef enum {
 typedef enum {
   ssl_connection_none,
   ssl_connection_negotiating,
+  ssl_connection_deferred, /* usable for early data, handshake not done */
   ssl_connection_complete
 } ssl_connection_state;
 
@@ -313,6 +315,8 @@ struct ssl_config_data {
   BIT(native_ca_store); /* use the native ca store of operating system */
   BIT(auto_client_cert);   /* automatically locate and use a client
                               certificate for authentication (Schannel) */
+  BIT(ktls);         /* let the kernel do the TLS record layer */
+  BIT(earlydata);    /* send idempotent requests as TLS 1.3 early data */
 };
 
 struct ssl_general_config {
@@ -630,6 +634,8 @@ enum doh_slots {
  * request, as it will be cleared between multiple ones
  */
 struct SingleRequest {
+  struct Curl_arena arena; /* for transient objects of this request, released
+                              by Curl_free_request_state() */
   curl_off_t size;        /* -1 if unknown at this point */
   curl_off_t maxdownload; /* in bytes, the maximum amount of data to fetch,
                              -1 means unlimited */
@@ -669,6 +675,10 @@ struct SingleRequest {
 
   /* Content unencoding stack. See sec 3.5, RFC2616. */
   struct contenc_writer *writer_stack;
+  struct upload_encoder *upload_encoder; /* request body compressor */
+#ifndef CURL_DISABLE_CRYPTO_AUTH
+  struct aws_chunker *aws_chunker; /* AWS SigV4 streaming body signer */
+#endif
   time_t timeofdoc;
   long bodywrites;
   char *location;   /* This points to an allocated version of the Location:
@@ -1135,6 +1145,18 @@ struct PureInfo {
                                  builds. Asked for with CURLOPT_CERTINFO
                                  / CURLINFO_CERTINFO */
   CURLproxycode pxcode;
+
+  /* TLS handshake and record layer counters, for the connection to the
+     server only and while this transfer used it */
+  timediff_t tls_handshake_us; /* time spent in the TLS handshake calls */
+  timediff_t tls_verify_us;    /* time spent verifying the chain */
+  curl_off_t tls_records_in;
+  curl_off_t tls_records_out;
+  curl_off_t tls_bytes_in;
+  curl_off_t tls_bytes_out;
+  char tls_group[32];          /* name of the key exchange group */
+  BIT(tls_resumed);   /* the handshake resumed a session */
+  BIT(tls_earlydata); /* the server accepted 0-RTT data */
   BIT(timecond);  /* set to TRUE if the time condition didn't match, which
                      thus made the document NOT get fetched */
 };
@@ -1268,6 +1290,8 @@ typedef enum {
   EXPIRE_TOOFAST,
   EXPIRE_QUIC,
   EXPIRE_FTP_ACCEPT,
+  EXPIRE_SSL_FLUSH,
+  EXPIRE_SSL_VERIFY,
   EXPIRE_LAST /* not an actual timer, used as a marker only */
 } expire_id;
 
@@ -1312,6 +1336,10 @@ struct UrlState {
 
   char *buffer; /* download buffer */
   char *ulbuf; /* allocated upload buffer or NULL */
+  char *decbuf; /* spare content decoding buffer or NULL */
+#ifdef HAVE_ZSTD
+  struct Curl_zstd_dicts *zstd_dicts; /* loaded zstd dictionaries */
+#endif
   curl_off_t current_speed;  /* the ProgressShow() function sets this,
                                 bytes / second */
 
@@ -1339,6 +1367,7 @@ struct UrlState {
 #ifndef CURL_DISABLE_CRYPTO_AUTH
   struct digestdata digest;      /* state data for host Digest auth */
   struct digestdata proxydigest; /* state data for proxy Digest auth */
+  struct aws_sigv4_key *aws_sigv4; /* last derived AWS SigV4 signing key */
 #endif
   struct auth authhost;  /* auth details for host */
   struct auth authproxy; /* auth details for proxy */
@@ -1405,6 +1434,8 @@ struct UrlState {
   struct dynbuf trailers_buf; /* a buffer containing the compiled trailing
                                  headers */
   struct Curl_llist httphdrs; /* received headers */
+  struct Curl_hash httphdrs_names; /* received headers indexed by name */
+  struct Curl_arena httphdrs_arena; /* the received headers are stored here */
   struct curl_header headerout; /* for external purposes */
   struct Curl_header_store *prevhead; /* the latest added header */
   trailers_state trailers_state; /* whether we are sending trailers
@@ -1572,6 +1603,7 @@ enum dupstring {
   STRING_DNS_LOCAL_IP4,
   STRING_DNS_LOCAL_IP6,
   STRING_SSL_EC_CURVES,
+  STRING_UPLOAD_ENCODING,
 
   /* -- end of null-terminated strings -- */
 
@@ -1595,6 +1627,7 @@ enum dupblob {
   BLOB_SSL_ISSUERCERT_PROXY,
   BLOB_CAINFO,
   BLOB_CAINFO_PROXY,
+  BLOB_ZSTD_DICT,
   BLOB_LAST
 };
 
@@ -1711,6 +1744,7 @@ struct UserDefined {
   void *private_data; /* application-private data */
 #ifndef CURL_DISABLE_HTTP
   struct curl_slist *http200aliases; /* linked list of aliases for http200 */
+  struct curl_slist *zstd_dicts; /* list of zstd dictionary files */
 #endif
   unsigned char ipver; /* the CURL_IPRESOLVE_* defines in the public header
                           file 0 - whatever, 1 - v2, 2 - v6 */
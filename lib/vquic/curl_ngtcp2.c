@@ -2094,8 +2094,10 @@ static CURLcode cf_ngtcp2_data_event(struct Curl_cfilter *cf,
   return result;
 }
 
-static void cf_ngtcp2_ctx_clear(struct cf_ngtcp2_ctx *ctx)
+static void cf_ngtcp2_ctx_clear(struct cf_ngtcp2_ctx *ctx,
+                                struct Curl_easy *data)
 {
+  (void)data;
   if(ctx) {
     if(ctx->qlogfd != -1) {
       close(ctx->qlogfd);
@@ -2108,10 +2110,9 @@ static void cf_ngtcp2_ctx_clear(struct cf_ngtcp2_ctx *ctx)
       SSL_CTX_free(ctx->sslctx);
 #elif defined(USE_GNUTLS)
     if(ctx->gtls) {
-      if(ctx->gtls->cred)
-        gnutls_certificate_free_credentials(ctx->gtls->cred);
       if(ctx->gtls->session)
         gnutls_deinit(ctx->gtls->session);
+      Curl_gtls_free_cred(data, ctx->gtls);
       free(ctx->gtls);
     }
 #elif defined(USE_WOLFSSL)
@@ -2132,7 +2133,6 @@ static void cf_ngtcp2_close(struct Curl_cfilter *cf, struct Curl_easy *data)
 {
   struct cf_ngtcp2_ctx *ctx = cf->ctx;
 
-  (void)data;
   if(ctx && ctx->qconn) {
     char buffer[NGTCP2_MAX_UDP_PAYLOAD_SIZE];
     ngtcp2_tstamp ts;
@@ -2148,7 +2148,7 @@ static void cf_ngtcp2_close(struct Curl_cfilter *cf, struct Curl_easy *data)
             SOCKERRNO == EINTR);
     }
 
-    cf_ngtcp2_ctx_clear(ctx);
+    cf_ngtcp2_ctx_clear(ctx, data);
   }
 
   cf->connected = FALSE;
@@ -2158,8 +2158,7 @@ static void cf_ngtcp2_destroy(struct Curl_cfilter *cf, struct Curl_easy *data)
 {
   struct cf_ngtcp2_ctx *ctx = cf->ctx;
 
-  (void)data;
-  cf_ngtcp2_ctx_clear(ctx);
+  cf_ngtcp2_ctx_clear(ctx, data);
   free(ctx);
   cf->ctx = NULL;
 }
@@ -89,7 +89,7 @@ static ssize_t gtls_push(void *s, const void *buf, size_t blen)
   CURLcode result;
 
   DEBUGASSERT(data);
-  nwritten = Curl_conn_cf_send(cf->next, data, buf, blen, &result);
+  nwritten = Curl_ssl_cf_next_send(cf, data, buf, blen, &result);
   if(nwritten < 0) {
     gnutls_transport_set_errno(connssl->backend->gtls.session,
                                (CURLE_AGAIN == result)? EAGAIN : EINVAL);
@@ -107,7 +107,7 @@ static ssize_t gtls_pull(void *s, void *buf, size_t blen)
   CURLcode result;
 
   DEBUGASSERT(data);
-  nread = Curl_conn_cf_recv(cf->next, data, buf, blen, &result);
+  nread = Curl_ssl_cf_next_recv(cf, data, buf, blen, &result);
   if(nread < 0) {
     gnutls_transport_set_errno(connssl->backend->gtls.session,
                                (CURLE_AGAIN == result)? EAGAIN : EINVAL);
@@ -394,37 +394,29 @@ set_ssl_version_min_max(struct Curl_easy *data,
   return CURLE_SSL_CONNECT_ERROR;
 }
 
-CURLcode gtls_client_init(struct Curl_easy *data,
-                          struct ssl_primary_config *config,
-                          struct ssl_config_data *ssl_config,
-                          const char *hostname,
-                          struct gtls_instance *gtls,
-                          long *pverifyresult)
+static void gtls_cred_free(void *cred)
 {
-  unsigned int init_flags;
-  int rc;
-  bool sni = TRUE; /* default is SNI enabled */
-#ifdef ENABLE_IPV6
-  struct in6_addr addr;
-#else
-  struct in_addr addr;
-#endif
-  const char *prioritylist;
-  const char *err = NULL;
-  const char *tls13support;
-  CURLcode result;
-
-  if(!gtls_inited)
-    gtls_init();
-
-  *pverifyresult = 0;
+  gnutls_certificate_free_credentials((gnutls_certificate_credentials_t)cred);
+}
 
-  if(config->version == CURL_SSLVERSION_SSLv2) {
-    failf(data, "GnuTLS does not support SSLv2");
-    return CURLE_SSL_CONNECT_ERROR;
+void Curl_gtls_free_cred(struct Curl_easy *data, struct gtls_instance *gtls)
+{
+  if(gtls->shared_cred) {
+    Curl_ssl_ca_store_release(data, gtls->shared_cred);
+    gtls->shared_cred = NULL;
   }
-  else if(config->version == CURL_SSLVERSION_SSLv3)
-    sni = FALSE; /* SSLv3 has no SNI */
+  else if(gtls->cred)
+    gnutls_certificate_free_credentials(gtls->cred);
+  gtls->cred = NULL;
+}
+
+/* allocate the credentials and load the trusted CAs and CRLs */
+static CURLcode gtls_cred_init(struct Curl_easy *data,
+                               struct ssl_primary_config *config,
+                               struct gtls_instance *gtls,
+                               long *pverifyresult)
+{
+  int rc;
 
   /* allocate a cred struct */
   rc = gnutls_certificate_allocate_credentials(&gtls->cred);
@@ -433,28 +425,6 @@ CURLcode gtls_client_init(struct Curl_easy *data,
     return CURLE_SSL_CONNECT_ERROR;
   }
 
-#ifdef USE_GNUTLS_SRP
-  if(config->username && Curl_auth_allowed_to_host(data)) {
-    infof(data, "Using TLS-SRP username: %s", config->username);
-
-    rc = gnutls_srp_allocate_client_credentials(&gtls->srp_client_cred);
-    if(rc != GNUTLS_E_SUCCESS) {
-      failf(data, "gnutls_srp_allocate_client_cred() failed: %s",
-            gnutls_strerror(rc));
-      return CURLE_OUT_OF_MEMORY;
-    }
-
-    rc = gnutls_srp_set_client_credentials(gtls->srp_client_cred,
-                                           config->username,
-                                           config->password);
-    if(rc != GNUTLS_E_SUCCESS) {
-      failf(data, "gnutls_srp_set_client_cred() failed: %s",
-            gnutls_strerror(rc));
-      return CURLE_BAD_FUNCTION_ARGUMENT;
-    }
-  }
-#endif
-
   if(config->CAfile) {
     /* set the trusted CA cert bundle file */
     gnutls_certificate_set_verify_flags(gtls->cred,
@@ -514,6 +484,87 @@ CURLcode gtls_client_init(struct Curl_easy *data,
       infof(data, "found %d CRL in %s", rc, config->CRLfile);
   }
 
+  return CURLE_OK;
+}
+
+CURLcode gtls_client_init(struct Curl_easy *data,
+                          struct ssl_primary_config *config,
+                          struct ssl_config_data *ssl_config,
+                          const char *hostname,
+                          struct gtls_instance *gtls,
+                          long *pverifyresult)
+{
+  unsigned int init_flags;
+  int rc;
+  bool sni = TRUE; /* default is SNI enabled */
+#ifdef ENABLE_IPV6
+  struct in6_addr addr;
+#else
+  struct in_addr addr;
+#endif
+  const char *prioritylist;
+  const char *err = NULL;
+  const char *tls13support;
+  bool share_cred;
+  CURLcode result;
+
+  if(!gtls_inited)
+    gtls_init();
+
+  *pverifyresult = 0;
+
+  if(config->version == CURL_SSLVERSION_SSLv2) {
+    failf(data, "GnuTLS does not support SSLv2");
+    return CURLE_SSL_CONNECT_ERROR;
+  }
+  else if(config->version == CURL_SSLVERSION_SSLv3)
+    sni = FALSE; /* SSLv3 has no SNI */
+
+  /* credentials with nothing but the trusted CAs can be shared */
+  share_cred = config->verifypeer && !config->CApath && !config->CRLfile &&
+    !config->clientcert && Curl_ssl_ca_store_shared(data);
+#ifdef USE_GNUTLS_SRP
+  if(config->username)
+    share_cred = FALSE;
+#endif
+  if(share_cred) {
+    gtls->shared_cred = Curl_ssl_ca_store_get(data, config->CAfile);
+    if(gtls->shared_cred)
+      gtls->cred = gtls->shared_cred->store;
+  }
+
+  if(!gtls->cred) {
+    result = gtls_cred_init(data, config, gtls, pverifyresult);
+    if(result)
+      return result;
+    if(share_cred) {
+      gtls->shared_cred = Curl_ssl_ca_store_add(data, config->CAfile,
+                                                gtls->cred, gtls_cred_free);
+    }
+  }
+
+#ifdef USE_GNUTLS_SRP
+  if(config->username && Curl_auth_allowed_to_host(data)) {
+    infof(data, "Using TLS-SRP username: %s", config->username);
+
+    rc = gnutls_srp_allocate_client_credentials(&gtls->srp_client_cred);
+    if(rc != GNUTLS_E_SUCCESS) {
+      failf(data, "gnutls_srp_allocate_client_cred() failed: %s",
+            gnutls_strerror(rc));
+      return CURLE_OUT_OF_MEMORY;
+    }
+
+    rc = gnutls_srp_set_client_credentials(gtls->srp_client_cred,
+                                           config->username,
+                                           config->password);
+    if(rc != GNUTLS_E_SUCCESS) {
+      failf(data, "gnutls_srp_set_client_cred() failed: %s",
+            gnutls_strerror(rc));
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    }
+  }
+#endif
+
   /* Initialize TLS session as a client */
   init_flags = GNUTLS_CLIENT;
 
@@ -905,7 +956,9 @@ Curl_gtls_verifyserver(struct Curl_easy *data,
        regarding the certificate key size and chain size are set. To override
        them use gnutls_certificate_set_verify_limits(). */
 
+    struct curltime start = Curl_now();
     rc = gnutls_certificate_verify_peers2(session, &verify_status);
+    data->info.tls_verify_us += Curl_timediff_us(Curl_now(), start);
     if(rc < 0) {
       failf(data, "server cert verify failed: %d", rc);
       *certverifyresult = rc;
@@ -1259,14 +1312,28 @@ static CURLcode gtls_verifyserver(struct Curl_cfilter *cf,
   const char *pinned_key = Curl_ssl_cf_is_proxy(cf)?
     data->set.str[STRING_SSL_PINNEDPUBLICKEY_PROXY]:
     data->set.str[STRING_SSL_PINNEDPUBLICKEY];
+  timediff_t verify_us = data->info.tls_verify_us;
   CURLcode result;
 
   result = Curl_gtls_verifyserver(data, session, conn_config, ssl_config,
                                   connssl->hostname, connssl->dispname,
                                   pinned_key);
+  if(Curl_ssl_cf_is_proxy(cf))
+    /* only the handshake with the server is counted */
+    data->info.tls_verify_us = verify_us;
   if(result)
     goto out;
 
+  if(!Curl_ssl_cf_is_proxy(cf)) {
+#if GNUTLS_VERSION_NUMBER >= 0x030600
+    const char *group = gnutls_group_get_name(gnutls_group_get(session));
+    if(group)
+      strncpy(data->info.tls_group, group, sizeof(data->info.tls_group) - 1);
+#endif
+    data->info.tls_resumed = gnutls_session_is_resumed(session) ?
+      TRUE : FALSE;
+  }
+
   if(cf->conn->bits.tls_enable_alpn) {
     gnutls_datum_t proto;
     int rc;
@@ -1475,10 +1542,7 @@ static void gtls_close(struct Curl_cfilter *cf,
     gnutls_deinit(backend->gtls.session);
     backend->gtls.session = NULL;
   }
-  if(backend->gtls.cred) {
-    gnutls_certificate_free_credentials(backend->gtls.cred);
-    backend->gtls.cred = NULL;
-  }
+  Curl_gtls_free_cred(data, &backend->gtls);
 #ifdef USE_GNUTLS_SRP
   if(backend->gtls.srp_client_cred) {
     gnutls_srp_free_client_credentials(backend->gtls.srp_client_cred);
@@ -1554,14 +1618,13 @@ static int gtls_shutdown(struct Curl_cfilter *cf,
     }
     gnutls_deinit(backend->gtls.session);
   }
-  gnutls_certificate_free_credentials(backend->gtls.cred);
+  Curl_gtls_free_cred(data, &backend->gtls);
 
 #ifdef USE_GNUTLS_SRP
   if(ssl_config->primary.username)
     gnutls_srp_free_client_credentials(backend->gtls.srp_client_cred);
 #endif
 
-  backend->gtls.cred = NULL;
   backend->gtls.session = NULL;
 
   return retval;
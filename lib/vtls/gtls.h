@@ -43,10 +43,12 @@ struct Curl_easy;
 struct Curl_cfilter;
 struct ssl_primary_config;
 struct ssl_config_data;
+struct Curl_ssl_ca_store;
 
 struct gtls_instance {
   gnutls_session_t session;
   gnutls_certificate_credentials_t cred;
+  struct Curl_ssl_ca_store *shared_cred; /* set when cred is shared */
 #ifdef USE_GNUTLS_SRP
   gnutls_srp_client_credentials_t srp_client_cred;
 #endif
@@ -60,6 +62,10 @@ gtls_client_init(struct Curl_easy *data,
                  struct gtls_instance *gtls,
                  long *pverifyresult);
 
+/* let go of the credentials, which may be shared with other connections */
+void
+Curl_gtls_free_cred(struct Curl_easy *data, struct gtls_instance *gtls);
+
 CURLcode
 Curl_gtls_verifyserver(struct Curl_easy *data,
                        gnutls_session_t session,
@@ -165,7 +165,7 @@ static int bio_cf_write(void *bio, const unsigned char *buf, size_t blen)
   CURLcode result;
 
   DEBUGASSERT(data);
-  nwritten = Curl_conn_cf_send(cf->next, data, (char *)buf, blen, &result);
+  nwritten = Curl_ssl_cf_next_send(cf, data, buf, blen, &result);
   /* DEBUGF(infof(data, CFMSG(cf, "bio_cf_out_write(len=%d) -> %d, err=%d"),
          blen, (int)nwritten, result)); */
   if(nwritten < 0 && CURLE_AGAIN == result) {
@@ -187,7 +187,7 @@ static int bio_cf_read(void *bio, unsigned char *buf, size_t blen)
   if(!buf)
     return 0;
 
-  nread = Curl_conn_cf_recv(cf->next, data, (char *)buf, blen, &result);
+  nread = Curl_ssl_cf_next_recv(cf, data, (char *)buf, blen, &result);
   /* DEBUGF(infof(data, CFMSG(cf, "bio_cf_in_read(len=%d) -> %d, err=%d"),
          blen, (int)nread, result)); */
   if(nread < 0 && CURLE_AGAIN == result) {
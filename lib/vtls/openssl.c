@@ -52,6 +52,7 @@
 #include "inet_pton.h"
 #include "openssl.h"
 #include "connect.h"
+#include "cf-socket.h"
 #include "slist.h"
 #include "select.h"
 #include "vtls.h"
@@ -61,7 +62,9 @@
 #include "strcase.h"
 #include "hostcheck.h"
 #include "multiif.h"
+#include "progress.h"
 #include "strerror.h"
+#include "thrdpool.h"
 #include "curl_printf.h"
 
 #include <openssl/ssl.h>
@@ -266,13 +269,44 @@
 
 /*
  * Whether the OpenSSL version has the API needed to support sharing an
- * X509_STORE between connections. The API is:
+ * X509_STORE and an SSL_CTX between connections. The API is:
  * * `X509_STORE_up_ref`       -- Introduced: OpenSSL 1.1.0.
+ * * `SSL_CTX_up_ref`          -- Introduced: OpenSSL 1.1.0.
  */
 #if (OPENSSL_VERSION_NUMBER >= 0x10100000L) /* OpenSSL >= 1.1.0 */
 #define HAVE_SSL_X509_STORE_SHARE
 #endif
 
+/*
+ * Kernel TLS, OpenSSL 3.0 hands the record layer to the kernel when the
+ * handshake is done if SSL_OP_ENABLE_KTLS is set and the BIO is a socket.
+ */
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L) && \
+  !defined(LIBRESSL_VERSION_NUMBER) && defined(SSL_OP_ENABLE_KTLS) && \
+  !defined(OPENSSL_NO_KTLS)
+#define USE_OPENSSL_KTLS
+#endif
+
+/*
+ * TLS 1.3 early data, OpenSSL 1.1.1 lets a client write data before the
+ * handshake is done when it resumes a session that allows it.
+ */
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L) && \
+  !defined(LIBRESSL_VERSION_NUMBER) && !defined(OPENSSL_IS_BORINGSSL)
+#define HAVE_OPENSSL_EARLYDATA
+#endif
+
+/*
+ * OpenSSL 3.0 lets the certificate verify callback suspend the handshake,
+ * which is then resumed with another SSL_connect() call. The chain is then
+ * verified in a thread of the multi handle's pool.
+ */
+#if defined(USE_THRDPOOL) && defined(SSL_ERROR_WANT_RETRY_VERIFY) && \
+  !defined(LIBRESSL_VERSION_NUMBER) && !defined(OPENSSL_IS_BORINGSSL)
+#define USE_OPENSSL_VERIFY_THREADS
+#define SSL_VERIFY_POLL_MS 5
+#endif
+
 /* What API version do we use? */
 #if defined(LIBRESSL_VERSION_NUMBER)
 #define USE_PRE_1_1_API (LIBRESSL_VERSION_NUMBER < 0x2070000f)
@@ -286,6 +320,15 @@ struct ssl_backend_data {
   SSL*     handle;
   X509*    server_cert;
   CURLcode io_result;       /* result of last BIO cfilter operation */
+#ifdef HAVE_OPENSSL_EARLYDATA
+  struct dynbuf earlydata;  /* sent as 0-RTT data, replayed if rejected */
+  size_t earlydata_max;     /* how much 0-RTT data the server takes */
+  size_t earlydata_replayed; /* how much of it has been sent again */
+#endif
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  struct ossl_verify_job *verify_job; /* chain being verified in a thread */
+  bool verify_async; /* the chain may be verified in a thread */
+#endif
 #ifndef HAVE_KEYLOG_CALLBACK
   /* Set to true once a valid keylog entry has been created to avoid dupes. */
   bool     keylog_done;
@@ -297,6 +340,7 @@ struct multi_ssl_backend_data {
   char *CAfile;         /* CAfile path used to generate X509 store */
   X509_STORE *store;    /* cached X509 store or NULL if none */
   struct curltime time; /* when the cached store was created */
+  struct ssl_ctx_cache ctx_cache; /* configured SSL_CTX objects */
 };
 #endif /* HAVE_SSL_X509_STORE_SHARE */
 
@@ -709,7 +753,7 @@ static int bio_cf_out_write(BIO *bio, const char *buf, int blen)
   CURLcode result = CURLE_SEND_ERROR;
 
   DEBUGASSERT(data);
-  nwritten = Curl_conn_cf_send(cf->next, data, buf, blen, &result);
+  nwritten = Curl_ssl_cf_next_send(cf, data, buf, blen, &result);
 #if DEBUG_ME
   DEBUGF(infof(data, CFMSG(cf, "bio_cf_out_write(len=%d) -> %d, err=%d"),
          blen, (int)nwritten, result));
@@ -736,7 +780,7 @@ static int bio_cf_in_read(BIO *bio, char *buf, int blen)
   if(!buf)
     return 0;
 
-  nread = Curl_conn_cf_recv(cf->next, data, buf, blen, &result);
+  nread = Curl_ssl_cf_next_recv(cf, data, buf, blen, &result);
 #if DEBUG_ME
   DEBUGF(infof(data, CFMSG(cf, "bio_cf_in_read(len=%d) -> %d, err=%d"),
          blen, (int)nread, result));
@@ -752,6 +796,28 @@ static int bio_cf_in_read(BIO *bio, char *buf, int blen)
 
 static BIO_METHOD *bio_cf_method = NULL;
 
+#ifdef USE_OPENSSL_KTLS
+/* return the socket below the filter if all filters in between pass data
+   through as it is, so that OpenSSL can use it directly */
+static curl_socket_t ossl_ktls_socket(struct Curl_cfilter *cf)
+{
+  struct Curl_cfilter *below;
+  curl_socket_t sock = CURL_SOCKET_BAD;
+
+  for(below = cf->next; below; below = below->next) {
+    if(Curl_cf_is_socket(below)) {
+      if(Curl_cf_socket_peek(below, &sock, NULL, NULL, NULL))
+        sock = CURL_SOCKET_BAD;
+      break;
+    }
+    if((below->cft->do_send != Curl_cf_def_send) ||
+       (below->cft->do_recv != Curl_cf_def_recv))
+      break;
+  }
+  return sock;
+}
+#endif
+
 #if USE_PRE_1_1_API
 
 static BIO_METHOD bio_cf_meth_1_0 = {
@@ -953,6 +1019,148 @@ static bool ossl_attach_cf(struct Curl_cfilter *cf)
   return FALSE;
 }
 
+#ifdef USE_OPENSSL_VERIFY_THREADS
+/* A chain to verify in a thread, with references to all it needs */
+struct ossl_verify_job {
+  struct Curl_thrdjob job; /* must be first */
+  X509_STORE *store;
+  X509 *cert;
+  STACK_OF(X509) *untrusted;
+  X509_VERIFY_PARAM *param;
+  STACK_OF(X509) *chain; /* the verified chain */
+  timediff_t elapsed_us;
+  int ok;
+  int error;
+};
+
+static void ossl_verify_run(struct Curl_thrdjob *thrdjob)
+{
+  struct ossl_verify_job *job = (struct ossl_verify_job *)thrdjob;
+  X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+  struct curltime start = Curl_now();
+
+  job->ok = 0;
+  job->error = X509_V_ERR_OUT_OF_MEM;
+  if(ctx && X509_STORE_CTX_init(ctx, job->store, job->cert, job->untrusted)) {
+    X509_VERIFY_PARAM_set1(X509_STORE_CTX_get0_param(ctx), job->param);
+    job->ok = X509_verify_cert(ctx);
+    job->error = X509_STORE_CTX_get_error(ctx);
+    job->chain = X509_STORE_CTX_get1_chain(ctx);
+  }
+  X509_STORE_CTX_free(ctx);
+  job->elapsed_us = Curl_timediff_us(Curl_now(), start);
+}
+
+static void ossl_verify_dtor(struct Curl_thrdjob *thrdjob)
+{
+  struct ossl_verify_job *job = (struct ossl_verify_job *)thrdjob;
+
+  X509_STORE_free(job->store);
+  X509_free(job->cert);
+  sk_X509_pop_free(job->untrusted, X509_free);
+  X509_VERIFY_PARAM_free(job->param);
+  sk_X509_pop_free(job->chain, X509_free);
+  free(job);
+}
+
+static struct ossl_verify_job *ossl_verify_job_new(X509_STORE_CTX *ctx)
+{
+  struct ossl_verify_job *job = calloc(1, sizeof(*job));
+  X509_STORE *store = X509_STORE_CTX_get0_store(ctx);
+  X509 *cert = X509_STORE_CTX_get0_cert(ctx);
+  STACK_OF(X509) *untrusted = X509_STORE_CTX_get0_untrusted(ctx);
+
+  if(!job)
+    return NULL;
+  job->job.run = ossl_verify_run;
+  job->job.dtor = ossl_verify_dtor;
+  if(X509_STORE_up_ref(store))
+    job->store = store;
+  if(cert && X509_up_ref(cert))
+    job->cert = cert;
+  if(untrusted)
+    job->untrusted = X509_chain_up_ref(untrusted);
+  job->param = X509_VERIFY_PARAM_new();
+  if(!job->store || !job->cert || (untrusted && !job->untrusted) ||
+     !job->param ||
+     !X509_VERIFY_PARAM_set1(job->param, X509_STORE_CTX_get0_param(ctx))) {
+    ossl_verify_dtor(&job->job);
+    return NULL;
+  }
+  return job;
+}
+#endif /* USE_OPENSSL_VERIFY_THREADS */
+
+/*
+ * Called by OpenSSL to verify the server's chain, to time it. When the
+ * connection is done nonblocking and the multi handle has a pool of threads
+ * for it, the chain is handed to the pool and the handshake is suspended
+ * until the result is in. The call after that gets the result.
+ */
+static int ossl_cert_verify_cb(X509_STORE_CTX *ctx, void *arg)
+{
+  SSL *ssl = X509_STORE_CTX_get_ex_data(ctx,
+                                        SSL_get_ex_data_X509_STORE_CTX_idx());
+  int cf_idx = ossl_get_ssl_cf_index();
+  struct Curl_cfilter *cf;
+  struct ssl_connect_data *connssl;
+  struct Curl_easy *data;
+  struct curltime start;
+  int ok;
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  struct ssl_backend_data *backend;
+  struct ossl_verify_job *job;
+  struct Curl_thrdpool *pool;
+#endif
+
+  (void)arg;
+  cf = (ssl && cf_idx >= 0) ? SSL_get_ex_data(ssl, cf_idx) : NULL;
+  if(!cf)
+    return X509_verify_cert(ctx);
+  connssl = cf->ctx;
+  data = connssl->call_data;
+
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  backend = connssl->backend;
+  job = backend->verify_job;
+  if(job) {
+    if(!Curl_thrdjob_done(&job->job)) {
+      SSL_set_retry_verify(ssl);
+      return 1;
+    }
+    ok = job->ok;
+    X509_STORE_CTX_set_error(ctx, job->error);
+    X509_STORE_CTX_set0_verified_chain(ctx, job->chain);
+    job->chain = NULL;
+    if(data && !Curl_ssl_cf_is_proxy(cf))
+      data->info.tls_verify_us += job->elapsed_us;
+    backend->verify_job = NULL;
+    Curl_thrdjob_release(&job->job);
+    return ok;
+  }
+
+  if(backend->verify_async && data && data->multi &&
+     Curl_ssl_cf_get_primary_config(cf)->verifypeer) {
+    pool = Curl_multi_verify_pool(data->multi);
+    job = pool ? ossl_verify_job_new(ctx) : NULL;
+    if(job && SSL_set_retry_verify(ssl)) {
+      infof(data, "SSL certificate verify in a thread");
+      backend->verify_job = job;
+      Curl_thrdpool_add(pool, &job->job);
+      return 1;
+    }
+    if(job)
+      ossl_verify_dtor(&job->job);
+  }
+#endif
+
+  start = Curl_now();
+  ok = X509_verify_cert(ctx);
+  if(data && !Curl_ssl_cf_is_proxy(cf))
+    data->info.tls_verify_us += Curl_timediff_us(Curl_now(), start);
+  return ok;
+}
+
 static int passwd_callback(char *buf, int num, int encrypting,
                            void *global_passwd)
 {
@@ -1968,6 +2176,17 @@ static void ossl_close(struct Curl_cfilter *cf, struct Curl_easy *data)
     SSL_CTX_free(backend->ctx);
     backend->ctx = NULL;
   }
+#ifdef HAVE_OPENSSL_EARLYDATA
+  Curl_dyn_free(&backend->earlydata);
+  backend->earlydata_max = 0;
+  backend->earlydata_replayed = 0;
+#endif
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  if(backend->verify_job) {
+    Curl_thrdjob_release(&backend->verify_job->job);
+    backend->verify_job = NULL;
+  }
+#endif
 }
 
 /*
@@ -3357,24 +3576,30 @@ static X509_STORE *get_cached_x509_store(struct Curl_cfilter *cf,
   return store;
 }
 
-static void set_cached_x509_store(struct Curl_cfilter *cf,
-                                  const struct Curl_easy *data,
-                                  X509_STORE *store)
+/* the backend data of the multi handle, allocated on first use */
+static struct multi_ssl_backend_data *
+get_multi_ssl_backend_data(const struct Curl_easy *data)
 {
-  struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
   struct Curl_multi *multi = data->multi_easy ? data->multi_easy : data->multi;
-  struct multi_ssl_backend_data *mbackend;
 
   if(!multi)
-    return;
+    return NULL;
 
-  if(!multi->ssl_backend_data) {
+  if(!multi->ssl_backend_data)
     multi->ssl_backend_data = calloc(1, sizeof(struct multi_ssl_backend_data));
-    if(!multi->ssl_backend_data)
-      return;
-  }
 
-  mbackend = multi->ssl_backend_data;
+  return multi->ssl_backend_data;
+}
+
+static void set_cached_x509_store(struct Curl_cfilter *cf,
+                                  const struct Curl_easy *data,
+                                  X509_STORE *store)
+{
+  struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
+  struct multi_ssl_backend_data *mbackend = get_multi_ssl_backend_data(data);
+
+  if(!mbackend)
+    return;
 
   if(X509_STORE_up_ref(store)) {
     char *CAfile = NULL;
@@ -3398,6 +3623,44 @@ static void set_cached_x509_store(struct Curl_cfilter *cf,
   }
 }
 
+static void ossl_store_free(void *store)
+{
+  X509_STORE_free((X509_STORE *)store);
+}
+
+/* use the CA store of the share object, or make one for it */
+static CURLcode set_up_shared_x509_store(struct Curl_cfilter *cf,
+                                         struct Curl_easy *data,
+                                         struct ssl_backend_data *backend)
+{
+  struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
+  struct Curl_ssl_ca_store *ca;
+  X509_STORE *store;
+  CURLcode result;
+
+  ca = Curl_ssl_ca_store_get(data, conn_config->CAfile);
+  if(ca) {
+    bool ok = X509_STORE_up_ref(ca->store);
+    if(ok)
+      SSL_CTX_set_cert_store(backend->ctx, ca->store);
+    Curl_ssl_ca_store_release(data, ca);
+    if(ok)
+      return CURLE_OK;
+  }
+
+  store = SSL_CTX_get_cert_store(backend->ctx);
+  result = populate_x509_store(cf, data, store);
+  if(!result && X509_STORE_up_ref(store)) {
+    ca = Curl_ssl_ca_store_add(data, conn_config->CAfile, store,
+                               ossl_store_free);
+    if(ca)
+      Curl_ssl_ca_store_release(data, ca);
+    else
+      X509_STORE_free(store);
+  }
+  return result;
+}
+
 static CURLcode set_up_x509_store(struct Curl_cfilter *cf,
                                   struct Curl_easy *data,
                                   struct ssl_backend_data *backend)
@@ -3418,6 +3681,10 @@ static CURLcode set_up_x509_store(struct Curl_cfilter *cf,
                        !ssl_config->primary.CRLfile &&
                        !ssl_config->native_ca_store;
 
+  if(cache_criteria_met && !ssl_config->no_partialchain &&
+     Curl_ssl_ca_store_shared(data))
+    return set_up_shared_x509_store(cf, data, backend);
+
   cached_store = get_cached_x509_store(cf, data);
   if(cached_store && cache_criteria_met && X509_STORE_up_ref(cached_store)) {
     SSL_CTX_set_cert_store(backend->ctx, cached_store);
@@ -3433,6 +3700,39 @@ static CURLcode set_up_x509_store(struct Curl_cfilter *cf,
 
   return result;
 }
+
+static void ossl_ctx_free(void *ctx)
+{
+  SSL_CTX_free((SSL_CTX *)ctx);
+}
+
+/* get a new reference to the context cached for these settings, if any */
+static SSL_CTX *get_cached_ssl_ctx(struct Curl_easy *data,
+                                   const unsigned char *fingerprint)
+{
+  struct Curl_multi *multi = data->multi_easy ? data->multi_easy : data->multi;
+  SSL_CTX *ctx = NULL;
+
+  if(multi && multi->ssl_backend_data) {
+    ctx = Curl_ssl_ctx_cache_get(&multi->ssl_backend_data->ctx_cache, data,
+                                 fingerprint, ossl_ctx_free);
+    if(ctx && !SSL_CTX_up_ref(ctx))
+      ctx = NULL;
+  }
+
+  return ctx;
+}
+
+static void set_cached_ssl_ctx(struct Curl_easy *data,
+                               const unsigned char *fingerprint,
+                               SSL_CTX *ctx)
+{
+  struct multi_ssl_backend_data *mbackend = get_multi_ssl_backend_data(data);
+
+  if(mbackend && SSL_CTX_up_ref(ctx))
+    Curl_ssl_ctx_cache_add(&mbackend->ctx_cache, fingerprint, ctx,
+                           ossl_ctx_free);
+}
 #else /* HAVE_SSL_X509_STORE_SHARE */
 static CURLcode set_up_x509_store(struct Curl_cfilter *cf,
                                   struct Curl_easy *data,
@@ -3444,30 +3744,20 @@ static CURLcode set_up_x509_store(struct Curl_cfilter *cf,
 }
 #endif /* HAVE_SSL_X509_STORE_SHARE */
 
-static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
-                                   struct Curl_easy *data)
+/*
+ * Create the SSL_CTX for a connection and apply all settings that do not
+ * depend on the host or the transfer, so that it can be reused.
+ */
+static CURLcode ossl_new_ctx(struct Curl_cfilter *cf,
+                             struct Curl_easy *data,
+                             SSL_METHOD_QUAL SSL_METHOD *req_method)
 {
   CURLcode result = CURLE_OK;
   char *ciphers;
-  SSL_METHOD_QUAL SSL_METHOD *req_method = NULL;
   struct ssl_connect_data *connssl = cf->ctx;
   ctx_option_t ctx_options = 0;
-  void *ssl_sessionid = NULL;
   struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
   struct ssl_config_data *ssl_config = Curl_ssl_cf_get_config(cf, data);
-  BIO *bio;
-  int cf_idx = ossl_get_ssl_cf_index();
-
-#ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
-  bool sni;
-  const char *hostname = connssl->hostname;
-
-#ifdef ENABLE_IPV6
-  struct in6_addr addr;
-#else
-  struct in_addr addr;
-#endif
-#endif
   const long int ssl_version = conn_config->version;
   char * const ssl_cert = ssl_config->primary.clientcert;
   const struct curl_blob *ssl_cert_blob = ssl_config->primary.cert_blob;
@@ -3476,53 +3766,6 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
   char error_buffer[256];
   struct ssl_backend_data *backend = connssl->backend;
 
-  DEBUGASSERT(ssl_connect_1 == connssl->connecting_state);
-  DEBUGASSERT(backend);
-
-  if(cf_idx < 0)
-    return CURLE_FAILED_INIT;
-
-  /* Make funny stuff to get random input */
-  result = ossl_seed(data);
-  if(result)
-    return result;
-
-  ssl_config->certverifyresult = !X509_V_OK;
-
-  /* check to see if we've been told to use an explicit SSL/TLS version */
-
-  switch(ssl_version) {
-  case CURL_SSLVERSION_DEFAULT:
-  case CURL_SSLVERSION_TLSv1:
-  case CURL_SSLVERSION_TLSv1_0:
-  case CURL_SSLVERSION_TLSv1_1:
-  case CURL_SSLVERSION_TLSv1_2:
-  case CURL_SSLVERSION_TLSv1_3:
-    /* it will be handled later with the context options */
-#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
-    req_method = TLS_client_method();
-#else
-    req_method = SSLv23_client_method();
-#endif
-    use_sni(TRUE);
-    break;
-  case CURL_SSLVERSION_SSLv2:
-    failf(data, "No SSLv2 support");
-    return CURLE_NOT_BUILT_IN;
-  case CURL_SSLVERSION_SSLv3:
-    failf(data, "No SSLv3 support");
-    return CURLE_NOT_BUILT_IN;
-  default:
-    failf(data, "Unrecognized parameter passed via CURLOPT_SSLVERSION");
-    return CURLE_SSL_CONNECT_ERROR;
-  }
-
-  if(backend->ctx) {
-    /* This happens when an error was encountered before in this
-     * step and we are called to do it again. Get rid of any leftover
-     * from the previous call. */
-    ossl_close(cf, data);
-  }
   backend->ctx = SSL_CTX_new(req_method);
 
   if(!backend->ctx) {
@@ -3535,14 +3778,6 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
   SSL_CTX_set_mode(backend->ctx, SSL_MODE_RELEASE_BUFFERS);
 #endif
 
-#ifdef SSL_CTRL_SET_MSG_CALLBACK
-  if(data->set.fdebug && data->set.verbose) {
-    /* the SSL trace callback is only used for verbose logging */
-    SSL_CTX_set_msg_callback(backend->ctx, ossl_trace);
-    SSL_CTX_set_msg_callback_arg(backend->ctx, cf->conn);
-  }
-#endif
-
   /* OpenSSL contains code to work around lots of bugs and flaws in various
      SSL-implementations. SSL_CTX_set_options() is used to enabled those
      work-arounds. The man page for this option states that SSL_OP_ALL enables
@@ -3634,47 +3869,6 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
 
   SSL_CTX_set_options(backend->ctx, ctx_options);
 
-#ifdef HAS_ALPN
-  if(cf->conn->bits.tls_enable_alpn) {
-    int cur = 0;
-    unsigned char protocols[128];
-
-    if(data->state.httpwant == CURL_HTTP_VERSION_1_0) {
-      protocols[cur++] = ALPN_HTTP_1_0_LENGTH;
-      memcpy(&protocols[cur], ALPN_HTTP_1_0, ALPN_HTTP_1_0_LENGTH);
-      cur += ALPN_HTTP_1_0_LENGTH;
-      infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_HTTP_1_0);
-    }
-    else {
-#ifdef USE_HTTP2
-      if(data->state.httpwant >= CURL_HTTP_VERSION_2
-#ifndef CURL_DISABLE_PROXY
-         && (!Curl_ssl_cf_is_proxy(cf) || !cf->conn->bits.tunnel_proxy)
-#endif
-        ) {
-        protocols[cur++] = ALPN_H2_LENGTH;
-
-        memcpy(&protocols[cur], ALPN_H2, ALPN_H2_LENGTH);
-        cur += ALPN_H2_LENGTH;
-        infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_H2);
-      }
-#endif
-
-      protocols[cur++] = ALPN_HTTP_1_1_LENGTH;
-      memcpy(&protocols[cur], ALPN_HTTP_1_1, ALPN_HTTP_1_1_LENGTH);
-      cur += ALPN_HTTP_1_1_LENGTH;
-      infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_HTTP_1_1);
-    }
-    /* expects length prefixed preference ordered list of protocols in wire
-     * format
-     */
-    if(SSL_CTX_set_alpn_protos(backend->ctx, protocols, cur)) {
-      failf(data, "Error setting ALPN");
-      return CURLE_SSL_CONNECT_ERROR;
-    }
-  }
-#endif
-
   if(ssl_cert || ssl_cert_blob || ssl_cert_type) {
     if(!result &&
        !cert_stuff(data, backend->ctx,
@@ -3763,6 +3957,7 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
    * SSL_get_verify_result() below. */
   SSL_CTX_set_verify(backend->ctx,
                      verifypeer ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+  SSL_CTX_set_cert_verify_callback(backend->ctx, ossl_cert_verify_cb, NULL);
 
   /* Enable logging of secrets to the file specified in env SSLKEYLOGFILE. */
 #ifdef HAVE_KEYLOG_CALLBACK
@@ -3791,6 +3986,141 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
     }
   }
 
+  return CURLE_OK;
+}
+
+#ifdef HAVE_OPENSSL_EARLYDATA
+/*
+ * An attacker can replay early data, so it is only used for requests that
+ * are safe to run twice, and only when the session says the server speaks
+ * HTTP/1.1 (or no ALPN at all) as the request is written before ALPN is
+ * done.
+ */
+static bool ossl_earlydata_ok(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              SSL_SESSION *session)
+{
+  const unsigned char *alpn;
+  size_t alpn_len;
+
+  if(!Curl_ssl_cf_get_config(cf, data)->earlydata ||
+     Curl_ssl_cf_is_proxy(cf) ||
+     !(cf->conn->handler->protocol & PROTO_FAMILY_HTTP) ||
+     data->set.connect_only ||
+     data->set.str[STRING_CUSTOMREQUEST] ||
+     ((data->state.httpreq != HTTPREQ_GET) &&
+      (data->state.httpreq != HTTPREQ_HEAD)) ||
+     (data->state.httpwant == CURL_HTTP_VERSION_1_0) ||
+     !SSL_SESSION_get_max_early_data(session))
+    return FALSE;
+
+  SSL_SESSION_get0_alpn_selected(session, &alpn, &alpn_len);
+  return !alpn_len || ((alpn_len == ALPN_HTTP_1_1_LENGTH) &&
+                       !memcmp(ALPN_HTTP_1_1, alpn, ALPN_HTTP_1_1_LENGTH));
+}
+#endif
+
+static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
+                                   struct Curl_easy *data)
+{
+  CURLcode result = CURLE_OK;
+  SSL_METHOD_QUAL SSL_METHOD *req_method = NULL;
+  struct ssl_connect_data *connssl = cf->ctx;
+  void *ssl_sessionid = NULL;
+  struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
+  struct ssl_config_data *ssl_config = Curl_ssl_cf_get_config(cf, data);
+  BIO *bio;
+  int cf_idx = ossl_get_ssl_cf_index();
+
+#ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
+  bool sni;
+  const char *hostname = connssl->hostname;
+
+#ifdef ENABLE_IPV6
+  struct in6_addr addr;
+#else
+  struct in_addr addr;
+#endif
+#endif
+  const long int ssl_version = conn_config->version;
+  char error_buffer[256];
+  struct ssl_backend_data *backend = connssl->backend;
+#if defined(HAVE_SSL_X509_STORE_SHARE)
+  unsigned char fingerprint[32];
+  bool cacheable;
+#endif
+
+  DEBUGASSERT(ssl_connect_1 == connssl->connecting_state);
+  DEBUGASSERT(backend);
+
+  if(cf_idx < 0)
+    return CURLE_FAILED_INIT;
+
+  /* Make funny stuff to get random input */
+  result = ossl_seed(data);
+  if(result)
+    return result;
+
+  ssl_config->certverifyresult = !X509_V_OK;
+
+  /* check to see if we've been told to use an explicit SSL/TLS version */
+
+  switch(ssl_version) {
+  case CURL_SSLVERSION_DEFAULT:
+  case CURL_SSLVERSION_TLSv1:
+  case CURL_SSLVERSION_TLSv1_0:
+  case CURL_SSLVERSION_TLSv1_1:
+  case CURL_SSLVERSION_TLSv1_2:
+  case CURL_SSLVERSION_TLSv1_3:
+    /* it will be handled later with the context options */
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    req_method = TLS_client_method();
+#else
+    req_method = SSLv23_client_method();
+#endif
+    use_sni(TRUE);
+    break;
+  case CURL_SSLVERSION_SSLv2:
+    failf(data, "No SSLv2 support");
+    return CURLE_NOT_BUILT_IN;
+  case CURL_SSLVERSION_SSLv3:
+    failf(data, "No SSLv3 support");
+    return CURLE_NOT_BUILT_IN;
+  default:
+    failf(data, "Unrecognized parameter passed via CURLOPT_SSLVERSION");
+    return CURLE_SSL_CONNECT_ERROR;
+  }
+
+  if(backend->ctx) {
+    /* This happens when an error was encountered before in this
+     * step and we are called to do it again. Get rid of any leftover
+     * from the previous call. */
+    ossl_close(cf, data);
+  }
+#if defined(HAVE_SSL_X509_STORE_SHARE)
+  /* reuse a context set up the same way before */
+  cacheable = Curl_ssl_ctx_fingerprint(cf, data, fingerprint);
+#ifdef USE_OPENSSL_ENGINE
+  if(data->state.engine)
+    cacheable = FALSE;
+#endif
+  if(cacheable) {
+    backend->ctx = get_cached_ssl_ctx(data, fingerprint);
+    if(backend->ctx)
+      infof(data, "SSL: re-using a configured context");
+  }
+#endif
+
+  if(!backend->ctx) {
+    result = ossl_new_ctx(cf, data, req_method);
+    if(result)
+      return result;
+#if defined(HAVE_SSL_X509_STORE_SHARE)
+    if(cacheable)
+      set_cached_ssl_ctx(data, fingerprint, backend->ctx);
+#endif
+  }
+
   /* Let's make an SSL structure */
   if(backend->handle)
     SSL_free(backend->handle);
@@ -3802,6 +4132,83 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
 
   SSL_set_ex_data(backend->handle, cf_idx, cf);
 
+#ifdef SSL_CTRL_SET_MSG_CALLBACK
+  if(data->set.fdebug && data->set.verbose) {
+    /* the SSL trace callback is only used for verbose logging */
+    SSL_set_msg_callback(backend->handle, ossl_trace);
+    SSL_set_msg_callback_arg(backend->handle, cf->conn);
+  }
+#endif
+
+  if(ssl_config->primary.sessionid) {
+    Curl_ssl_sessionid_lock(data);
+    if(!Curl_ssl_getsessionid(cf, data, &ssl_sessionid, NULL)) {
+      /* we got a session id, use it! */
+      if(!SSL_set_session(backend->handle, ssl_sessionid)) {
+        Curl_ssl_sessionid_unlock(data);
+        failf(data, "SSL: SSL_set_session failed: %s",
+              ossl_strerror(ERR_get_error(), error_buffer,
+                            sizeof(error_buffer)));
+        return CURLE_SSL_CONNECT_ERROR;
+      }
+      /* Informational message */
+      infof(data, "SSL re-using session ID");
+#ifdef HAVE_OPENSSL_EARLYDATA
+      if(ossl_earlydata_ok(cf, data, ssl_sessionid)) {
+        backend->earlydata_max =
+          SSL_SESSION_get_max_early_data(ssl_sessionid);
+        Curl_dyn_init(&backend->earlydata, backend->earlydata_max + 1);
+      }
+#endif
+    }
+    Curl_ssl_sessionid_unlock(data);
+  }
+
+#ifdef HAS_ALPN
+  if(cf->conn->bits.tls_enable_alpn) {
+    int cur = 0;
+    unsigned char protocols[128];
+
+    if(data->state.httpwant == CURL_HTTP_VERSION_1_0) {
+      protocols[cur++] = ALPN_HTTP_1_0_LENGTH;
+      memcpy(&protocols[cur], ALPN_HTTP_1_0, ALPN_HTTP_1_0_LENGTH);
+      cur += ALPN_HTTP_1_0_LENGTH;
+      infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_HTTP_1_0);
+    }
+    else {
+#ifdef USE_HTTP2
+      if(data->state.httpwant >= CURL_HTTP_VERSION_2
+#ifndef CURL_DISABLE_PROXY
+         && (!Curl_ssl_cf_is_proxy(cf) || !cf->conn->bits.tunnel_proxy)
+#endif
+#ifdef HAVE_OPENSSL_EARLYDATA
+         /* early data is written as HTTP/1.1 before the server picks */
+         && !backend->earlydata_max
+#endif
+        ) {
+        protocols[cur++] = ALPN_H2_LENGTH;
+
+        memcpy(&protocols[cur], ALPN_H2, ALPN_H2_LENGTH);
+        cur += ALPN_H2_LENGTH;
+        infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_H2);
+      }
+#endif
+
+      protocols[cur++] = ALPN_HTTP_1_1_LENGTH;
+      memcpy(&protocols[cur], ALPN_HTTP_1_1, ALPN_HTTP_1_1_LENGTH);
+      cur += ALPN_HTTP_1_1_LENGTH;
+      infof(data, VTLS_INFOF_ALPN_OFFER_1STR, ALPN_HTTP_1_1);
+    }
+    /* expects length prefixed preference ordered list of protocols in wire
+     * format
+     */
+    if(SSL_set_alpn_protos(backend->handle, protocols, cur)) {
+      failf(data, "Error setting ALPN");
+      return CURLE_SSL_CONNECT_ERROR;
+    }
+  }
+#endif
+
 #if (OPENSSL_VERSION_NUMBER >= 0x0090808fL) && !defined(OPENSSL_NO_TLSEXT) && \
     !defined(OPENSSL_NO_OCSP)
   if(conn_config->verifystatus)
@@ -3837,22 +4244,25 @@ static CURLcode ossl_connect_step1(struct Curl_cfilter *cf,
     return CURLE_SSL_CONNECT_ERROR;
   }
 
-  if(ssl_config->primary.sessionid) {
-    Curl_ssl_sessionid_lock(data);
-    if(!Curl_ssl_getsessionid(cf, data, &ssl_sessionid, NULL)) {
-      /* we got a session id, use it! */
-      if(!SSL_set_session(backend->handle, ssl_sessionid)) {
-        Curl_ssl_sessionid_unlock(data);
-        failf(data, "SSL: SSL_set_session failed: %s",
+#ifdef USE_OPENSSL_KTLS
+  if(ssl_config->ktls) {
+    curl_socket_t sock = ossl_ktls_socket(cf);
+    if(sock != CURL_SOCKET_BAD) {
+      /* OpenSSL reads and writes the socket itself, and moves the record
+         layer into the kernel if it supports the negotiated cipher */
+      SSL_set_options(backend->handle, SSL_OP_ENABLE_KTLS);
+      if(!SSL_set_fd(backend->handle, (int)sock)) {
+        failf(data, "SSL: SSL_set_fd failed: %s",
               ossl_strerror(ERR_get_error(), error_buffer,
                             sizeof(error_buffer)));
         return CURLE_SSL_CONNECT_ERROR;
       }
-      /* Informational message */
-      infof(data, "SSL re-using session ID");
+      connssl->connecting_state = ssl_connect_2;
+      return CURLE_OK;
     }
-    Curl_ssl_sessionid_unlock(data);
+    infof(data, "kTLS: not possible on this connection");
   }
+#endif
 
   bio = BIO_new(bio_cf_method);
   if(!bio)
@@ -3888,6 +4298,13 @@ static CURLcode ossl_connect_step2(struct Curl_cfilter *cf,
               || ssl_connect_2_writing == connssl->connecting_state);
   DEBUGASSERT(backend);
 
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  if(backend->verify_job && !Curl_thrdjob_done(&backend->verify_job->job)) {
+    Curl_expire(data, SSL_VERIFY_POLL_MS, EXPIRE_SSL_VERIFY);
+    return CURLE_OK;
+  }
+#endif
+
   ERR_clear_error();
 
   err = SSL_connect(backend->handle);
@@ -3914,6 +4331,14 @@ static CURLcode ossl_connect_step2(struct Curl_cfilter *cf,
       connssl->connecting_state = ssl_connect_2_writing;
       return CURLE_OK;
     }
+#ifdef USE_OPENSSL_VERIFY_THREADS
+    if(SSL_ERROR_WANT_RETRY_VERIFY == detail) {
+      /* the pool wakes up curl_multi_poll(), the timer is for the others */
+      connssl->connecting_state = ssl_connect_2;
+      Curl_expire(data, SSL_VERIFY_POLL_MS, EXPIRE_SSL_VERIFY);
+      return CURLE_OK;
+    }
+#endif
 #ifdef SSL_ERROR_WANT_ASYNC
     if(SSL_ERROR_WANT_ASYNC == detail) {
       connssl->connecting_state = ssl_connect_2;
@@ -4011,6 +4436,19 @@ static CURLcode ossl_connect_step2(struct Curl_cfilter *cf,
           SSL_get_version(backend->handle),
           SSL_get_cipher(backend->handle));
 
+    if(!Curl_ssl_cf_is_proxy(cf)) {
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L) && \
+  !defined(LIBRESSL_VERSION_NUMBER)
+      long group = SSL_get_negotiated_group(backend->handle);
+      const char *name = group ?
+        SSL_group_to_name(backend->handle, (int)group) : NULL;
+      if(name)
+        strncpy(data->info.tls_group, name, sizeof(data->info.tls_group) - 1);
+#endif
+      data->info.tls_resumed = SSL_session_reused(backend->handle) ?
+        TRUE : FALSE;
+    }
+
 #ifdef HAS_ALPN
     /* Sets data and len to negotiated protocol, len is 0 if no protocol was
      * negotiated
@@ -4342,6 +4780,15 @@ static CURLcode ossl_connect_step3(struct Curl_cfilter *cf,
   result = servercert(cf, data, conn_config->verifypeer ||
                                 conn_config->verifyhost);
 
+#ifdef USE_OPENSSL_KTLS
+  if(!result && Curl_ssl_cf_get_config(cf, data)->ktls) {
+    SSL *handle = connssl->backend->handle;
+    infof(data, "kTLS: send in %s, receive in %s",
+          BIO_get_ktls_send(SSL_get_wbio(handle)) ? "kernel" : "user space",
+          BIO_get_ktls_recv(SSL_get_rbio(handle)) ? "kernel" : "user space");
+  }
+#endif
+
   if(!result)
     connssl->connecting_state = ssl_connect_done;
 
@@ -4359,7 +4806,8 @@ static CURLcode ossl_connect_common(struct Curl_cfilter *cf,
   int what;
 
   /* check if the connection has already been established */
-  if(ssl_connection_complete == connssl->state) {
+  if(ssl_connection_complete == connssl->state ||
+     ssl_connection_deferred == connssl->state) {
     *done = TRUE;
     return CURLE_OK;
   }
@@ -4377,8 +4825,28 @@ static CURLcode ossl_connect_common(struct Curl_cfilter *cf,
     result = ossl_connect_step1(cf, data);
     if(result)
       goto out;
+
+#ifdef HAVE_OPENSSL_EARLYDATA
+    if(nonblocking && connssl->backend->earlydata_max) {
+      /* the request goes out as early data and the handshake is done on
+         the first read, or when no more early data fits */
+      infof(data, "TLS: sending up to %zu bytes as early data",
+            connssl->backend->earlydata_max);
+      if(cf->conn->bits.tls_enable_alpn) {
+        cf->conn->alpn = CURL_HTTP_VERSION_1_1;
+        Curl_multiuse_state(data, BUNDLE_NO_MULTIUSE);
+      }
+      connssl->state = ssl_connection_deferred;
+      *done = TRUE;
+      goto out;
+    }
+#endif
   }
 
+#ifdef USE_OPENSSL_VERIFY_THREADS
+  connssl->backend->verify_async = nonblocking;
+#endif
+
   while(ssl_connect_2 == connssl->connecting_state ||
         ssl_connect_2_reading == connssl->connecting_state ||
         ssl_connect_2_writing == connssl->connecting_state) {
@@ -4493,6 +4961,112 @@ static bool ossl_data_pending(struct Curl_cfilter *cf,
   return FALSE;
 }
 
+#ifdef HAVE_OPENSSL_EARLYDATA
+static ssize_t ossl_send_earlydata(struct Curl_cfilter *cf,
+                                   struct Curl_easy *data,
+                                   const void *mem,
+                                   size_t len,
+                                   CURLcode *curlcode)
+{
+  struct ssl_connect_data *connssl = cf->ctx;
+  struct ssl_backend_data *backend = connssl->backend;
+  char error_buffer[256];
+  size_t written = 0;
+
+  ERR_clear_error();
+
+  if(!SSL_write_early_data(backend->handle, mem, len, &written)) {
+    int err = SSL_get_error(backend->handle, 0);
+
+    if(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE ||
+       backend->io_result == CURLE_AGAIN) {
+      *curlcode = CURLE_AGAIN;
+      return -1;
+    }
+    failf(data, OSSL_PACKAGE " SSL_write_early_data: %s",
+          ossl_strerror(ERR_get_error(), error_buffer,
+                        sizeof(error_buffer)));
+    *curlcode = CURLE_SEND_ERROR;
+    return -1;
+  }
+
+  /* keep it to send again if the server rejects it */
+  if(Curl_dyn_addn(&backend->earlydata, mem, written)) {
+    *curlcode = CURLE_OUT_OF_MEMORY;
+    return -1;
+  }
+  *curlcode = CURLE_OK;
+  return (ssize_t)written;
+}
+
+/*
+ * Finish a handshake that was left for after the early data, and send the
+ * early data again if the server rejected it. Returns CURLE_AGAIN until
+ * the connection can be used as any other.
+ */
+static CURLcode ossl_earlydata_done(struct Curl_cfilter *cf,
+                                    struct Curl_easy *data)
+{
+  struct ssl_connect_data *connssl = cf->ctx;
+  struct ssl_backend_data *backend = connssl->backend;
+  CURLcode result;
+
+  if(connssl->state == ssl_connection_deferred) {
+    result = ossl_connect_step2(cf, data);
+    if(result)
+      return result;
+    if(connssl->connecting_state != ssl_connect_3)
+      return CURLE_AGAIN;
+    result = ossl_connect_step3(cf, data);
+    if(result)
+      return result;
+    connssl->state = ssl_connection_complete;
+    connssl->connecting_state = ssl_connect_1;
+    if(cf->sockindex == FIRSTSOCKET && !Curl_ssl_cf_is_proxy(cf))
+      Curl_pgrsTime(data, TIMER_APPCONNECT); /* SSL is connected */
+
+    if(SSL_get_early_data_status(backend->handle) ==
+       SSL_EARLY_DATA_ACCEPTED) {
+      infof(data, "TLS: server accepted %zu bytes of early data",
+            Curl_dyn_len(&backend->earlydata));
+      if(!Curl_ssl_cf_is_proxy(cf))
+        data->info.tls_earlydata = TRUE;
+      Curl_dyn_free(&backend->earlydata);
+    }
+    else if(Curl_dyn_len(&backend->earlydata))
+      infof(data, "TLS: server rejected early data, sending it again");
+  }
+
+  while(Curl_dyn_len(&backend->earlydata)) {
+    size_t left = Curl_dyn_len(&backend->earlydata) -
+      backend->earlydata_replayed;
+    int rc;
+
+    ERR_clear_error();
+    rc = SSL_write(backend->handle,
+                   Curl_dyn_ptr(&backend->earlydata) +
+                   backend->earlydata_replayed,
+                   (left > (size_t)INT_MAX) ? INT_MAX : (int)left);
+    if(rc <= 0) {
+      int err = SSL_get_error(backend->handle, rc);
+
+      if(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE ||
+         backend->io_result == CURLE_AGAIN)
+        return CURLE_AGAIN;
+      failf(data, OSSL_PACKAGE " SSL_write: %s, errno %d",
+            SSL_ERROR_to_str(err), SOCKERRNO);
+      return CURLE_SEND_ERROR;
+    }
+    backend->earlydata_replayed += rc;
+    if(backend->earlydata_replayed == Curl_dyn_len(&backend->earlydata)) {
+      Curl_dyn_free(&backend->earlydata);
+      backend->earlydata_replayed = 0;
+    }
+  }
+  return CURLE_OK;
+}
+#endif
+
 static ssize_t ossl_send(struct Curl_cfilter *cf,
                          struct Curl_easy *data,
                          const void *mem,
@@ -4509,9 +5083,23 @@ static ssize_t ossl_send(struct Curl_cfilter *cf,
   struct ssl_connect_data *connssl = cf->ctx;
   struct ssl_backend_data *backend = connssl->backend;
 
-  (void)data;
   DEBUGASSERT(backend);
 
+#ifdef HAVE_OPENSSL_EARLYDATA
+  if(backend->earlydata_max) {
+    if(connssl->state == ssl_connection_deferred) {
+      size_t room = backend->earlydata_max -
+        Curl_dyn_len(&backend->earlydata);
+      if(room)
+        return ossl_send_earlydata(cf, data, mem, CURLMIN(len, room),
+                                   curlcode);
+    }
+    *curlcode = ossl_earlydata_done(cf, data);
+    if(*curlcode)
+      return -1;
+  }
+#endif
+
   ERR_clear_error();
 
   memlen = (len > (size_t)INT_MAX) ? INT_MAX : (int)len;
@@ -4608,6 +5196,14 @@ static ssize_t ossl_recv(struct Curl_cfilter *cf,
   (void)data;
   DEBUGASSERT(backend);
 
+#ifdef HAVE_OPENSSL_EARLYDATA
+  if(backend->earlydata_max) {
+    *curlcode = ossl_earlydata_done(cf, data);
+    if(*curlcode)
+      return -1;
+  }
+#endif
+
   ERR_clear_error();
 
   buffsize = (buffersize > (size_t)INT_MAX) ? INT_MAX : (int)buffersize;
@@ -4836,6 +5432,7 @@ static void ossl_free_multi_ssl_backend_data(
     X509_STORE_free(mbackend->store);
   }
   free(mbackend->CAfile);
+  Curl_ssl_ctx_cache_free(&mbackend->ctx_cache, ossl_ctx_free);
   free(mbackend);
 #else /* HAVE_SSL_X509_STORE_SHARE */
   (void)mbackend;
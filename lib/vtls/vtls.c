@@ -64,6 +64,8 @@
 #include "multiif.h"
 #include "timeval.h"
 #include "curl_md5.h"
+#include "curl_sha256.h"
+#include "curl_hmac.h"
 #include "warnless.h"
 #include "curl_base64.h"
 #include "curl_printf.h"
@@ -73,6 +75,17 @@
 #include "curl_memory.h"
 #include "memdebug.h"
 
+/* The most plain data one TLS record carries. Smaller writes during an upload
+   are collected up to this size and sent together. */
+#define SSL_RECORD_SIZE (16 * 1024)
+
+/* The most milliseconds collected writes wait for more before they are
+   sent */
+#define SSL_FLUSH_MS 1
+
+/* How much raw data is read ahead from the filter below at once */
+#define SSL_READAHEAD_SIZE (32 * 1024)
+
 /* convenience macro to check if this handle is using a shared SSL session */
 #define SSLSESSION_SHARED(data) (data->share &&                        \
                                  (data->share->specifier &             \
@@ -309,6 +322,8 @@ static struct ssl_connect_data *cf_ctx_new(struct Curl_easy *data)
 static void cf_ctx_free(struct ssl_connect_data *ctx)
 {
   if(ctx) {
+    free(ctx->rbuf);
+    free(ctx->sbuf);
     free(ctx->backend);
     free(ctx);
   }
@@ -591,6 +606,312 @@ void Curl_free_multi_ssl_backend_data(struct multi_ssl_backend_data *mbackend)
     Curl_ssl->free_multi_ssl_backend_data(mbackend);
 }
 
+#ifndef CURL_DISABLE_CRYPTO_AUTH
+static void fp_add(void *ctx, const void *ptr, size_t len)
+{
+  const unsigned char *p = ptr;
+  while(len) {
+    unsigned int chunk = (unsigned int)CURLMIN(len, 0x10000);
+    Curl_HMAC_SHA256->hmac_hupdate(ctx, p, chunk);
+    p += chunk;
+    len -= chunk;
+  }
+}
+
+/* add a value with its length in front, to keep neighbors apart */
+static void fp_mem(void *ctx, const void *ptr, size_t len, bool set)
+{
+  unsigned char tag = set;
+  fp_add(ctx, &tag, 1);
+  if(set) {
+    fp_add(ctx, &len, sizeof(len));
+    fp_add(ctx, ptr, len);
+  }
+}
+
+static void fp_str(void *ctx, const char *str)
+{
+  fp_mem(ctx, str, str ? strlen(str) : 0, str != NULL);
+}
+
+static void fp_blob(void *ctx, const struct curl_blob *blob)
+{
+  fp_mem(ctx, blob ? blob->data : NULL, blob ? blob->len : 0, blob != NULL);
+}
+
+static void fp_num(void *ctx, long num)
+{
+  fp_add(ctx, &num, sizeof(num));
+}
+
+static void fp_primary(void *ctx, const struct ssl_primary_config *c)
+{
+  fp_str(ctx, c->CApath);
+  fp_str(ctx, c->CAfile);
+  fp_str(ctx, c->issuercert);
+  fp_str(ctx, c->clientcert);
+  fp_str(ctx, c->cipher_list);
+  fp_str(ctx, c->cipher_list13);
+  fp_str(ctx, c->pinned_key);
+  fp_str(ctx, c->CRLfile);
+  fp_blob(ctx, c->cert_blob);
+  fp_blob(ctx, c->ca_info_blob);
+  fp_blob(ctx, c->issuercert_blob);
+#ifdef USE_TLS_SRP
+  fp_str(ctx, c->username);
+  fp_str(ctx, c->password);
+#endif
+  fp_str(ctx, c->curves);
+  fp_num(ctx, c->ssl_options);
+  fp_num(ctx, (long)c->version_max);
+  fp_num(ctx, c->version);
+  fp_num(ctx, (c->verifypeer << 2) | (c->verifyhost << 1) | c->verifystatus);
+}
+#endif
+
+/*
+ * Curl_ssl_ctx_fingerprint() calculates a SHA-256 fingerprint of the
+ * settings a backend applies to a new SSL context. Settings that depend on
+ * the host or the transfer (SNI, ALPN, debug callbacks) must be set on each
+ * connection instead. Contexts an application callback or a TLS-SRP login
+ * may have changed are not cached.
+ */
+bool Curl_ssl_ctx_fingerprint(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              unsigned char *fingerprint)
+{
+#ifndef CURL_DISABLE_CRYPTO_AUTH
+  struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
+  struct ssl_config_data *ssl_config = Curl_ssl_cf_get_config(cf, data);
+  void *ctx;
+
+  /* the callback is set once for both the proxy and the server filter */
+  if(!data->set.general_ssl.ca_cache_timeout || data->set.ssl.fsslctx)
+    return FALSE;
+#ifdef USE_TLS_SRP
+  if(ssl_config->primary.username)
+    return FALSE;
+#endif
+
+  ctx = malloc(Curl_HMAC_SHA256->hmac_ctxtsize);
+  if(!ctx)
+    return FALSE;
+  if(Curl_HMAC_SHA256->hmac_hinit(ctx)) {
+    free(ctx);
+    return FALSE;
+  }
+  fp_primary(ctx, conn_config);
+  fp_primary(ctx, &ssl_config->primary);
+  fp_str(ctx, ssl_config->cert_type);
+  fp_str(ctx, ssl_config->key);
+  fp_blob(ctx, ssl_config->key_blob);
+  fp_str(ctx, ssl_config->key_type);
+  fp_str(ctx, ssl_config->key_passwd);
+  fp_num(ctx, (ssl_config->enable_beast << 5) |
+         (ssl_config->no_revoke << 4) |
+         (ssl_config->no_partialchain << 3) |
+         (ssl_config->revoke_best_effort << 2) |
+         (ssl_config->native_ca_store << 1) |
+         ssl_config->auto_client_cert);
+  Curl_HMAC_SHA256->hmac_hfinal(fingerprint, ctx);
+  free(ctx);
+  return TRUE;
+#else
+  (void)cf;
+  (void)data;
+  (void)fingerprint;
+  return FALSE;
+#endif
+}
+
+void *Curl_ssl_ctx_cache_get(struct ssl_ctx_cache *cache,
+                             struct Curl_easy *data,
+                             const unsigned char *fingerprint,
+                             Curl_ssl_ctx_free_cb ctx_free)
+{
+  /* the context holds the CA store, so it expires with the store cache */
+  timediff_t timeout_ms =
+    data->set.general_ssl.ca_cache_timeout * (timediff_t)1000;
+  size_t i;
+
+  for(i = 0; i < MAX_SSL_CTX_CACHE; i++) {
+    struct ssl_ctx_cache_entry *e = &cache->entry[i];
+    if(e->ctx &&
+       !memcmp(e->fingerprint, fingerprint, sizeof(e->fingerprint))) {
+      if((timeout_ms >= 0) &&
+         (Curl_timediff(Curl_now(), e->created) >= timeout_ms)) {
+        ctx_free(e->ctx);
+        e->ctx = NULL;
+        return NULL;
+      }
+      e->age = ++cache->age;
+      return e->ctx;
+    }
+  }
+  return NULL;
+}
+
+void Curl_ssl_ctx_cache_add(struct ssl_ctx_cache *cache,
+                            const unsigned char *fingerprint,
+                            void *ctx, Curl_ssl_ctx_free_cb ctx_free)
+{
+  struct ssl_ctx_cache_entry *e = NULL;
+  size_t i;
+
+  /* use an empty slot or the least recently used one */
+  for(i = 0; i < MAX_SSL_CTX_CACHE; i++) {
+    struct ssl_ctx_cache_entry *check = &cache->entry[i];
+    if(!check->ctx) {
+      e = check;
+      break;
+    }
+    if(!e || (check->age < e->age))
+      e = check;
+  }
+  if(e->ctx)
+    ctx_free(e->ctx);
+  memcpy(e->fingerprint, fingerprint, sizeof(e->fingerprint));
+  e->created = Curl_now();
+  e->age = ++cache->age;
+  e->ctx = ctx;
+}
+
+void Curl_ssl_ctx_cache_free(struct ssl_ctx_cache *cache,
+                             Curl_ssl_ctx_free_cb ctx_free)
+{
+  size_t i;
+  for(i = 0; i < MAX_SSL_CTX_CACHE; i++) {
+    if(cache->entry[i].ctx) {
+      ctx_free(cache->entry[i].ctx);
+      cache->entry[i].ctx = NULL;
+    }
+  }
+}
+
+/*
+ * A share object with CURL_LOCK_DATA_CA_STORE holds a reference to one CA
+ * store and each user holds another while using it. A store that expires
+ * or gets replaced lives on until its last user lets go, which may happen
+ * without the handle that got it, so the lock is taken with the share the
+ * store was made for.
+ */
+static void ca_store_lock(struct Curl_share *share, struct Curl_easy *data)
+{
+  if(share->lockfunc)
+    share->lockfunc(data, CURL_LOCK_DATA_CA_STORE, CURL_LOCK_ACCESS_SINGLE,
+                    share->clientdata);
+}
+
+static void ca_store_unlock(struct Curl_share *share, struct Curl_easy *data)
+{
+  if(share->unlockfunc)
+    share->unlockfunc(data, CURL_LOCK_DATA_CA_STORE, share->clientdata);
+}
+
+/* drop a reference, the share must be locked */
+static void ca_store_unref(struct Curl_ssl_ca_store *ca)
+{
+  if(!--ca->refcount) {
+    ca->store_free(ca->store);
+    free(ca->CAfile);
+    free(ca);
+  }
+}
+
+bool Curl_ssl_ca_store_shared(struct Curl_easy *data)
+{
+  return data->share &&
+    (data->share->specifier & (1<< CURL_LOCK_DATA_CA_STORE)) &&
+    data->set.general_ssl.ca_cache_timeout;
+}
+
+struct Curl_ssl_ca_store *Curl_ssl_ca_store_get(struct Curl_easy *data,
+                                                const char *CAfile)
+{
+  struct Curl_share *share = data->share;
+  struct Curl_ssl_ca_store *ca;
+  timediff_t timeout_ms =
+    data->set.general_ssl.ca_cache_timeout * (timediff_t)1000;
+
+  if(!Curl_ssl_ca_store_shared(data))
+    return NULL;
+
+  ca_store_lock(share, data);
+  ca = share->ca_store;
+  if(ca && (timeout_ms >= 0) &&
+     (Curl_timediff(Curl_now(), ca->created) >= timeout_ms)) {
+    /* the next user makes a fresh one */
+    share->ca_store = NULL;
+    ca_store_unref(ca);
+    ca = NULL;
+  }
+  if(ca && ((!ca->CAfile || !CAfile) ?
+            (ca->CAfile != CAfile) : !!strcmp(ca->CAfile, CAfile)))
+    ca = NULL;
+  if(ca) {
+    ca->refcount++;
+    share->ca_store_users++;
+  }
+  ca_store_unlock(share, data);
+  return ca;
+}
+
+struct Curl_ssl_ca_store *Curl_ssl_ca_store_add(struct Curl_easy *data,
+                                                const char *CAfile,
+                                                void *store,
+                                                Curl_ssl_ctx_free_cb
+                                                store_free)
+{
+  struct Curl_share *share = data->share;
+  struct Curl_ssl_ca_store *ca;
+
+  if(!Curl_ssl_ca_store_shared(data))
+    return NULL;
+
+  ca = calloc(1, sizeof(*ca));
+  if(!ca)
+    return NULL;
+  if(CAfile) {
+    ca->CAfile = strdup(CAfile);
+    if(!ca->CAfile) {
+      free(ca);
+      return NULL;
+    }
+  }
+  ca->created = Curl_now();
+  ca->store = store;
+  ca->store_free = store_free;
+  ca->share = share;
+  ca->refcount = 2; /* the share and the caller */
+
+  ca_store_lock(share, data);
+  if(share->ca_store)
+    ca_store_unref(share->ca_store);
+  share->ca_store = ca;
+  share->ca_store_users++;
+  ca_store_unlock(share, data);
+  return ca;
+}
+
+void Curl_ssl_ca_store_release(struct Curl_easy *data,
+                               struct Curl_ssl_ca_store *ca)
+{
+  struct Curl_share *share = ca->share;
+
+  ca_store_lock(share, data);
+  share->ca_store_users--;
+  ca_store_unref(ca);
+  ca_store_unlock(share, data);
+}
+
+void Curl_ssl_ca_store_unshare(struct Curl_share *share)
+{
+  if(share->ca_store) {
+    ca_store_unref(share->ca_store);
+    share->ca_store = NULL;
+  }
+}
+
 void Curl_ssl_close_all(struct Curl_easy *data)
 {
   /* kill the session ID cache if not shared */
@@ -1420,6 +1741,12 @@ static void cf_close(struct Curl_cfilter *cf, struct Curl_easy *data)
   if(connssl) {
     Curl_ssl->close(cf, data);
     connssl->state = ssl_connection_none;
+    connssl->rbuf_len = connssl->rbuf_pos = 0;
+    connssl->sbuf_len = 0;
+    connssl->peer_closed = FALSE;
+    connssl->recv_err = CURLE_OK;
+    memset(&connssl->scan_in, 0, sizeof(connssl->scan_in));
+    memset(&connssl->scan_out, 0, sizeof(connssl->scan_out));
   }
   cf->connected = FALSE;
 }
@@ -1477,6 +1804,7 @@ static CURLcode ssl_cf_connect(struct Curl_cfilter *cf,
                                bool blocking, bool *done)
 {
   struct ssl_connect_data *connssl = cf->ctx;
+  struct curltime start;
   CURLcode result;
 
   if(cf->connected) {
@@ -1500,6 +1828,7 @@ static CURLcode ssl_cf_connect(struct Curl_cfilter *cf,
   reinit_hostname(cf);
   *done = FALSE;
 
+  start = Curl_now();
   if(blocking) {
     result = ssl_connect(cf, data);
     *done = (result == CURLE_OK);
@@ -1507,12 +1836,17 @@ static CURLcode ssl_cf_connect(struct Curl_cfilter *cf,
   else {
     result = ssl_connect_nonblocking(cf, data, done);
   }
+  if(!Curl_ssl_cf_is_proxy(cf))
+    data->info.tls_handshake_us += Curl_timediff_us(Curl_now(), start);
 
   if(!result && *done) {
     cf->connected = TRUE;
-    if(cf->sockindex == FIRSTSOCKET && !Curl_ssl_cf_is_proxy(cf))
+    /* a deferred handshake sets the time when it is done */
+    if(cf->sockindex == FIRSTSOCKET && !Curl_ssl_cf_is_proxy(cf) &&
+       connssl->state == ssl_connection_complete)
       Curl_pgrsTime(data, TIMER_APPCONNECT); /* SSL is connected */
-    DEBUGASSERT(connssl->state == ssl_connection_complete);
+    DEBUGASSERT(connssl->state == ssl_connection_complete ||
+                connssl->state == ssl_connection_deferred);
   }
 out:
   cf_ctx_set_data(cf, NULL);
@@ -1522,10 +1856,13 @@ out:
 static bool ssl_cf_data_pending(struct Curl_cfilter *cf,
                                 const struct Curl_easy *data)
 {
+  struct ssl_connect_data *connssl = cf->ctx;
   bool result;
 
   cf_ctx_set_data(cf, (struct Curl_easy *)data);
-  if(cf->ctx && Curl_ssl->data_pending(cf, data))
+  if(connssl && (Curl_ssl->data_pending(cf, data) ||
+                 (connssl->rbuf_pos < connssl->rbuf_len) ||
+                 connssl->peer_closed || connssl->recv_err))
     result = TRUE;
   else
     result = cf->next->cft->has_data_pending(cf->next, data);
@@ -1533,15 +1870,179 @@ static bool ssl_cf_data_pending(struct Curl_cfilter *cf,
   return result;
 }
 
+/*
+ * Return the number of record headers that end in the raw data, which may
+ * start or end anywhere in a record.
+ */
+static curl_off_t ssl_scan_records(struct ssl_record_scan *scan,
+                                   const unsigned char *buf, size_t len)
+{
+  curl_off_t records = 0;
+
+  while(len) {
+    if(scan->left) {
+      size_t n = CURLMIN(scan->left, len);
+      scan->left -= n;
+      buf += n;
+      len -= n;
+    }
+    else {
+      scan->hdr[scan->hdr_len++] = *buf++;
+      len--;
+      if(scan->hdr_len == sizeof(scan->hdr)) {
+        /* content type, version and the length of the rest */
+        scan->left = ((size_t)scan->hdr[3] << 8) | scan->hdr[4];
+        scan->hdr_len = 0;
+        records++;
+      }
+    }
+  }
+  return records;
+}
+
+ssize_t Curl_ssl_cf_next_recv(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              char *buf, size_t len, CURLcode *err)
+{
+  struct ssl_connect_data *connssl = cf->ctx;
+  size_t n;
+
+  if(connssl->rbuf_pos == connssl->rbuf_len) {
+    ssize_t nread;
+
+    if(len >= SSL_READAHEAD_SIZE) {
+      nread = Curl_conn_cf_recv(cf->next, data, buf, len, err);
+      if(nread > 0 && !Curl_ssl_cf_is_proxy(cf)) {
+        data->info.tls_records_in +=
+          ssl_scan_records(&connssl->scan_in, (unsigned char *)buf, nread);
+        data->info.tls_bytes_in += nread;
+      }
+      return nread;
+    }
+    if(!connssl->rbuf) {
+      connssl->rbuf = malloc(SSL_READAHEAD_SIZE);
+      if(!connssl->rbuf) {
+        *err = CURLE_OUT_OF_MEMORY;
+        return -1;
+      }
+    }
+    nread = Curl_conn_cf_recv(cf->next, data, connssl->rbuf,
+                              SSL_READAHEAD_SIZE, err);
+    if(nread <= 0)
+      return nread;
+    connssl->rbuf_pos = 0;
+    connssl->rbuf_len = (size_t)nread;
+    if(!Curl_ssl_cf_is_proxy(cf)) {
+      data->info.tls_records_in +=
+        ssl_scan_records(&connssl->scan_in, (unsigned char *)connssl->rbuf,
+                         nread);
+      data->info.tls_bytes_in += nread;
+    }
+  }
+
+  n = CURLMIN(len, connssl->rbuf_len - connssl->rbuf_pos);
+  memcpy(buf, connssl->rbuf + connssl->rbuf_pos, n);
+  connssl->rbuf_pos += n;
+  *err = CURLE_OK;
+  return (ssize_t)n;
+}
+
+ssize_t Curl_ssl_cf_next_send(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              const void *buf, size_t len, CURLcode *err)
+{
+  struct ssl_connect_data *connssl = cf->ctx;
+  ssize_t nwritten = Curl_conn_cf_send(cf->next, data, buf, len, err);
+
+  if(nwritten > 0 && !Curl_ssl_cf_is_proxy(cf)) {
+    data->info.tls_records_out +=
+      ssl_scan_records(&connssl->scan_out, buf, nwritten);
+    data->info.tls_bytes_out += nwritten;
+  }
+  return nwritten;
+}
+
+/*
+ * Small writes are only collected while a transfer uploads, where the data
+ * idle event and the end of the upload send them off. Anything else, like
+ * a request or a command the peer is to answer, goes out right away.
+ */
+static bool ssl_cf_may_collect(struct Curl_easy *data)
+{
+  return (data->mstate == MSTATE_PERFORMING) &&
+    ((data->req.keepon & KEEP_SENDBITS) == KEEP_SEND);
+}
+
+/*
+ * Send the collected writes. The backend is called again with the same
+ * buffer until it took it all, as the TLS libraries want a write they
+ * could not finish to be repeated with the same data.
+ */
+static CURLcode ssl_cf_flush(struct Curl_cfilter *cf, struct Curl_easy *data)
+{
+  struct ssl_connect_data *connssl = cf->ctx;
+  CURLcode result = CURLE_OK;
+
+  while(connssl->sbuf_len) {
+    ssize_t nwritten = Curl_ssl->send_plain(cf, data, connssl->sbuf,
+                                            connssl->sbuf_len, &result);
+    if(nwritten < 0)
+      /* on CURLE_AGAIN, ssl_cf_get_select_socks() has the transfer wait
+         for the socket to be writable and the idle event tries again */
+      return result;
+    connssl->sbuf_len -= (size_t)nwritten;
+    if(connssl->sbuf_len)
+      memmove(connssl->sbuf, connssl->sbuf + nwritten, connssl->sbuf_len);
+  }
+  return CURLE_OK;
+}
+
 static ssize_t ssl_cf_send(struct Curl_cfilter *cf,
                            struct Curl_easy *data, const void *buf, size_t len,
                            CURLcode *err)
 {
+  struct ssl_connect_data *connssl = cf->ctx;
   ssize_t nwritten;
 
   *err = CURLE_OK;
   cf_ctx_set_data(cf, data);
-  nwritten = Curl_ssl->send_plain(cf, data, buf, len, err);
+  if(!connssl->sbuf_len &&
+     ((len >= SSL_RECORD_SIZE) || !ssl_cf_may_collect(data))) {
+    nwritten = Curl_ssl->send_plain(cf, data, buf, len, err);
+    goto out;
+  }
+
+  if(connssl->sbuf_len == SSL_RECORD_SIZE) {
+    *err = ssl_cf_flush(cf, data);
+    if(*err) {
+      nwritten = -1;
+      goto out;
+    }
+  }
+  if(!connssl->sbuf) {
+    connssl->sbuf = malloc(SSL_RECORD_SIZE);
+    if(!connssl->sbuf) {
+      *err = CURLE_OUT_OF_MEMORY;
+      nwritten = -1;
+      goto out;
+    }
+  }
+
+  nwritten = (ssize_t)CURLMIN(len, SSL_RECORD_SIZE - connssl->sbuf_len);
+  memcpy(connssl->sbuf + connssl->sbuf_len, buf, nwritten);
+  connssl->sbuf_len += nwritten;
+  if(connssl->sbuf_len == SSL_RECORD_SIZE || !ssl_cf_may_collect(data)) {
+    /* the data is taken, it is sent later if this cannot send it now */
+    CURLcode result = ssl_cf_flush(cf, data);
+    if(result && (result != CURLE_AGAIN)) {
+      *err = result;
+      nwritten = -1;
+    }
+  }
+  else
+    Curl_expire(data, SSL_FLUSH_MS, EXPIRE_SSL_FLUSH);
+
+out:
   cf_ctx_set_data(cf, NULL);
   return nwritten;
 }
@@ -1550,11 +2051,50 @@ static ssize_t ssl_cf_recv(struct Curl_cfilter *cf,
                            struct Curl_easy *data, char *buf, size_t len,
                            CURLcode *err)
 {
+  struct ssl_connect_data *connssl = cf->ctx;
   ssize_t nread;
 
   *err = CURLE_OK;
   cf_ctx_set_data(cf, data);
+  if(connssl->sbuf_len) {
+    CURLcode result = ssl_cf_flush(cf, data);
+    if(result && (result != CURLE_AGAIN)) {
+      *err = result;
+      nread = -1;
+      goto out;
+    }
+  }
+  if(connssl->recv_err) {
+    *err = connssl->recv_err;
+    connssl->recv_err = CURLE_OK;
+    nread = -1;
+    goto out;
+  }
+  if(connssl->peer_closed) {
+    nread = 0;
+    goto out;
+  }
   nread = Curl_ssl->recv_plain(cf, data, buf, len, err);
+
+  /* Decrypt what has been read ahead into the rest of the buffer. Data left
+     behind here does not show on the socket and a multiplexing filter above
+     would not know that other transfers have data waiting. */
+  while((nread > 0) && ((size_t)nread < len) &&
+        (connssl->rbuf_pos < connssl->rbuf_len)) {
+    CURLcode result;
+    ssize_t n = Curl_ssl->recv_plain(cf, data, buf + nread, len - nread,
+                                     &result);
+    if(n <= 0) {
+      /* return what was read now and the end or error next time */
+      if(!n)
+        connssl->peer_closed = TRUE;
+      else if(result != CURLE_AGAIN)
+        connssl->recv_err = result;
+      break;
+    }
+    nread += n;
+  }
+out:
   cf_ctx_set_data(cf, NULL);
   return nread;
 }
@@ -1563,11 +2103,24 @@ static int ssl_cf_get_select_socks(struct Curl_cfilter *cf,
                                    struct Curl_easy *data,
                                    curl_socket_t *socks)
 {
+  struct ssl_connect_data *connssl = cf->ctx;
   int result;
 
-  cf_ctx_set_data(cf, data);
-  result = Curl_ssl->get_select_socks(cf, data, socks);
-  cf_ctx_set_data(cf, NULL);
+  if(cf->connected && (connssl->state != ssl_connection_deferred))
+    /* the transfer waits on the socket for its own reads and writes */
+    result = GETSOCK_BLANK;
+  else {
+    /* still connecting, or sending early data while the handshake goes on */
+    cf_ctx_set_data(cf, data);
+    result = Curl_ssl->get_select_socks(cf, data, socks);
+    cf_ctx_set_data(cf, NULL);
+  }
+
+  if((result == GETSOCK_BLANK) && connssl->sbuf_len) {
+    /* collected writes the socket did not take yet */
+    socks[0] = cf->conn->sock[cf->sockindex];
+    result = GETSOCK_WRITESOCK(0);
+  }
   return result;
 }
 
@@ -1575,6 +2128,8 @@ static CURLcode ssl_cf_cntrl(struct Curl_cfilter *cf,
                              struct Curl_easy *data,
                              int event, int arg1, void *arg2)
 {
+  struct ssl_connect_data *connssl = cf->ctx;
+
   (void)arg1;
   (void)arg2;
   switch(event) {
@@ -1592,6 +2147,18 @@ static CURLcode ssl_cf_cntrl(struct Curl_cfilter *cf,
       cf_ctx_set_data(cf, NULL);
     }
     break;
+  case CF_CTRL_DATA_IDLE:
+  case CF_CTRL_DATA_DONE_SEND:
+  case CF_CTRL_DATA_DONE:
+    if(connssl && connssl->sbuf_len) {
+      CURLcode result;
+      cf_ctx_set_data(cf, data);
+      result = ssl_cf_flush(cf, data);
+      cf_ctx_set_data(cf, NULL);
+      if(result && (result != CURLE_AGAIN))
+        return result;
+    }
+    break;
   default:
     break;
   }
@@ -30,6 +30,7 @@ struct ssl_config_data;
 struct ssl_connect_data;
 struct ssl_primary_config;
 struct Curl_ssl_session;
+struct Curl_share;
 
 #define SSLSUPP_CA_PATH      (1<<0) /* supports CAPATH */
 #define SSLSUPP_CERTINFO     (1<<1) /* supports CURLOPT_CERTINFO */
@@ -152,6 +153,9 @@ bool Curl_ssl_false_start(struct Curl_easy *data);
 
 void Curl_free_multi_ssl_backend_data(struct multi_ssl_backend_data *mbackend);
 
+/* let go of the CA store a share object holds */
+void Curl_ssl_ca_store_unshare(struct Curl_share *share);
+
 #define SSL_SHUTDOWN_TIMEOUT 10000 /* ms */
 
 CURLcode Curl_ssl_cfilter_add(struct Curl_easy *data,
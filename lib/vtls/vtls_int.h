@@ -29,6 +29,13 @@
 
 #ifdef USE_SSL
 
+/* Follows the TLS record headers in raw data, to count the records */
+struct ssl_record_scan {
+  size_t left;               /* bytes of the current record still to come */
+  unsigned char hdr[5];      /* record header seen so far */
+  unsigned char hdr_len;     /* amount of data in hdr */
+};
+
 /* Information in each SSL cfilter context: cf->ctx */
 struct ssl_connect_data {
   ssl_connection_state state;
@@ -42,6 +49,17 @@ struct ssl_connect_data {
                                      * here for backend internal callbacks
                                      * that need it. NULLed after at the
                                      * end of each vtls filter invcocation. */
+  char *rbuf;                       /* raw data read ahead from below */
+  size_t rbuf_len;                  /* amount of data in rbuf */
+  size_t rbuf_pos;                  /* offset of first unused byte in rbuf */
+  char *sbuf;                       /* small writes collected into a record */
+  size_t sbuf_len;                  /* amount of data in sbuf */
+  struct ssl_record_scan scan_in;   /* records received */
+  struct ssl_record_scan scan_out;  /* records sent */
+  CURLcode recv_err;                /* error seen while filling a buffer,
+                                       returned on the next recv */
+  BIT(peer_closed);                 /* end of data seen while filling a
+                                       buffer, returned on the next recv */
 };
 
 
@@ -153,6 +171,22 @@ struct Curl_cfilter *Curl_ssl_cf_get_ssl(struct Curl_cfilter *cf);
  */
 bool Curl_ssl_cf_is_proxy(struct Curl_cfilter *cf);
 
+/**
+ * Receive raw TLS data for the backend from the filter below `cf`. The
+ * filter reads ahead in large chunks and hands out the pieces the TLS
+ * library asks for, so that a record header does not cost a recv call.
+ */
+ssize_t Curl_ssl_cf_next_recv(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              char *buf, size_t len, CURLcode *err);
+
+/**
+ * Send raw TLS data from the backend to the filter below `cf`.
+ */
+ssize_t Curl_ssl_cf_next_send(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              const void *buf, size_t len, CURLcode *err);
+
 /* extract a session ID
  * Sessionid mutex must be locked (see Curl_ssl_sessionid_lock).
  * Caller must make sure that the ownership of returned sessionid object
@@ -174,6 +208,72 @@ CURLcode Curl_ssl_addsessionid(struct Curl_cfilter *cf,
                                size_t idsize,
                                bool *added);
 
+/* the number of configured SSL contexts a multi handle keeps for reuse */
+#define MAX_SSL_CTX_CACHE 8
+
+/* an SSL context with all settings applied, kept for later connections
+   with the same settings */
+struct ssl_ctx_cache_entry {
+  unsigned char fingerprint[32]; /* SHA-256 of the settings */
+  struct curltime created;       /* when the context was set up */
+  long age;                      /* the higher the more recently used */
+  void *ctx;                     /* backend context, NULL in unused slots */
+};
+
+struct ssl_ctx_cache {
+  struct ssl_ctx_cache_entry entry[MAX_SSL_CTX_CACHE];
+  long age;
+};
+
+typedef void (*Curl_ssl_ctx_free_cb)(void *ctx);
+
+/* calculate the fingerprint of all settings that go into an SSL context,
+ * returns FALSE when the context should not be cached */
+bool Curl_ssl_ctx_fingerprint(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              unsigned char *fingerprint);
+/* return the context cached for the fingerprint or NULL. The caller takes
+ * its own reference to it. */
+void *Curl_ssl_ctx_cache_get(struct ssl_ctx_cache *cache,
+                             struct Curl_easy *data,
+                             const unsigned char *fingerprint,
+                             Curl_ssl_ctx_free_cb ctx_free);
+/* store a context the cache takes a reference to, replacing the least
+ * recently used one when full */
+void Curl_ssl_ctx_cache_add(struct ssl_ctx_cache *cache,
+                            const unsigned char *fingerprint,
+                            void *ctx, Curl_ssl_ctx_free_cb ctx_free);
+void Curl_ssl_ctx_cache_free(struct ssl_ctx_cache *cache,
+                             Curl_ssl_ctx_free_cb ctx_free);
+
+/* a parsed CA store shared by all handles using a share object with
+   CURL_LOCK_DATA_CA_STORE */
+struct Curl_ssl_ca_store {
+  char *CAfile;                  /* file it was made from, NULL for none */
+  struct curltime created;       /* when it was made */
+  void *store;                   /* backend store */
+  Curl_ssl_ctx_free_cb store_free;
+  struct Curl_share *share;      /* the share it was made for */
+  size_t refcount;               /* the share's plus one for each user */
+};
+
+/* TRUE if the share object of the transfer holds a CA store */
+bool Curl_ssl_ca_store_shared(struct Curl_easy *data);
+/* return the shared store made from CAfile with a reference for the
+ * caller, or NULL */
+struct Curl_ssl_ca_store *Curl_ssl_ca_store_get(struct Curl_easy *data,
+                                                const char *CAfile);
+/* make a new store the shared one, returns it with a reference for the
+ * caller or NULL if out of memory, in which case the caller keeps it */
+struct Curl_ssl_ca_store *Curl_ssl_ca_store_add(struct Curl_easy *data,
+                                                const char *CAfile,
+                                                void *store,
+                                                Curl_ssl_ctx_free_cb
+                                                store_free);
+/* let go of a reference from Curl_ssl_ca_store_get/add */
+void Curl_ssl_ca_store_release(struct Curl_easy *data,
+                               struct Curl_ssl_ca_store *ca);
+
 #include "openssl.h"        /* OpenSSL versions */
 #include "gtls.h"           /* GnuTLS versions */
 #include "nssg.h"           /* NSS versions */
@@ -305,7 +305,7 @@ static int bio_cf_out_write(WOLFSSL_BIO *bio, const char *buf, int blen)
   CURLcode result = CURLE_OK;
 
   DEBUGASSERT(data);
-  nwritten = Curl_conn_cf_send(cf->next, data, buf, blen, &result);
+  nwritten = Curl_ssl_cf_next_send(cf, data, buf, blen, &result);
   wolfSSL_BIO_clear_retry_flags(bio);
   if(nwritten < 0 && CURLE_AGAIN == result)
     BIO_set_retry_read(bio);
@@ -325,7 +325,7 @@ static int bio_cf_in_read(WOLFSSL_BIO *bio, char *buf, int blen)
   if(!buf)
     return 0;
 
-  nread = Curl_conn_cf_recv(cf->next, data, buf, blen, &result);
+  nread = Curl_ssl_cf_next_recv(cf, data, buf, blen, &result);
   wolfSSL_BIO_clear_retry_flags(bio);
   if(nread < 0 && CURLE_AGAIN == result)
     BIO_set_retry_read(bio);
@@ -922,6 +922,9 @@ wolfssl_connect_step2(struct Curl_cfilter *cf, struct Curl_easy *data)
 #else
   infof(data, "SSL connected");
 #endif
+  if(!Curl_ssl_cf_is_proxy(cf))
+    data->info.tls_resumed = wolfSSL_session_reused(backend->handle) ?
+      TRUE : FALSE;
 
   return CURLE_OK;
 }
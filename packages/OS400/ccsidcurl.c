@@ -1182,6 +1182,7 @@ curl_easy_setopt_ccsid(CURL *curl, CURLoption tag, ...)
   case CURLOPT_TLSAUTH_TYPE:
   case CURLOPT_TLSAUTH_USERNAME:
   case CURLOPT_UNIX_SOCKET_PATH:
+  case CURLOPT_UPLOAD_ENCODING:
   case CURLOPT_URL:
   case CURLOPT_USERAGENT:
   case CURLOPT_USERNAME:
@@ -38,6 +38,7 @@
 #include "tool_msgs.h"
 #include "tool_cb_wrt.h"
 #include "tool_operate.h"
+#include "tool_segment.h"
 
 #include "memdebug.h" /* keep this as LAST include */
 
@@ -217,6 +218,9 @@ size_t tool_write_cb(char *buffer, size_t sz, size_t nmemb, void *userdata)
   }
 #endif
 
+  if(per->segs && !segment_accept(per, bytes))
+    return CURL_WRITEFUNC_ERROR;
+
   if(!outs->stream && !tool_create_output_file(outs, per->config))
     return CURL_WRITEFUNC_ERROR;
 
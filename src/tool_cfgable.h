@@ -83,6 +83,7 @@ struct OperationConfig {
   long localportrange;
   unsigned short porttouse;
   char *range;
+  long segments;       /* split a download into this many ranges */
   long low_speed_limit;
   long low_speed_time;
   char *dns_servers;   /* dot notation: 1.1.1.1;2.2.2.2 */
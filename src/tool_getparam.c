@@ -325,6 +325,7 @@ static const struct LongShort aliases[]= {
   {"q",  "disable",                  ARG_BOOL},
   {"Q",  "quote",                    ARG_STRING},
   {"r",  "range",                    ARG_STRING},
+  {"ra", "segments",                 ARG_STRING},
   {"R",  "remote-time",              ARG_BOOL},
   {"s",  "silent",                   ARG_BOOL},
   {"S",  "show-error",               ARG_BOOL},
@@ -2208,6 +2209,14 @@ ParameterError getparameter(const char *flag, /* f or -long-flag */
         return err;
       break;
     case 'r':
+      if(subletter == 'a') { /* --segments */
+        err = str2unum(&config->segments, nextarg);
+        if(err)
+          return err;
+        if(config->segments > MAX_SEGMENTS)
+          config->segments = MAX_SEGMENTS;
+        break;
+      }
       /* Specifying a range WITHOUT A DASH will create an illegal HTTP range
          (and won't actually be range by definition). The man page previously
          claimed that to be a good way, why this code is added to work-around
@@ -615,6 +615,9 @@ const struct helptxt helptext[] = {
   {"    --sasl-ir",
    "Enable initial response in SASL authentication",
    CURLHELP_AUTH},
+  {"    --segments <num>",
+   "Download in this many parallel byte ranges",
+   CURLHELP_HTTP | CURLHELP_OUTPUT},
   {"    --service-name <name>",
    "SPNEGO service name",
    CURLHELP_MISC},
@@ -33,6 +33,8 @@
 #define MAX_PARALLEL 300 /* conservative */
 #define PARALLEL_DEFAULT 50
 
+#define MAX_SEGMENTS 1000 /* for a single download */
+
 #ifndef STDIN_FILENO
 #  define STDIN_FILENO  fileno(stdin)
 #endif
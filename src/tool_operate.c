@@ -73,6 +73,7 @@
 #include "tool_operhlp.h"
 #include "tool_paramhlp.h"
 #include "tool_parsecfg.h"
+#include "tool_segment.h"
 #include "tool_setopt.h"
 #include "tool_sleep.h"
 #include "tool_urlglob.h"
@@ -328,6 +329,11 @@ static CURLcode pre_transfer(struct GlobalConfig *global,
     }
     per->input.fd = per->infd;
   }
+  if(per->segs && !per->outs.stream) {
+    result = segment_open(per);
+    if(result)
+      return result;
+  }
   per->start = tvnow();
   return result;
 }
@@ -393,6 +399,9 @@ static CURLcode post_per_transfer(struct GlobalConfig *global,
   if(per->infdopen)
     close(per->infd);
 
+  if(per->segs)
+    result = segment_verify(per, result);
+
 #ifdef __VMS
   if(is_vms_shell()) {
     /* VMS DCL shell behavior */
@@ -583,7 +592,10 @@ static CURLcode post_per_transfer(struct GlobalConfig *global,
         if(per->retry_sleep > RETRY_SLEEP_MAX)
           per->retry_sleep = RETRY_SLEEP_MAX;
       }
-      if(outs->bytes && outs->filename && outs->stream) {
+      if(per->segs)
+        /* the range is written again from its start */
+        segment_rewind(per);
+      else if(outs->bytes && outs->filename && outs->stream) {
         int rc;
         /* We have written data to an output file, we truncate file
          */
@@ -648,6 +660,9 @@ static CURLcode post_per_transfer(struct GlobalConfig *global,
     }
   }
 
+  if(per->segs)
+    result = segment_done(per, result);
+
   AmigaSetComment(per, result);
 
   /* File time can only be set _after_ the file has been closed */
@@ -713,6 +728,123 @@ static const char *url_proto(char *url)
   return proto? proto: "???";   /* Never match if not found. */
 }
 
+/*
+ * Add a transfer that is a copy of 'per', for another range of the same
+ * --segments download.
+ */
+static CURLcode clone_transfer(struct GlobalConfig *global, CURLSH *share,
+                               struct per_transfer *per,
+                               struct per_transfer **clonep)
+{
+  struct OperationConfig *config = per->config;
+  struct per_transfer *n;
+  CURLcode result;
+  CURL *curl = curl_easy_duphandle(per->curl);
+  if(!curl)
+    return CURLE_OUT_OF_MEMORY;
+
+  result = add_per_transfer(&n);
+  if(result) {
+    curl_easy_cleanup(curl);
+    return result;
+  }
+  n->config = config;
+  n->curl = curl;
+  n->urlnum = per->urlnum;
+  n->infd = STDIN_FILENO;
+  n->noprogress = per->noprogress;
+  n->progressbar = per->progressbar;
+  n->retry_numretries = per->retry_numretries;
+  n->retry_sleep_default = per->retry_sleep_default;
+  n->retry_sleep = per->retry_sleep;
+  n->retrystart = per->retrystart;
+  n->errorbuffer = per->errorbuffer;
+  n->this_url = strdup(per->this_url);
+  n->outfile = strdup(per->outfile);
+  if(!n->this_url || !n->outfile)
+    return CURLE_OUT_OF_MEMORY;
+  n->outs.filename = n->outfile;
+  n->outs.s_isreg = TRUE;
+
+  n->heads.stream = per->heads.stream;
+  if(per->heads.fopened) {
+    /* every transfer appends to the header file through its own handle */
+    n->heads.stream = fopen(config->headerfile, "ab+");
+    if(!n->heads.stream) {
+      warnf(global, "Failed to open %s\n", config->headerfile);
+      return CURLE_WRITE_ERROR;
+    }
+    n->heads.filename = config->headerfile;
+    n->heads.s_isreg = TRUE;
+    n->heads.fopened = TRUE;
+  }
+
+  n->hdrcbdata = per->hdrcbdata;
+  n->hdrcbdata.outs = &n->outs;
+  n->hdrcbdata.heads = &n->heads;
+  n->hdrcbdata.etag_save = &n->etag_save;
+  n->input.fd = n->infd;
+  n->input.config = config;
+  n->input.per = n;
+
+  /* the copied handle still points to the data of 'per' */
+  (void)curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  (void)curl_easy_setopt(curl, CURLOPT_WRITEDATA, n);
+  (void)curl_easy_setopt(curl, CURLOPT_INTERLEAVEDATA, n);
+  (void)curl_easy_setopt(curl, CURLOPT_HEADERDATA, n);
+  (void)curl_easy_setopt(curl, CURLOPT_READDATA, &n->input);
+  (void)curl_easy_setopt(curl, CURLOPT_SEEKDATA, &n->input);
+  (void)curl_easy_setopt(curl, CURLOPT_XFERINFODATA, n);
+
+  *clonep = n;
+  return CURLE_OK;
+}
+
+/*
+ * Split the download set up in 'per' into byte ranges that are fetched by
+ * transfers of their own, when --segments asks for it and the server
+ * allows it. Otherwise 'per' gets the whole thing as usual.
+ */
+static CURLcode segment_transfers(struct GlobalConfig *global, CURLSH *share,
+                                  struct per_transfer *per,
+                                  const char *use_proto)
+{
+  struct OperationConfig *config = per->config;
+  struct segments *segs;
+  CURLcode result;
+  long i;
+
+  if(((use_proto != proto_http) && (use_proto != proto_https)) ||
+     !per->outs.filename || per->outs.fopened || per->uploadfile ||
+     config->range || config->show_headers || config->no_body ||
+     config->encoding || config->customrequest ||
+     per->hdrcbdata.honor_cd_filename ||
+     (config->file_clobber_mode == CLOBBER_NEVER) ||
+     ((config->httpreq != HTTPREQ_UNSPEC) &&
+      (config->httpreq != HTTPREQ_GET))) {
+    warnf(global, "--segments is not supported for %s, "
+          "getting it in one piece\n", per->this_url);
+    return CURLE_OK;
+  }
+
+  result = segments_init(global, share, per, &segs);
+  if(result || !segs)
+    return result;
+
+  for(i = 0; !result && (i < segs->count); i++) {
+    struct per_transfer *p = per;
+    if(segs->done[i])
+      continue;
+    if(per->segs)
+      /* 'per' itself gets the first missing range */
+      result = clone_transfer(global, share, per, &p);
+    if(!result)
+      result = segment_range(p, segs, i);
+  }
+  segments_release(segs);
+  return result;
+}
+
 /* create the next (singular) transfer */
 static CURLcode single_transfer(struct GlobalConfig *global,
                                 struct OperationConfig *config,
@@ -2146,6 +2278,12 @@ static CURLcode single_transfer(struct GlobalConfig *global,
         per->retry_sleep = per->retry_sleep_default; /* ms */
         per->retrystart = tvnow();
 
+        if(config->segments > 1) {
+          result = segment_transfers(global, share, per, use_proto);
+          if(result)
+            break;
+        }
+
         state->li++;
         /* Here's looping around each globbed URL */
         if(state->li >= urlnum) {
@@ -2726,6 +2864,7 @@ CURLcode operate(struct GlobalConfig *global, int argc, argv_item_t argv[])
         curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
         curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_PSL);
         curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_HSTS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CA_STORE);
 
         /* Get the required arguments for each operation */
         do {
@@ -28,6 +28,8 @@
 #include "tool_cb_prg.h"
 #include "tool_sdecls.h"
 
+struct segments;
+
 struct per_transfer {
   /* double linked */
   struct per_transfer *next;
@@ -75,6 +77,11 @@ struct per_transfer {
   char *uploadfile;
   char *errorbuffer; /* alloced and assigned while this is used for a
                         transfer */
+
+  /* set when this transfer gets one range of a --segments download */
+  struct segments *segs;
+  long segment; /* the index of that range */
+  bool segment_refused; /* data that was not the range came back */
 };
 
 CURLcode operate(struct GlobalConfig *config, int argc, argv_item_t argv[]);
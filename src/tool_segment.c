@@ -0,0 +1,496 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "tool_setup.h"
+
+#ifdef HAVE_FCNTL_H
+/* for open() */
+#include <fcntl.h>
+#endif
+
+#include <sys/stat.h>
+
+#define ENABLE_CURLX_PRINTF
+/* use our own printf() functions */
+#include "curlx.h"
+
+#include "tool_cfgable.h"
+#include "tool_msgs.h"
+#include "tool_cb_see.h"
+#include "tool_operate.h"
+#include "tool_segment.h"
+
+#include "memdebug.h" /* keep this as LAST include */
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+ * A download given --segments is split into byte ranges that are fetched by
+ * separate transfers, which write their data straight into the output file
+ * at the offset of their range. A checkpoint file next to the output file
+ * lists the ranges that are done, so that a download that is interrupted
+ * only gets the missing ranges when the same command line is run again.
+ *
+ * The checkpoint file looks like:
+ *
+ *  size <total size>
+ *  count <number of ranges>
+ *  validator <ETag or Last-Modified>
+ *  done <range index>
+ *  done <range index>
+ *  ...
+ */
+
+static size_t probe_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+  (void)ptr;
+  (void)userdata;
+  return size * nmemb;
+}
+
+/*
+ * Ask the server about the resource with a HEAD request on a copy of the
+ * handle. Sets *sizep to the size of the resource if it can be fetched in
+ * ranges, or leaves it at -1 when the download should be done in one piece.
+ */
+static CURLcode segments_probe(struct GlobalConfig *global, CURLSH *share,
+                               struct per_transfer *per, curl_off_t *sizep,
+                               char **validatorp)
+{
+  struct curl_header *h;
+  const char *reason = NULL;
+  long code = 0;
+  curl_off_t size = -1;
+  CURLcode result;
+  CURL *curl = curl_easy_duphandle(per->curl);
+  if(!curl)
+    return CURLE_OUT_OF_MEMORY;
+
+  (void)curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  (void)curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  (void)curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+  (void)curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, NULL);
+  (void)curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, probe_cb);
+  (void)curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, probe_cb);
+
+  result = curl_easy_perform(curl);
+  if(result)
+    reason = curl_easy_strerror(result);
+  else {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+    if(code != 200)
+      reason = "unexpected response code";
+    else if(size <= 0)
+      reason = "unknown size";
+    else if(curl_easy_header(curl, "Accept-Ranges", 0, CURLH_HEADER, -1, &h)
+            || !curl_strequal(h->value, "bytes"))
+      reason = "no byte range support";
+    else if(!curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &h) ||
+            !curl_easy_header(curl, "Last-Modified", 0, CURLH_HEADER, -1,
+                              &h)) {
+      *validatorp = strdup(h->value);
+      if(!*validatorp) {
+        curl_easy_cleanup(curl);
+        return CURLE_OUT_OF_MEMORY;
+      }
+    }
+  }
+  curl_easy_cleanup(curl);
+
+  if(reason) {
+    warnf(global, "Cannot split %s into segments (%s), "
+          "getting it in one piece\n", per->this_url, reason);
+    size = -1;
+  }
+  *sizep = size;
+  return CURLE_OK;
+}
+
+/*
+ * Read the checkpoint file and mark the ranges it lists as done. Returns
+ * FALSE if there is none or if it was written for another version of the
+ * resource or another split.
+ */
+static bool segments_load(struct segments *segs)
+{
+  char line[1024];
+  curl_off_t size = -1;
+  long count = 0;
+  bool validated = !segs->validator;
+  bool ok = TRUE;
+  struct_stat fileinfo;
+  FILE *file;
+
+  if(stat(segs->filename, &fileinfo) || !S_ISREG(fileinfo.st_mode))
+    return FALSE;
+
+  file = fopen(segs->checkpoint, FOPEN_READTEXT);
+  if(!file)
+    return FALSE;
+
+  while(fgets(line, sizeof(line), file)) {
+    char *nl = strchr(line, '\n');
+    if(!nl) {
+      /* too long to be ours */
+      ok = FALSE;
+      break;
+    }
+    *nl = '\0';
+    if(!strncmp(line, "size ", 5)) {
+      if(curlx_strtoofft(&line[5], NULL, 10, &size))
+        ok = FALSE;
+    }
+    else if(!strncmp(line, "count ", 6))
+      count = strtol(&line[6], NULL, 10);
+    else if(!strncmp(line, "validator ", 10))
+      validated = segs->validator && !strcmp(&line[10], segs->validator);
+    else if(!strncmp(line, "done ", 5)) {
+      long i = strtol(&line[5], NULL, 10);
+      if(i >= 0 && i < segs->count)
+        segs->done[i] = TRUE;
+    }
+  }
+  fclose(file);
+
+  if(!ok || !validated || (size != segs->size) || (count != segs->count)) {
+    memset(segs->done, 0, segs->count * sizeof(bool));
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void segments_save(struct GlobalConfig *global, struct segments *segs)
+{
+  long i;
+  FILE *file = fopen(segs->checkpoint, FOPEN_WRITETEXT);
+  if(!file) {
+    warnf(global, "Failed to write %s\n", segs->checkpoint);
+    return;
+  }
+  fprintf(file, "size %" CURL_FORMAT_CURL_OFF_T "\n", segs->size);
+  fprintf(file, "count %ld\n", segs->count);
+  if(segs->validator)
+    fprintf(file, "validator %s\n", segs->validator);
+  for(i = 0; i < segs->count; i++)
+    if(segs->done[i])
+      fprintf(file, "done %ld\n", i);
+  if(fclose(file))
+    warnf(global, "Failed to write %s\n", segs->checkpoint);
+}
+
+/*
+ * Every range is asked for with If-Range, so that a server that has another
+ * version of the resource by now sends all of it instead, which is then
+ * refused. Weak ETags cannot be used for this.
+ */
+static CURLcode segments_headers(struct OperationConfig *config,
+                                 struct segments *segs)
+{
+  struct curl_slist *h;
+  struct curl_slist *list;
+  char *ifrange;
+
+  if(!segs->validator || !strncmp(segs->validator, "W/", 2))
+    return CURLE_OK;
+
+  for(h = config->headers; h; h = h->next) {
+    list = curl_slist_append(segs->headers, h->data);
+    if(!list)
+      return CURLE_OUT_OF_MEMORY;
+    segs->headers = list;
+  }
+  ifrange = aprintf("If-Range: %s", segs->validator);
+  if(!ifrange)
+    return CURLE_OUT_OF_MEMORY;
+  list = curl_slist_append(segs->headers, ifrange);
+  free(ifrange);
+  if(!list)
+    return CURLE_OUT_OF_MEMORY;
+  segs->headers = list;
+  return CURLE_OK;
+}
+
+/*
+ * Figure out if and how the download set up in 'per' is split. *segsp is
+ * left NULL when it is not, and the download is then done as usual.
+ */
+CURLcode segments_init(struct GlobalConfig *global, CURLSH *share,
+                       struct per_transfer *per, struct segments **segsp)
+{
+  struct OperationConfig *config = per->config;
+  struct segments *segs;
+  char *validator = NULL;
+  curl_off_t size;
+  long i;
+  CURLcode result;
+
+  *segsp = NULL;
+  result = segments_probe(global, share, per, &size, &validator);
+  if(result || (size <= 0))
+    return result;
+
+  segs = calloc(1, sizeof(struct segments));
+  if(!segs) {
+    free(validator);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  segs->validator = validator;
+  segs->size = size;
+  segs->refs = 1;
+  segs->count = (size < config->segments) ? (long)size : config->segments;
+  segs->segsize = (size + segs->count - 1) / segs->count;
+  /* rounding the range size up may leave fewer ranges */
+  segs->count = (long)((size + segs->segsize - 1) / segs->segsize);
+  segs->filename = strdup(per->outfile);
+  segs->checkpoint = aprintf("%s.segments", per->outfile);
+  segs->done = calloc(segs->count, sizeof(bool));
+  if(!segs->filename || !segs->checkpoint || !segs->done) {
+    segments_release(segs);
+    return CURLE_OUT_OF_MEMORY;
+  }
+
+  result = segments_headers(config, segs);
+  if(result) {
+    segments_release(segs);
+    return result;
+  }
+
+  if(segments_load(segs)) {
+    for(i = 0; (i < segs->count) && segs->done[i]; i++)
+      ;
+    if(i == segs->count)
+      /* the checkpoint outlived the download, get the last range again */
+      segs->done[segs->count - 1] = FALSE;
+    notef(global, "Resuming the segmented download of %s\n", segs->filename);
+  }
+  else {
+    /* start over with an empty file */
+    FILE *file = fopen(segs->filename, "wb");
+    if(!file) {
+      errorf(global, "Can't open '%s'!\n", segs->filename);
+      segments_release(segs);
+      return CURLE_WRITE_ERROR;
+    }
+    fclose(file);
+    segments_save(global, segs);
+  }
+
+  *segsp = segs;
+  return CURLE_OK;
+}
+
+/*
+ * Drop a reference. When the last transfer is done with the download, the
+ * checkpoint file is removed if all ranges made it.
+ */
+void segments_release(struct segments *segs)
+{
+  long i;
+  if(--segs->refs)
+    return;
+
+  for(i = 0; (i < segs->count) && segs->done; i++)
+    if(!segs->done[i])
+      break;
+  if(segs->done && segs->checkpoint && (i == segs->count))
+    unlink(segs->checkpoint);
+
+  free(segs->filename);
+  free(segs->checkpoint);
+  free(segs->validator);
+  curl_slist_free_all(segs->headers);
+  free(segs->done);
+  free(segs);
+}
+
+static curl_off_t segment_start(struct per_transfer *per)
+{
+  return per->segment * per->segs->segsize;
+}
+
+static curl_off_t segment_length(struct per_transfer *per)
+{
+  curl_off_t start = segment_start(per);
+  curl_off_t left = per->segs->size - start;
+  return (left < per->segs->segsize) ? left : per->segs->segsize;
+}
+
+/*
+ * Make the transfer 'per' get range number 'segment' of the download.
+ */
+CURLcode segment_range(struct per_transfer *per, struct segments *segs,
+                       long segment)
+{
+  char range[128];
+  curl_off_t start;
+  curl_off_t length;
+  CURLcode result;
+
+  per->segs = segs;
+  per->segment = segment;
+  start = segment_start(per);
+  length = segment_length(per);
+  msnprintf(range, sizeof(range),
+            "%" CURL_FORMAT_CURL_OFF_T "-%" CURL_FORMAT_CURL_OFF_T,
+            start, start + length - 1);
+  result = curl_easy_setopt(per->curl, CURLOPT_RANGE, range);
+  if(!result && segs->headers)
+    result = curl_easy_setopt(per->curl, CURLOPT_HTTPHEADER, segs->headers);
+  if(result) {
+    per->segs = NULL;
+    return result;
+  }
+  segs->refs++;
+  return CURLE_OK;
+}
+
+/*
+ * Open the output file for writing at the start of this transfer's range.
+ */
+CURLcode segment_open(struct per_transfer *per)
+{
+  struct OutStruct *outs = &per->outs;
+  curl_off_t start = segment_start(per);
+  struct InStruct in;
+  FILE *file = NULL;
+
+  memset(&in, 0, sizeof(in));
+  in.fd = open(per->segs->filename, O_WRONLY | O_BINARY);
+  if(in.fd != -1) {
+    if(tool_seek_cb(&in, start, SEEK_SET) == CURL_SEEKFUNC_OK)
+      file = fdopen(in.fd, "wb");
+    if(!file)
+      close(in.fd);
+  }
+  if(!file) {
+    errorf(per->config->global, "Can't open '%s'!\n", per->segs->filename);
+    return CURLE_WRITE_ERROR;
+  }
+
+  outs->stream = file;
+  outs->fopened = TRUE;
+  outs->s_isreg = TRUE;
+  outs->init = start;
+  outs->bytes = 0;
+  per->segment_refused = FALSE;
+  return CURLE_OK;
+}
+
+/*
+ * Called before data is written to the range. Only a 206 response for the
+ * range gets written, so that a server ignoring the range or sending another
+ * one never writes over the rest of the file.
+ */
+bool segment_accept(struct per_transfer *per, size_t len)
+{
+  curl_off_t length = segment_length(per);
+  struct curl_header *h;
+  long code = 0;
+
+  curl_easy_getinfo(per->curl, CURLINFO_RESPONSE_CODE, &code);
+  if((code != 206) || ((curl_off_t)len > length - per->outs.bytes))
+    per->segment_refused = TRUE;
+  else if(!per->outs.bytes) {
+    /* "bytes <first>-<last>/<size>" */
+    curl_off_t first = -1;
+    if(curl_easy_header(per->curl, "Content-Range", 0, CURLH_HEADER, -1,
+                        &h) ||
+       !curl_strnequal(h->value, "bytes ", 6) ||
+       curlx_strtoofft(&h->value[6], NULL, 10, &first) ||
+       (first != segment_start(per)))
+      per->segment_refused = TRUE;
+  }
+  return !per->segment_refused;
+}
+
+/*
+ * A range only counts as done if the server sent exactly that range.
+ */
+CURLcode segment_verify(struct per_transfer *per, CURLcode result)
+{
+  curl_off_t length = segment_length(per);
+  long code = 0;
+
+  if(result && !per->segment_refused)
+    return result;
+
+  curl_easy_getinfo(per->curl, CURLINFO_RESPONSE_CODE, &code);
+  if(!per->segment_refused && (code == 206) && (per->outs.bytes == length))
+    return CURLE_OK;
+
+  if(per->errorbuffer)
+    msnprintf(per->errorbuffer, CURL_ERROR_SIZE,
+              "Range %" CURL_FORMAT_CURL_OFF_T "-%" CURL_FORMAT_CURL_OFF_T
+              " was not delivered (response %ld, %" CURL_FORMAT_CURL_OFF_T
+              " bytes)", segment_start(per),
+              segment_start(per) + length - 1, code, per->outs.bytes);
+  return CURLE_RANGE_ERROR;
+}
+
+/*
+ * Before a retry, close the output file. It is opened again at the start of
+ * the range when the transfer restarts, so nothing needs truncating.
+ */
+void segment_rewind(struct per_transfer *per)
+{
+  struct OutStruct *outs = &per->outs;
+  if(outs->stream)
+    fclose(outs->stream);
+  outs->stream = NULL;
+  outs->fopened = FALSE;
+  outs->bytes = 0;
+}
+
+/*
+ * The transfer is over and its output file closed. Record the range in the
+ * checkpoint file if it succeeded. The last transfer of the download fails
+ * if any range is still missing, even when its own range made it.
+ */
+CURLcode segment_done(struct per_transfer *per, CURLcode result)
+{
+  struct segments *segs = per->segs;
+  struct GlobalConfig *global = per->config->global;
+  if(!result) {
+    segs->done[per->segment] = TRUE;
+    segments_save(global, segs);
+  }
+  if(segs->refs == 1) {
+    long i;
+    long missing = 0;
+    for(i = 0; i < segs->count; i++)
+      if(!segs->done[i])
+        missing++;
+    if(missing && !result) {
+      errorf(global, "%ld of %ld segments of %s are missing, run the same "
+             "command again to get them\n", missing, segs->count,
+             segs->filename);
+      result = CURLE_PARTIAL_FILE;
+    }
+  }
+  per->segs = NULL;
+  segments_release(segs);
+  return result;
+}
@@ -0,0 +1,56 @@
+#ifndef HEADER_CURL_TOOL_SEGMENT_H
+#define HEADER_CURL_TOOL_SEGMENT_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "tool_setup.h"
+
+struct GlobalConfig;
+struct per_transfer;
+
+/* A download split into byte ranges, shared by the transfers getting them */
+struct segments {
+  char *filename;   /* the output file all ranges are written to */
+  char *checkpoint; /* "<filename>.segments", lists the completed ranges */
+  char *validator;  /* ETag or Last-Modified of the resource, or NULL */
+  struct curl_slist *headers; /* the request headers with If-Range, or NULL */
+  curl_off_t size;  /* of the whole resource */
+  curl_off_t segsize; /* of every range but the last */
+  long count;       /* number of ranges */
+  long refs;        /* number of transfers using this */
+  bool *done;       /* TRUE for every range stored in the file */
+};
+
+CURLcode segments_init(struct GlobalConfig *global, CURLSH *share,
+                       struct per_transfer *per, struct segments **segsp);
+void segments_release(struct segments *segs);
+
+CURLcode segment_range(struct per_transfer *per, struct segments *segs,
+                       long segment);
+CURLcode segment_open(struct per_transfer *per);
+bool segment_accept(struct per_transfer *per, size_t len);
+CURLcode segment_verify(struct per_transfer *per, CURLcode result);
+void segment_rewind(struct per_transfer *per);
+CURLcode segment_done(struct per_transfer *per, CURLcode result);
+
+#endif /* HEADER_CURL_TOOL_SEGMENT_H */
@@ -136,6 +136,8 @@ const struct NameValueUnsigned setopt_nv_CURLSSLOPT[] = {
   NV(CURLSSLOPT_REVOKE_BEST_EFFORT),
   NV(CURLSSLOPT_NATIVE_CA),
   NV(CURLSSLOPT_AUTO_CLIENT_CERT),
+  NV(CURLSSLOPT_KTLS),
+  NV(CURLSSLOPT_EARLYDATA),
   NVEND,
 };
 
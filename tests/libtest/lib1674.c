@@ -0,0 +1,122 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Gets the URL over new connections with different TLS settings and tells
+ * which ones got a cached SSL context. A context is only reused for the same
+ * settings and never when an SSL_CTX callback is set.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static int reused;
+
+static int debug_cb(CURL *handle, curl_infotype type, char *data,
+                    size_t size, void *userp)
+{
+  (void)handle;
+  (void)userp;
+  if((type == CURLINFO_TEXT) && (size >= 34) &&
+     !memcmp(data, "SSL: re-using a configured context", 34))
+    reused++;
+  return 0;
+}
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static CURLcode ctx_cb(CURL *curl, void *sslctx, void *parm)
+{
+  (void)curl;
+  (void)sslctx;
+  (*(int *)parm)++;
+  return CURLE_OK;
+}
+
+int test(char *URL)
+{
+  static const char * const steps[] = {
+    "first", "same", "tls1.2 max", "first again", "callback", "callback"
+  };
+  CURL *curl;
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  int calls = 0;
+  int i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  curl = curl_easy_init();
+  if(!curl) {
+    fprintf(stderr, "curl_easy_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  test_setopt(curl, CURLOPT_URL, URL);
+  test_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+  test_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  test_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+  test_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  test_setopt(curl, CURLOPT_DEBUGFUNCTION, debug_cb);
+  test_setopt(curl, CURLOPT_VERBOSE, 1L);
+
+  for(i = 0; i < (int)(sizeof(steps)/sizeof(steps[0])); i++) {
+    switch(i) {
+    case 2:
+      test_setopt(curl, CURLOPT_SSLVERSION,
+                  (long)(CURL_SSLVERSION_DEFAULT |
+                         CURL_SSLVERSION_MAX_TLSv1_2));
+      break;
+    case 3:
+      test_setopt(curl, CURLOPT_SSLVERSION, (long)CURL_SSLVERSION_DEFAULT);
+      break;
+    case 4:
+      test_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, ctx_cb);
+      test_setopt(curl, CURLOPT_SSL_CTX_DATA, &calls);
+      break;
+    }
+    reused = 0;
+    res = curl_easy_perform(curl);
+    if(res) {
+      fprintf(stderr, "transfer %d failed: %d\n", i, (int)res);
+      goto test_cleanup;
+    }
+    printf("%s: %s\n", steps[i], reused ? "reused" : "new");
+  }
+  printf("callback calls: %d\n", calls);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
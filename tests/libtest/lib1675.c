@@ -0,0 +1,111 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Share the CA store, get the URL twice with handles using the share and
+ * check that the share can only be cleaned up once the handles are gone.
+ * The second argument is the CA file to verify an HTTPS server with.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static CURLcode get(CURLSH *share, const char *URL, CURL **curlp)
+{
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  CURL *curl = curl_easy_init();
+  *curlp = curl;
+  if(!curl)
+    return res;
+  test_setopt(curl, CURLOPT_URL, URL);
+  test_setopt(curl, CURLOPT_SHARE, share);
+  test_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  if(libtest_arg2)
+    test_setopt(curl, CURLOPT_CAINFO, libtest_arg2);
+  res = curl_easy_perform(curl);
+test_cleanup:
+  return res;
+}
+
+int test(char *URL)
+{
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  CURLSH *share;
+  CURLSHcode shres;
+  CURL *curl[2] = { NULL, NULL };
+  int i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  share = curl_share_init();
+  if(!share) {
+    fprintf(stderr, "curl_share_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  shres = curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CA_STORE);
+  printf("share CA store: %d\n", (int)shres);
+
+  for(i = 0; i < 2; i++) {
+    res = get(share, URL, &curl[i]);
+    printf("transfer %d: %d\n", i + 1, (int)res);
+    if(res)
+      goto test_cleanup;
+  }
+
+  shres = curl_share_cleanup(share);
+  printf("cleanup with handles: %d\n", (int)shres);
+
+  for(i = 0; i < 2; i++) {
+    curl_easy_cleanup(curl[i]);
+    curl[i] = NULL;
+  }
+
+  shres = curl_share_setopt(share, CURLSHOPT_UNSHARE,
+                            CURL_LOCK_DATA_CA_STORE);
+  printf("unshare CA store: %d\n", (int)shres);
+  shres = curl_share_cleanup(share);
+  printf("cleanup: %d\n", (int)shres);
+  share = NULL;
+
+test_cleanup:
+
+  for(i = 0; i < 2; i++)
+    curl_easy_cleanup(curl[i]);
+  if(share)
+    curl_share_cleanup(share);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Get the URL with CURLSSLOPT_KTLS set. Over TLS with a backend that does
+ * kernel TLS, the handshake is followed by a line telling where records are
+ * sent and received, which is checked for being either of the two. There
+ * is no such line without TLS.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static int ktls_lines;
+static int ktls_bad;
+
+static int debug_cb(CURL *handle, curl_infotype type, char *data,
+                    size_t size, void *userp)
+{
+  static const char prefix[] = "kTLS: send in ";
+  (void)handle;
+  (void)userp;
+  if((type == CURLINFO_TEXT) && (size > sizeof(prefix) - 1) &&
+     !memcmp(data, prefix, sizeof(prefix) - 1)) {
+    char line[80];
+    char send[16];
+    char recv[16];
+    size_t len = CURLMIN(size, sizeof(line) - 1);
+    memcpy(line, data, len);
+    line[len] = 0;
+    ktls_lines++;
+    if((sscanf(line, "kTLS: send in %15[a-z ], receive in %15[a-z ]",
+               send, recv) != 2) ||
+       (strcmp(send, "kernel") && strcmp(send, "user space")) ||
+       (strcmp(recv, "kernel") && strcmp(recv, "user space"))) {
+      fprintf(stderr, "bad kTLS line: %s", line);
+      ktls_bad++;
+    }
+  }
+  return 0;
+}
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+int test(char *URL)
+{
+  CURL *curl;
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  curl = curl_easy_init();
+  if(!curl) {
+    fprintf(stderr, "curl_easy_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  test_setopt(curl, CURLOPT_URL, URL);
+  test_setopt(curl, CURLOPT_SSL_OPTIONS, (long)CURLSSLOPT_KTLS);
+  test_setopt(curl, CURLOPT_PROXY_SSL_OPTIONS, (long)CURLSSLOPT_KTLS);
+  test_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+  test_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  test_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  test_setopt(curl, CURLOPT_DEBUGFUNCTION, debug_cb);
+  test_setopt(curl, CURLOPT_VERBOSE, 1L);
+
+  res = curl_easy_perform(curl);
+  if(!res && (ktls_bad || (ktls_lines > 1)))
+    res = TEST_ERR_FAILURE;
+  if(!res && !strncmp(URL, "http:", 5) && ktls_lines) {
+    fprintf(stderr, "kTLS line without TLS\n");
+    res = TEST_ERR_FAILURE;
+  }
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
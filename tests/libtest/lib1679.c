@@ -0,0 +1,100 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Get the URL twice with CURLSSLOPT_EARLYDATA over new connections, so that
+ * the second one resumes the TLS session of the first, and tell if it sent
+ * the request as early data. The request goes out again if the server
+ * rejects the early data, and the transfer must still succeed. The TLS
+ * handshake must be done before the time it is reported done.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+int test(char *URL)
+{
+  CURL *curl;
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  int i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  curl = curl_easy_init();
+  if(!curl) {
+    fprintf(stderr, "curl_easy_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  test_setopt(curl, CURLOPT_URL, URL);
+  test_setopt(curl, CURLOPT_SSL_OPTIONS, (long)CURLSSLOPT_EARLYDATA);
+  test_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+  test_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  test_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+  test_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+
+  for(i = 0; i < 2; i++) {
+    long early = -1;
+    curl_off_t connect = 0;
+    curl_off_t appconnect = 0;
+
+    res = curl_easy_perform(curl);
+    if(res) {
+      fprintf(stderr, "transfer %d failed: %d\n", i + 1, (int)res);
+      goto test_cleanup;
+    }
+    res = curl_easy_getinfo(curl, CURLINFO_TLS_EARLYDATA, &early);
+    if(!res)
+      res = curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    if(!res)
+      res = curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    if(res)
+      goto test_cleanup;
+    if(!appconnect || (appconnect < connect)) {
+      fprintf(stderr, "transfer %d: TLS connected at %" CURL_FORMAT_CURL_OFF_T
+              ", TCP at %" CURL_FORMAT_CURL_OFF_T "\n", i + 1, appconnect,
+              connect);
+      res = TEST_ERR_FAILURE;
+      goto test_cleanup;
+    }
+    printf("transfer %d: early data %ld\n", i + 1, early);
+  }
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
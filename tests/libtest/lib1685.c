@@ -0,0 +1,199 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * CURLMOPT_SSL_VERIFY_THREADS: get the URL with three handles at once, over
+ * new connections, two trusting the server's CA and one trusting another
+ * certificate only, and tell if each chain was verified in a thread. Then
+ * clean up a multi handle while a thread verifies a chain. The second
+ * argument is the directory with the test certificates.
+ */
+#include "test.h"
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+#define HANDLES 3
+
+static int debug_cb(CURL *handle, curl_infotype type, char *data,
+                    size_t size, void *userp)
+{
+  int *threaded = userp;
+  static const char msg[] = "SSL certificate verify in a thread";
+
+  (void)handle;
+  if(type == CURLINFO_TEXT && size >= sizeof(msg) - 1 &&
+     !memcmp(data, msg, sizeof(msg) - 1))
+    (*threaded)++;
+  return 0;
+}
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static int init(CURL **curlp, const char *URL, const char *cafile,
+                int *threaded)
+{
+  int res = 0;
+  CURL *curl = NULL;
+
+  easy_init(curl);
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_CAINFO, cafile);
+  easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+  easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+  easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+  easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  easy_setopt(curl, CURLOPT_DEBUGFUNCTION, debug_cb);
+  easy_setopt(curl, CURLOPT_DEBUGDATA, threaded);
+  easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+  *curlp = curl;
+  return 0;
+
+test_cleanup:
+  curl_easy_cleanup(curl);
+  return res;
+}
+
+int test(char *URL)
+{
+  CURLM *multi = NULL;
+  CURLMcode mres;
+  CURL *curl[HANDLES] = { NULL, NULL, NULL };
+  int threaded[HANDLES] = { 0, 0, 0 };
+  char ca[256];
+  char other[256];
+  int still_running;
+  int finished = 0;
+  int num;
+  int i;
+  int res = 0;
+
+  if(!strcmp(URL, "check")) {
+    /* the chains are verified in threads with OpenSSL 3 only */
+    curl_version_info_data *ver;
+    global_init(CURL_GLOBAL_ALL);
+    ver = curl_version_info(CURLVERSION_NOW);
+    if(!ver->ssl_version ||
+       strncmp(ver->ssl_version, "OpenSSL/", 8) ||
+       (atoi(ver->ssl_version + 8) < 3) ||
+       !(ver->features & CURL_VERSION_THREADSAFE))
+      printf("Needs OpenSSL 3 and thread support\n");
+    curl_global_cleanup();
+    return 0;
+  }
+
+  if(!libtest_arg2) {
+    fprintf(stderr, "Usage: lib1685 <url> <certs dir>\n");
+    return TEST_ERR_USAGE;
+  }
+  msnprintf(ca, sizeof(ca), "%s/EdelCurlRoot-ca.crt", libtest_arg2);
+  msnprintf(other, sizeof(other), "%s/Server-localhost0h-sv.crt",
+            libtest_arg2);
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+
+  multi_init(multi);
+  multi_setopt(multi, CURLMOPT_SSL_VERIFY_THREADS, 2L);
+
+  for(i = 0; i < HANDLES; i++) {
+    res = init(&curl[i], URL, (i < HANDLES - 1) ? ca : other, &threaded[i]);
+    if(res)
+      goto test_cleanup;
+    multi_add_handle(multi, curl[i]);
+  }
+
+  while(finished < HANDLES) {
+    struct CURLMsg *msg;
+
+    multi_perform(multi, &still_running);
+
+    abort_on_test_timeout();
+
+    while((msg = curl_multi_info_read(multi, &num))) {
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+      for(i = 0; i < HANDLES; i++) {
+        if(msg->easy_handle == curl[i])
+          printf("transfer %d: %d, verified in a thread: %s\n", i + 1,
+                 (int)msg->data.result, threaded[i] ? "yes" : "no");
+      }
+      finished++;
+    }
+    if(finished == HANDLES)
+      break;
+
+    multi_poll(multi, NULL, 0, TEST_HANG_TIMEOUT, &num);
+
+    abort_on_test_timeout();
+  }
+
+  for(i = 0; i < HANDLES; i++) {
+    curl_multi_remove_handle(multi, curl[i]);
+    curl_easy_cleanup(curl[i]);
+    curl[i] = NULL;
+  }
+  curl_multi_cleanup(multi);
+  multi = NULL;
+
+  /* leave a chain to verify to the thread and clean up right away */
+  threaded[0] = 0;
+  multi_init(multi);
+  multi_setopt(multi, CURLMOPT_SSL_VERIFY_THREADS, 1L);
+  res = init(&curl[0], URL, ca, &threaded[0]);
+  if(res)
+    goto test_cleanup;
+  multi_add_handle(multi, curl[0]);
+  do {
+    multi_perform(multi, &still_running);
+
+    abort_on_test_timeout();
+
+    if(threaded[0] || !still_running)
+      break;
+
+    multi_poll(multi, NULL, 0, TEST_HANG_TIMEOUT, &num);
+
+    abort_on_test_timeout();
+  } while(1);
+  mres = curl_multi_cleanup(multi);
+  multi = NULL;
+  printf("cleanup while verifying: %d\n", (int)mres);
+
+test_cleanup:
+
+  curl_multi_cleanup(multi);
+  for(i = 0; i < HANDLES; i++)
+    curl_easy_cleanup(curl[i]);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Get the URL and show what the CURLINFO_TLS_* fields return. Counters are
+ * shown as zero or not, as their values depend on the TLS library. Then get
+ * it again on a fresh connection, which resumes the TLS session from the
+ * cache. The second argument, if any, is the CA file to verify an HTTPS
+ * server with.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static const struct {
+  CURLINFO info;
+  const char *name;
+} counters[] = {
+  { CURLINFO_TLS_HANDSHAKE_TIME_T, "handshake time" },
+  { CURLINFO_TLS_VERIFY_TIME_T, "verify time" },
+  { CURLINFO_TLS_RECORDS_IN_T, "records in" },
+  { CURLINFO_TLS_RECORDS_OUT_T, "records out" },
+  { CURLINFO_TLS_BYTES_IN_T, "bytes in" },
+  { CURLINFO_TLS_BYTES_OUT_T, "bytes out" },
+};
+
+int test(char *URL)
+{
+  CURL *curl;
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  long resumed = -1;
+  long early = -1;
+  char *group = (char *)"unset";
+  curl_off_t values[sizeof(counters) / sizeof(counters[0])];
+  size_t i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  curl = curl_easy_init();
+  if(!curl) {
+    fprintf(stderr, "curl_easy_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  test_setopt(curl, CURLOPT_URL, URL);
+  test_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+  if(libtest_arg2)
+    test_setopt(curl, CURLOPT_CAINFO, libtest_arg2);
+
+  res = curl_easy_perform(curl);
+  if(res) {
+    fprintf(stderr, "transfer failed: %d\n", (int)res);
+    goto test_cleanup;
+  }
+
+  res = curl_easy_getinfo(curl, CURLINFO_TLS_SESSION_RESUMED, &resumed);
+  printf("resumed: %d, %ld\n", (int)res, resumed);
+  res = curl_easy_getinfo(curl, CURLINFO_TLS_EARLYDATA, &early);
+  printf("early data: %d, %ld\n", (int)res, early);
+  res = curl_easy_getinfo(curl, CURLINFO_TLS_GROUP, &group);
+  printf("group: %d, %s\n", (int)res, group ? "set" : "none");
+  for(i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+    values[i] = -1;
+    res = curl_easy_getinfo(curl, counters[i].info, &values[i]);
+    printf("%s: %d, %s\n", counters[i].name, (int)res,
+           !values[i] ? "zero" : (values[i] > 0) ? "more" : "less");
+  }
+
+  /* the raw data holds at least a record header per record */
+  if((values[4] < 5 * values[2]) || (values[5] < 5 * values[3])) {
+    fprintf(stderr, "%" CURL_FORMAT_CURL_OFF_T " bytes in %"
+            CURL_FORMAT_CURL_OFF_T " records received, %"
+            CURL_FORMAT_CURL_OFF_T " bytes in %" CURL_FORMAT_CURL_OFF_T
+            " records sent\n", values[4], values[2], values[5], values[3]);
+    res = TEST_ERR_FAILURE;
+    goto test_cleanup;
+  }
+
+  /* a new connection gets the session the first one stored */
+  test_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+  res = curl_easy_perform(curl);
+  if(res) {
+    fprintf(stderr, "second transfer failed: %d\n", (int)res);
+    goto test_cleanup;
+  }
+  resumed = -1;
+  res = curl_easy_getinfo(curl, CURLINFO_TLS_SESSION_RESUMED, &resumed);
+  printf("fresh connection resumed: %d, %ld\n", (int)res, resumed);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
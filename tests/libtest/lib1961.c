@@ -0,0 +1,107 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.haxx.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Sign the same request three times with one handle. The second one uses the
+ * signing key kept from the first and must get the same signature. The third
+ * one is for another region, which needs a new key.
+ */
+#include "test.h"
+
+#include "memdebug.h"
+
+static int reused;
+
+/* debug builds tell when the kept key is used */
+static int debug_cb(CURL *handle, curl_infotype type, char *data,
+                    size_t size, void *userp)
+{
+  static const char msg[] = "aws_sigv4: reusing the kept signing key";
+  (void)handle;
+  (void)userp;
+  if((type == CURLINFO_TEXT) && (size >= sizeof(msg) - 1) &&
+     !memcmp(data, msg, sizeof(msg) - 1))
+    reused++;
+  return 0;
+}
+
+int test(char *URL)
+{
+  CURL *curl;
+  CURLcode res = TEST_ERR_MAJOR_BAD;
+  struct curl_slist *list = NULL;
+  struct curl_slist *connect_to = NULL;
+  int i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed\n");
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  curl = curl_easy_init();
+  if(!curl) {
+    fprintf(stderr, "curl_easy_init() failed\n");
+    curl_global_cleanup();
+    return TEST_ERR_MAJOR_BAD;
+  }
+
+  test_setopt(curl, CURLOPT_VERBOSE, 1L);
+  test_setopt(curl, CURLOPT_DEBUGFUNCTION, debug_cb);
+  test_setopt(curl, CURLOPT_AWS_SIGV4, "xxx");
+  test_setopt(curl, CURLOPT_USERPWD, "xxx");
+  test_setopt(curl, CURLOPT_HEADER, 0L);
+  test_setopt(curl, CURLOPT_URL, URL);
+  list = curl_slist_append(list, "test2: 1234");
+  if(!list)
+    goto test_cleanup;
+  if(libtest_arg2) {
+    connect_to = curl_slist_append(connect_to, libtest_arg2);
+  }
+  test_setopt(curl, CURLOPT_CONNECT_TO, connect_to);
+  curl_slist_append(list, "Content-Type: application/json");
+  curl_slist_append(list, "test1:");
+  curl_slist_append(list, "test0");
+  curl_slist_append(list, "test_space: t\ts  m\t   end    ");
+  curl_slist_append(list, "tesMixCase: MixCase");
+  test_setopt(curl, CURLOPT_HTTPHEADER, list);
+
+  for(i = 0; i < 3; i++) {
+    if(i == 2)
+      test_setopt(curl, CURLOPT_AWS_SIGV4, "xxx:xxx:other:exam");
+    reused = 0;
+    res = curl_easy_perform(curl);
+    if(res)
+      break;
+    printf("request %d: signing key %s\n", i + 1,
+           reused ? "reused" : "derived");
+  }
+
+test_cleanup:
+
+  curl_slist_free_all(connect_to);
+  curl_slist_free_all(list);
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -302,6 +302,7 @@ my $has_libressl;   # built with libressl
 my $has_mbedtls;    # built with mbedTLS
 
 my $has_sslpinning; # built with a TLS backend that supports pinning
+my $has_tlsgroup;   # built with a TLS backend that tells the key exchange group
 
 my $has_shared = "unknown";  # built shared
 
@@ -3032,6 +3033,7 @@ sub setupfeatures {
     $feature{"SSPI"} = $has_sspi;
     $feature{"threaded-resolver"} = $has_threadedres;
     $feature{"threadsafe"} = $has_threadsafe;
+    $feature{"TLS-group"} = $has_tlsgroup;
     $feature{"TLS-SRP"} = $has_tls_srp;
     $feature{"TrackMemory"} = $has_memory_tracking;
     $feature{"Unicode"} = $has_unicode;
@@ -3135,10 +3137,16 @@ sub checksystem {
            elsif ($libcurl =~ /\sopenssl\b/i) {
                $has_openssl=1;
                $has_sslpinning=1;
+               if($libcurl =~ /\sopenssl\/(\d+)/i) {
+                   $has_tlsgroup = ($1 >= 3);
+               }
            }
            elsif ($libcurl =~ /\sgnutls\b/i) {
                $has_gnutls=1;
                $has_sslpinning=1;
+               if($libcurl =~ /\sgnutls\/(\d+)\.(\d+)/i) {
+                   $has_tlsgroup = (($1 > 3) || (($1 == 3) && ($2 >= 6)));
+               }
            }
            elsif ($libcurl =~ /\srustls-ffi\b/i) {
                $has_rustls=1;
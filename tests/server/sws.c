@@ -357,6 +357,20 @@ static int parse_servercmd(struct httprequest *req)
   return 0; /* OK! */
 }
 
+/* strstr() for a request that may hold zero bytes, like a compressed
+   body */
+static const char *findstr(const char *buf, size_t len, const char *str)
+{
+  size_t slen = strlen(str);
+  while(len >= slen) {
+    if(!memcmp(buf, str, slen))
+      return buf;
+    buf++;
+    len--;
+  }
+  return NULL;
+}
+
 static int ProcessRequest(struct httprequest *req)
 {
   char *line = &req->reqbuf[req->checkindex];
@@ -658,24 +672,30 @@ static int ProcessRequest(struct httprequest *req)
     }
 
     if(chunked) {
-      if(strstr(req->reqbuf, "\r\n0\r\n\r\n")) {
+      const char *reqend = req->reqbuf + req->offset;
+      const char *zero = findstr(req->reqbuf, req->offset, "\r\n0\r\n");
+      if(findstr(req->reqbuf, req->offset, "\r\n0\r\n\r\n")) {
         /* end of chunks reached */
         return 1; /* done */
       }
-      else if(strstr(req->reqbuf, "\r\n0\r\n")) {
-        char *last_crlf_char = strstr(req->reqbuf, "\r\n\r\n");
-        while(TRUE) {
-          if(!strstr(last_crlf_char + 4, "\r\n\r\n"))
+      else if(zero) {
+        const char *last_crlf_char =
+          findstr(req->reqbuf, req->offset, "\r\n\r\n");
+        while(last_crlf_char) {
+          const char *next = findstr(last_crlf_char + 4,
+                                     (size_t)(reqend - last_crlf_char - 4),
+                                     "\r\n\r\n");
+          if(!next)
             break;
-          last_crlf_char = strstr(last_crlf_char + 4, "\r\n\r\n");
+          last_crlf_char = next;
         }
-        if(last_crlf_char &&
-           last_crlf_char > strstr(req->reqbuf, "\r\n0\r\n"))
+        if(last_crlf_char && last_crlf_char > zero)
           return 1;
         already_recv_zeroed_chunk = TRUE;
         return 0;
       }
-      else if(already_recv_zeroed_chunk && strstr(req->reqbuf, "\r\n\r\n"))
+      else if(already_recv_zeroed_chunk &&
+              findstr(req->reqbuf, req->offset, "\r\n\r\n"))
         return 1;
       else
         return 0; /* not done */
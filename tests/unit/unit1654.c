@@ -50,6 +50,8 @@ UNITTEST_START
   char outname[256];
   CURL *curl;
   CURLcode result;
+  struct altsvc *as;
+  struct altsvcinfo *reloaded;
   struct altsvcinfo *asi = Curl_altsvc_init();
   if(!asi)
     return 1;
@@ -120,6 +122,16 @@ UNITTEST_START
   }
   fail_unless(asi->list.size == 12, "wrong number of entries");
 
+  /* repeating known alternatives updates them in place */
+  result = Curl_altsvc_parse(curl, asi,
+                             "h3=\"yesyes.com\", h2=\"example.com:8080\"\r\n",
+                             ALPN_h1, "3.example.org", 8080);
+  if(result) {
+    fprintf(stderr, "Curl_altsvc_parse(7) failed!\n");
+    unitfail++;
+  }
+  fail_unless(asi->list.size == 12, "wrong number of entries");
+
   /* clear that one again and decrease the counter */
   result = Curl_altsvc_parse(curl, asi, "clear;\r\n",
                              ALPN_h1, "curl.se", 80);
@@ -131,6 +143,23 @@ UNITTEST_START
 
   Curl_altsvc_save(curl, asi, outname);
 
+  /* the updated alternatives use the order of the latest header */
+  fail_unless(Curl_altsvc_lookup(asi, ALPN_h1, "3.example.org.", 8080,
+                                 &as, ALPN_h2|ALPN_h3) &&
+              (as->dst.alpnid == ALPN_h3), "wrong alternative order");
+
+  /* and so does the saved file */
+  reloaded = Curl_altsvc_init();
+  if(reloaded) {
+    fail_unless(!Curl_altsvc_load(reloaded, outname), "reload failed");
+    fail_unless(reloaded->list.size == 10, "wrong number of reloaded entries");
+    fail_unless(Curl_altsvc_lookup(reloaded, ALPN_h1, "3.example.org.", 8080,
+                                   &as, ALPN_h2|ALPN_h3) &&
+                (as->dst.alpnid == ALPN_h3),
+                "wrong reloaded alternative order");
+    Curl_altsvc_cleanup(&reloaded);
+  }
+
   curl_easy_cleanup(curl);
   curl_global_cleanup();
   fail:
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "arena.h"
+
+static struct Curl_arena arena;
+
+static CURLcode unit_setup(void)
+{
+  Curl_arena_init(&arena, 256);
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  Curl_arena_release(&arena);
+}
+
+UNITTEST_START
+{
+  char *p1;
+  char *p2;
+  char *big;
+  char *str;
+  unsigned char *zero;
+  size_t i;
+
+  /**
+   * testing Curl_arena_alloc
+   */
+
+  p1 = Curl_arena_alloc(&arena, 3);
+  abort_unless(p1, "Out of memory");
+  memcpy(p1, "abc", 3);
+  p2 = Curl_arena_alloc(&arena, 5);
+  abort_unless(p2, "Out of memory");
+  fail_unless(p2 >= p1 + 3, "Allocations overlap");
+  fail_unless(!((size_t)p2 % sizeof(void *)), "Allocation not aligned");
+  memcpy(p2, "12345", 5);
+  fail_unless(!memcmp(p1, "abc", 3), "First allocation was overwritten");
+
+  /**
+   * testing allocations larger than the chunk size
+   */
+
+  big = Curl_arena_alloc(&arena, 1000);
+  abort_unless(big, "Out of memory");
+  memset(big, 'x', 1000);
+  fail_unless(!memcmp(p1, "abc", 3), "First allocation was overwritten");
+  fail_unless(!memcmp(p2, "12345", 5), "Second allocation was overwritten");
+
+  /* fill up several chunks */
+  for(i = 0; i < 100; i++) {
+    char *p = Curl_arena_alloc(&arena, 17);
+    abort_unless(p, "Out of memory");
+    memset(p, 'y', 17);
+  }
+  fail_unless(big[999] == 'x', "Big allocation was overwritten");
+
+  /**
+   * testing Curl_arena_calloc
+   */
+
+  zero = Curl_arena_calloc(&arena, 64);
+  abort_unless(zero, "Out of memory");
+  for(i = 0; i < 64; i++)
+    fail_unless(!zero[i], "Memory not cleared");
+
+  /**
+   * testing Curl_arena_strdup and Curl_arena_memdup
+   */
+
+  str = Curl_arena_strdup(&arena, "1663");
+  abort_unless(str, "Out of memory");
+  fail_unless(!strcmp(str, "1663"), "Bad duplicated string");
+  str = Curl_arena_memdup(&arena, "arena", 3);
+  abort_unless(str, "Out of memory");
+  fail_unless(!memcmp(str, "are", 3), "Bad duplicated data");
+
+  /**
+   * testing Curl_arena_release, the arena is reusable after it
+   */
+
+  Curl_arena_release(&arena);
+  fail_unless(!arena.head, "Chunks not released");
+  p1 = Curl_arena_alloc(&arena, 10);
+  fail_unless(p1, "Arena not usable after release");
+}
+UNITTEST_STOP
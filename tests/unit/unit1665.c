@@ -0,0 +1,304 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "curl_base64.h"
+#include "timeval.h"
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Checks the vectorized base64 code against the plain C code. The vector
+ * kernels work on 12 or 24 byte groups when encoding and 16 or 32 byte
+ * groups when decoding, so every length around multiples of those is
+ * tried with both code paths.
+ *
+ * With CURL_UNIT_BENCH set in the environment, the speed of both is also
+ * measured for inputs from 1 KB up to 100 MB, or up to the number of bytes
+ * the variable is set to. The numbers only mean something in a build with
+ * optimizations enabled:
+ *
+ *   CURL_UNIT_BENCH=1 ./unit1665 -
+ */
+
+#define MAXLEN 1024
+
+#define BENCH_SMALLEST 1000
+#define BENCH_LARGEST 100000000
+#define BENCH_PER_SIZE 16000000 /* bytes to process for each size */
+
+static unsigned char input[MAXLEN];
+static unsigned char *bench_input;
+static char *enc[2];
+static unsigned char *dec[2];
+
+static CURLcode unit_setup(void)
+{
+  unsigned int seed = 1665;
+  size_t i;
+  for(i = 0; i < sizeof(input); i++) {
+    seed = seed * 1103515245 + 12345;
+    input[i] = (unsigned char)(seed >> 16);
+  }
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  int i;
+  for(i = 0; i < 2; i++) {
+    Curl_safefree(enc[i]);
+    Curl_safefree(dec[i]);
+  }
+  Curl_safefree(bench_input);
+  Curl_base64_scalar = FALSE;
+}
+
+/* decode 'src' with both code paths, both must fail */
+static void decode_fails(const char *src)
+{
+  int k;
+  for(k = 0; k < 2; k++) {
+    size_t declen;
+    CURLcode rc;
+    Curl_base64_scalar = k ? TRUE : FALSE;
+    rc = Curl_base64_decode(src, &dec[k], &declen);
+    fail_unless(rc == CURLE_BAD_CONTENT_ENCODING, "bad input accepted");
+    fail_unless(!dec[k], "output returned for bad input");
+    Curl_safefree(dec[k]);
+  }
+}
+
+/* encode and decode 'len' bytes with both code paths and compare, the
+   outputs are left for unit_stop() to free on error */
+static CURLcode roundtrip(size_t len)
+{
+  size_t outlen[2];
+  size_t declen[2];
+  CURLcode rc;
+  int k;
+
+  for(k = 0; k < 2; k++) {
+    Curl_base64_scalar = k ? TRUE : FALSE;
+    rc = Curl_base64url_encode((const char *)input, len, &enc[k],
+                               &outlen[k]);
+    fail_unless(rc == CURLE_OK, "url encode failed");
+    if(rc)
+      return rc;
+  }
+  fail_unless(outlen[0] == outlen[1], "url encoded lengths differ");
+  fail_unless(outlen[0] == (len * 4 + 2) / 3, "bad url encoded length");
+  fail_unless(!memcmp(enc[0], enc[1], outlen[0]), "url encodings differ");
+  fail_unless(!strchr(enc[0], '='), "padding in url encoding");
+  Curl_safefree(enc[0]);
+  Curl_safefree(enc[1]);
+
+  for(k = 0; k < 2; k++) {
+    Curl_base64_scalar = k ? TRUE : FALSE;
+    rc = Curl_base64_encode((const char *)input, len, &enc[k], &outlen[k]);
+    fail_unless(rc == CURLE_OK, "encode failed");
+    if(rc)
+      return rc;
+  }
+  fail_unless(outlen[0] == (len + 2) / 3 * 4, "bad encoded length");
+  fail_unless(!strcmp(enc[0], enc[1]), "encodings differ");
+
+  /* padding */
+  switch(len % 3) {
+  case 0:
+    fail_unless(enc[0][outlen[0] - 1] != '=', "padding for full group");
+    break;
+  case 1:
+    fail_unless(enc[0][outlen[0] - 1] == '=' &&
+                enc[0][outlen[0] - 2] == '=', "one byte needs two '='");
+    fail_unless(enc[0][outlen[0] - 3] != '=', "too much padding");
+    break;
+  case 2:
+    fail_unless(enc[0][outlen[0] - 1] == '=', "two bytes need one '='");
+    fail_unless(enc[0][outlen[0] - 2] != '=', "too much padding");
+    break;
+  }
+
+  /* decode the output with both code paths */
+  for(k = 0; k < 2; k++) {
+    Curl_base64_scalar = k ? TRUE : FALSE;
+    rc = Curl_base64_decode(enc[0], &dec[k], &declen[k]);
+    fail_unless(rc == CURLE_OK, "decode failed");
+    if(rc)
+      return rc;
+    fail_unless(declen[k] == len, "bad decoded length");
+    fail_unless(!memcmp(dec[k], input, len), "bad decoded data");
+    Curl_safefree(dec[k]);
+  }
+
+  /* a bad character anywhere must be caught by both */
+  if(len % 8 == 1) {
+    size_t pos;
+    for(pos = 0; pos < outlen[0]; pos++) {
+      char save = enc[0][pos];
+      if(save == '=')
+        continue;
+      enc[0][pos] = (char)((pos & 1) ? 0x80 | (pos & 0x7f) : '-');
+      decode_fails(enc[0]);
+      if(pos < outlen[0] - 4) {
+        /* padding before the last group */
+        enc[0][pos] = '=';
+        decode_fails(enc[0]);
+      }
+      enc[0][pos] = save;
+    }
+  }
+  Curl_safefree(enc[0]);
+  Curl_safefree(enc[1]);
+  return CURLE_OK;
+}
+
+static double mbps(size_t bytes, timediff_t us)
+{
+  return us ? (double)bytes / (double)us : 0.0;
+}
+
+/* time 'rounds' encodes and decodes of 'len' bytes, the results of the last
+   round are left in *encp and *decp */
+static CURLcode bench(size_t len, size_t rounds, char **encp,
+                      unsigned char **decp, size_t *declen,
+                      timediff_t *enc_us, timediff_t *dec_us)
+{
+  struct curltime start;
+  size_t enclen;
+  size_t i;
+  CURLcode rc = CURLE_OK;
+
+  start = Curl_now();
+  for(i = 0; i < rounds && !rc; i++) {
+    Curl_safefree(*encp);
+    rc = Curl_base64_encode((const char *)bench_input, len, encp, &enclen);
+  }
+  *enc_us = Curl_timediff_us(Curl_now(), start);
+  if(rc)
+    return rc;
+
+  start = Curl_now();
+  for(i = 0; i < rounds && !rc; i++) {
+    Curl_safefree(*decp);
+    rc = Curl_base64_decode(*encp, decp, declen);
+  }
+  *dec_us = Curl_timediff_us(Curl_now(), start);
+  return rc;
+}
+
+/* print the speed, in MB/s, of the plain and the vectorized code for sizes
+   from BENCH_SMALLEST up to 'largest' bytes */
+static CURLcode bench_all(size_t largest)
+{
+  unsigned int seed = 1665;
+  size_t len;
+  size_t i;
+
+  bench_input = malloc(largest);
+  if(!bench_input)
+    return CURLE_OUT_OF_MEMORY;
+  for(i = 0; i < largest; i++) {
+    seed = seed * 1103515245 + 12345;
+    bench_input[i] = (unsigned char)(seed >> 16);
+  }
+
+  printf("%10s %10s %10s %10s %10s\n", "size", "enc plain", "enc vector",
+         "dec plain", "dec vector");
+  for(len = BENCH_SMALLEST; len <= largest; len *= 10) {
+    size_t rounds = BENCH_PER_SIZE / len + 1;
+    size_t declen[2];
+    timediff_t enc_us[2];
+    timediff_t dec_us[2];
+    int k;
+    for(k = 0; k < 2; k++) {
+      CURLcode rc;
+      Curl_base64_scalar = k ? FALSE : TRUE;
+      rc = bench(len, rounds, &enc[k], &dec[k], &declen[k],
+                 &enc_us[k], &dec_us[k]);
+      if(rc)
+        return rc;
+    }
+    fail_unless(!strcmp(enc[0], enc[1]), "encodings differ");
+    fail_unless(declen[1] == len, "bad decoded length");
+    fail_unless(!memcmp(dec[1], bench_input, len), "bad decoded data");
+    printf("%10lu %10.0f %10.0f %10.0f %10.0f\n", (unsigned long)len,
+           mbps(len * rounds, enc_us[0]), mbps(len * rounds, enc_us[1]),
+           mbps(len * rounds, dec_us[0]), mbps(len * rounds, dec_us[1]));
+    for(k = 0; k < 2; k++) {
+      Curl_safefree(enc[k]);
+      Curl_safefree(dec[k]);
+    }
+  }
+  Curl_safefree(bench_input);
+  return CURLE_OK;
+}
+
+UNITTEST_START
+{
+  const char *benchmark = getenv("CURL_UNIT_BENCH");
+  static const size_t blocks[] = { 12, 16, 24, 32 };
+  size_t len;
+  size_t i;
+
+  for(len = 1; len <= 64; len++)
+    abort_unless(!roundtrip(len), "base64 failed");
+
+  for(i = 0; i < sizeof(blocks)/sizeof(blocks[0]); i++) {
+    size_t n;
+    for(n = 2; n * blocks[i] + 2 < MAXLEN; n++) {
+      for(len = n * blocks[i] - 2; len <= n * blocks[i] + 2; len++)
+        abort_unless(!roundtrip(len), "base64 failed");
+    }
+  }
+
+  /**
+   * broken padding and lengths
+   */
+
+  decode_fails("");
+  decode_fails("Q");
+  decode_fails("QQ");
+  decode_fails("QUI");
+  decode_fails("QUJDR");
+  decode_fails("====");
+  decode_fails("Q===");
+  decode_fails("QQ=A");
+  decode_fails("Q=Q=");
+  decode_fails("QUJD=QQ=");
+  decode_fails("QUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQ===");
+  decode_fails("QUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJDQUJD=UJDQUJDQUJDQUJD");
+
+  /**
+   * speed, in MB/s, of the plain and the vectorized code
+   */
+
+  if(benchmark) {
+    size_t largest = (size_t)strtoul(benchmark, NULL, 10);
+    if(largest < BENCH_SMALLEST)
+      largest = BENCH_LARGEST;
+    abort_unless(!bench_all(largest), "base64 benchmark failed");
+  }
+}
+UNITTEST_STOP
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "cfilters.h"
+#include "vtls/vtls.h"
+#include "vtls/vtls_int.h"
+#include "memdebug.h"
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  CURLcode res = CURLE_OK;
+
+  global_init(CURL_GLOBAL_ALL);
+  easy = curl_easy_init();
+  if(!easy) {
+    curl_global_cleanup();
+    return CURLE_OUT_OF_MEMORY;
+  }
+  return res;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#ifdef USE_SSL
+
+/* What the filter below returns on each call, an error ends the list */
+struct below_chunk {
+  const char *buf;
+  size_t len;
+  CURLcode err; /* CURLE_AGAIN to return -1 */
+};
+
+static const struct below_chunk *chunks;
+static int calls;         /* number of recv calls to the filter below */
+static size_t asked;      /* buffer size of the last call */
+
+static ssize_t below_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
+                          char *buf, size_t len, CURLcode *err)
+{
+  const struct below_chunk *c = &chunks[calls++];
+
+  (void)cf;
+  (void)data;
+  asked = len;
+  *err = c->err;
+  if(c->err)
+    return -1;
+  fail_unless(c->len <= len, "chunk larger than the buffer");
+  memcpy(buf, c->buf, c->len);
+  return (ssize_t)c->len;
+}
+
+/* three application data records of 2, 0 and 3 bytes */
+static const char records[] =
+  "\x17\x03\x03\x00\x02" "ab"
+  "\x17\x03\x03\x00\x00"
+  "\x17\x03\x03\x00\x03" "cde";
+#define RECORDS_LEN (sizeof(records) - 1)
+
+#endif /* USE_SSL */
+
+UNITTEST_START
+#ifdef USE_SSL
+{
+  struct Curl_easy *data = easy;
+  struct Curl_cftype cft_below;
+  struct Curl_cfilter below;
+  struct Curl_cfilter cf;
+  struct ssl_connect_data connssl;
+  char buf[64];
+  char *big;
+  ssize_t nread;
+  CURLcode err;
+
+  memset(&cft_below, 0, sizeof(cft_below));
+  cft_below.name = "TEST-BELOW";
+  cft_below.do_recv = below_recv;
+  memset(&below, 0, sizeof(below));
+  below.cft = &cft_below;
+  memset(&cf, 0, sizeof(cf));
+  cf.cft = &cft_below; /* not the SSL proxy filter, so the data counts */
+  cf.next = &below;
+  cf.ctx = &connssl;
+  memset(&connssl, 0, sizeof(connssl));
+
+  /* small reads are served from one read ahead, then EOF is passed on */
+  {
+    static const struct below_chunk c[] = {
+      { records, RECORDS_LEN, CURLE_OK },
+      { NULL, 0, CURLE_OK },
+      { NULL, 0, CURLE_RECV_ERROR }
+    };
+    chunks = c;
+    calls = 0;
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, 5, &err);
+    fail_unless(nread == 5 && !err, "record header not read");
+    fail_unless(!memcmp(buf, records, 5), "wrong record header");
+    fail_unless(calls == 1, "read ahead took more than one call");
+    fail_unless(asked > RECORDS_LEN, "read ahead buffer too small");
+    fail_unless(data->info.tls_records_in == 3, "records not counted");
+    fail_unless(data->info.tls_bytes_in == (curl_off_t)RECORDS_LEN,
+                "bytes not counted");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, 2, &err);
+    fail_unless(nread == 2 && !err, "record body not read");
+    fail_unless(!memcmp(buf, "ab", 2), "wrong record body");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, sizeof(buf), &err);
+    fail_unless(nread == (ssize_t)RECORDS_LEN - 7 && !err,
+                "rest of the read ahead not returned");
+    fail_unless(!memcmp(buf, records + 7, RECORDS_LEN - 7),
+                "wrong rest of the read ahead");
+    fail_unless(calls == 1, "buffered data read from below");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, sizeof(buf), &err);
+    fail_unless(nread == 0 && !err, "EOF not returned");
+    fail_unless(calls == 2, "EOF not read from below");
+    fail_unless(data->info.tls_records_in == 3, "EOF counted as record");
+  }
+
+  /* a record header split over two reads counts once, EAGAIN passes on */
+  {
+    static const struct below_chunk c[] = {
+      { records, 3, CURLE_OK },
+      { NULL, 0, CURLE_AGAIN },
+      { records + 3, 4, CURLE_OK },
+      { NULL, 0, CURLE_RECV_ERROR }
+    };
+    chunks = c;
+    calls = 0;
+    data->info.tls_records_in = 0;
+    data->info.tls_bytes_in = 0;
+    memset(&connssl.scan_in, 0, sizeof(connssl.scan_in));
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, 5, &err);
+    fail_unless(nread == 3 && !err, "partial header not read");
+    fail_unless(data->info.tls_records_in == 0, "partial header counted");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, 2, &err);
+    fail_unless(nread == -1 && err == CURLE_AGAIN, "EAGAIN not returned");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, 2, &err);
+    fail_unless(nread == 2 && !err, "rest of the header not read");
+    fail_unless(!memcmp(buf, records + 3, 2), "wrong rest of the header");
+    fail_unless(data->info.tls_records_in == 1, "split header not counted");
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, buf, sizeof(buf), &err);
+    fail_unless(nread == 2 && !err, "record body not read");
+    fail_unless(calls == 3, "buffered data read from below");
+    fail_unless(data->info.tls_bytes_in == 7, "bytes not counted");
+  }
+
+  /* reads as large as the read ahead go to the filter below directly */
+  big = malloc(64 * 1024);
+  abort_unless(big, "out of memory");
+  {
+    static const struct below_chunk c[] = {
+      { records, RECORDS_LEN, CURLE_OK },
+      { NULL, 0, CURLE_RECV_ERROR }
+    };
+    chunks = c;
+    calls = 0;
+    data->info.tls_records_in = 0;
+    memset(&connssl.scan_in, 0, sizeof(connssl.scan_in));
+
+    nread = Curl_ssl_cf_next_recv(&cf, data, big, 64 * 1024, &err);
+    fail_unless(nread == (ssize_t)RECORDS_LEN && !err, "large read failed");
+    fail_unless(asked == 64 * 1024, "large read was buffered");
+    fail_unless(connssl.rbuf_pos == connssl.rbuf_len,
+                "large read left data in the read ahead");
+    fail_unless(data->info.tls_records_in == 3, "records not counted");
+  }
+  free(big);
+  free(connssl.rbuf);
+}
+#else
+{
+  puts("not tested since SSL is not built-in");
+}
+#endif
+UNITTEST_STOP
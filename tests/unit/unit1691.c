@@ -0,0 +1,202 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "escape.h"
+#include "memdebug.h" /* LAST include file */
+
+/*
+ * Checks Curl_unreserved_span() and Curl_plain_span() against plain byte by
+ * byte loops. The vector code looks at 16 bytes at a time, so every length
+ * up to 64 is tried with a byte that ends the span at every offset, which
+ * puts it on both sides of each 16 byte boundary. The longest string gets
+ * all 256 byte values at every offset, the shorter ones the bytes where the
+ * result of the check changes, and 0x00, 0x7f, 0x80 and 0xff.
+ */
+
+#define MAXLEN 64
+
+/* room for the longest string at the largest start offset */
+static unsigned char buf[MAXLEN + 16];
+
+static CURLcode unit_setup(void)
+{
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+}
+
+static bool ref_unreserved(unsigned char c)
+{
+  return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+    ((c >= '0') && (c <= '9')) ||
+    (c == '-') || (c == '.') || (c == '_') || (c == '~');
+}
+
+static size_t ref_unreserved_span(const unsigned char *s, size_t len)
+{
+  size_t i = 0;
+  while((i < len) && ref_unreserved(s[i]))
+    i++;
+  return i;
+}
+
+struct plainargs {
+  unsigned char lo;
+  unsigned char hi;
+  unsigned char stop1;
+  unsigned char stop2;
+};
+
+static bool ref_plain(const struct plainargs *p, unsigned char c)
+{
+  return (c >= p->lo) && (c <= p->hi) && (c != p->stop1) && (c != p->stop2);
+}
+
+static size_t ref_plain_span(const struct plainargs *p,
+                             const unsigned char *s, size_t len)
+{
+  size_t i = 0;
+  while((i < len) && ref_plain(p, s[i]))
+    i++;
+  return i;
+}
+
+/* fill the buffer with bytes 'ok' says are in the span, so that only the
+   length or the one byte changed by the caller ends it */
+static void fill(bool (*ok)(const struct plainargs *, unsigned char),
+                 const struct plainargs *p)
+{
+  size_t i;
+  unsigned int c = 0;
+  for(i = 0; i < sizeof(buf); i++) {
+    while(!ok(p, (unsigned char)c))
+      c = (c + 1) & 0xff;
+    buf[i] = (unsigned char)c;
+    c = (c + 1) & 0xff;
+  }
+}
+
+static bool fill_unreserved(const struct plainargs *p, unsigned char c)
+{
+  (void)p;
+  return ref_unreserved(c);
+}
+
+/* the bytes to try in strings shorter than MAXLEN */
+static bool edge(bool (*ok)(const struct plainargs *, unsigned char),
+                 const struct plainargs *p, unsigned int c)
+{
+  bool here = ok(p, (unsigned char)c);
+  if(!c || (c == 0x7f) || (c == 0x80) || (c == 0xff))
+    return TRUE;
+  return (here != ok(p, (unsigned char)(c - 1))) ||
+    (here != ok(p, (unsigned char)(c + 1)));
+}
+
+UNITTEST_START
+{
+  /* what the URL parser asks for, and the edges of the byte range */
+  static const struct plainargs plain[] = {
+    { 0x00, 0x7f, ' ', '?' },
+    { 0x20, 0xff, 0x7f, ' ' },
+    { 0x20, 0xff, 0x7f, 0x7f },
+    { 0x00, 0xff, 0x00, 0x00 },
+    { 0x80, 0xff, 0xc0, 0xff },
+    { 'a', 'z', 'q', 'q' },
+  };
+  static const size_t starts[] = { 0, 1, 15 };
+  size_t len;
+  size_t off;
+  size_t i;
+  size_t k;
+  unsigned int c;
+
+  /**
+   * Curl_unreserved_span()
+   */
+
+  for(k = 0; k < sizeof(starts)/sizeof(starts[0]); k++) {
+    const char *s = (const char *)buf + starts[k];
+    fill(fill_unreserved, NULL);
+    for(len = 0; len <= MAXLEN; len++) {
+      fail_unless(Curl_unreserved_span(s, len) == len,
+                  "unreserved span not the whole string");
+      for(off = 0; off < len; off++) {
+        unsigned char *b = buf + starts[k] + off;
+        unsigned char keep = *b;
+        for(c = 0; c < 256; c++) {
+          if((len < MAXLEN) && !edge(fill_unreserved, NULL, c))
+            continue;
+          *b = (unsigned char)c;
+          if(Curl_unreserved_span(s, len) !=
+             ref_unreserved_span((const unsigned char *)s, len)) {
+            fprintf(stderr, "length %lu, byte 0x%02x at %lu\n",
+                    (unsigned long)len, c, (unsigned long)off);
+            fail("unreserved span differs");
+          }
+        }
+        *b = keep;
+      }
+    }
+  }
+
+  /**
+   * Curl_plain_span()
+   */
+
+  for(i = 0; i < sizeof(plain)/sizeof(plain[0]); i++) {
+    const struct plainargs *p = &plain[i];
+    for(k = 0; k < sizeof(starts)/sizeof(starts[0]); k++) {
+      const char *s = (const char *)buf + starts[k];
+      fill(ref_plain, p);
+      for(len = 0; len <= MAXLEN; len++) {
+        fail_unless(Curl_plain_span(s, len, p->lo, p->hi, p->stop1,
+                                    p->stop2) == len,
+                    "plain span not the whole string");
+        for(off = 0; off < len; off++) {
+          unsigned char *b = buf + starts[k] + off;
+          unsigned char keep = *b;
+          for(c = 0; c < 256; c++) {
+            if((len < MAXLEN) && !edge(ref_plain, p, c))
+              continue;
+            *b = (unsigned char)c;
+            if(Curl_plain_span(s, len, p->lo, p->hi, p->stop1, p->stop2) !=
+               ref_plain_span(p, (const unsigned char *)s, len)) {
+              fprintf(stderr, "range %lu, length %lu, byte 0x%02x at %lu\n",
+                      (unsigned long)i, (unsigned long)len, c,
+                      (unsigned long)off);
+              fail("plain span differs");
+            }
+          }
+          *b = keep;
+        }
+      }
+    }
+  }
+}
+UNITTEST_STOP